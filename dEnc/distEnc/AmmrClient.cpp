@@ -3,11 +3,135 @@
 
 #include "dEnc/tools/MultiKeyAES.h"
 #include <cryptoTools/Crypto/RandomOracle.h>
+#include <algorithm>
 #include "dEnc/dprf/Npr03AsymDprf.h"
 #include "dEnc/dprf/Npr03SymDprf.h"
 
 namespace dEnc
 {
+    namespace
+    {
+        // The first block of a ciphertext, with the index of the party and the version.
+        block headerBlock(u64 partyIdx, AmmrVersion version)
+        {
+            auto b = oc::toBlock(partyIdx);
+            ((u8*)&b)[15] = u8(version);
+            return b;
+        }
+
+        // Splits [0, n) across pool in ranges of at least minShardSize, or runs 
+        // it on the calling thread if there is no pool.
+        void forShards(ThreadPool* pool, u64 n, u64 minShardSize, const std::function<void(u64 begin, u64 end)>& fn)
+        {
+            auto numShards = pool ? std::min<u64>(pool->numThreads(), n / minShardSize) : 1;
+
+            if (numShards < 2)
+                fn(0, n);
+            else
+                pool->parallelFor(n, numShards, fn);
+        }
+
+        // Calls fn(piece, pos) for the parts of the fragments that hold the blocks 
+        // [begin, end) of their concatenation, where pos is the index of piece[0].
+        template<typename T, typename Fn>
+        void forPieces(span<const span<T>> frags, u64 begin, u64 end, const Fn& fn)
+        {
+            u64 pos = 0;
+            for (auto& frag : frags)
+            {
+                u64 fragEnd = pos + frag.size();
+                auto b = std::max(begin, pos);
+                auto e = std::min(end, fragEnd);
+                if (b < e)
+                    fn(frag.subspan(b - pos, e - b), b);
+
+                pos = fragEnd;
+                if (pos >= end)
+                    break;
+            }
+        }
+
+        u64 numLeaves(u64 size)
+        {
+            return (size + AmmrTreeLeafSize - 1) / AmmrTreeLeafSize;
+        }
+
+        // The hash of leaf j of a message with size blocks, keyed by rho.
+        template<typename T>
+        block hashLeaf(span<const span<T>> ptxt, u64 size, u64 j, block rho)
+        {
+            oc::RandomOracle H(sizeof(block));
+            H.Update(u8(0));
+            H.Update(rho);
+            H.Update(j);
+
+            auto begin = j * AmmrTreeLeafSize;
+            auto end = std::min(size, begin + AmmrTreeLeafSize);
+            forPieces(ptxt, begin, end, [&](span<T> piece, u64)
+            {
+                H.Update((u8*)piece.data(), piece.size() * sizeof(block));
+            });
+
+            block leaf;
+            H.Final(leaf);
+            return leaf;
+        }
+
+        // The commitment alpha of the tree hash, which is the hash of rho, the
+        // size of the message and the hashes of its leaves.
+        block hashRoot(span<const block> leaves, u64 size, block rho)
+        {
+            oc::RandomOracle H(sizeof(block));
+            H.Update(u8(1));
+            H.Update(rho);
+            H.Update(size);
+            H.Update((u8*)leaves.data(), leaves.size() * sizeof(block));
+
+            block alpha;
+            H.Final(alpha);
+            return alpha;
+        }
+
+        // The tree hash commitment to {message, rho}, with the leaves split across pool.
+        block treeCommit(span<const span<const block>> ptxt, u64 size, block rho, ThreadPool* pool)
+        {
+            std::vector<block> leaves(numLeaves(size));
+            forShards(pool, leaves.size(), 1, [&](u64 begin, u64 end)
+            {
+                for (u64 j = begin; j < end; ++j)
+                    leaves[j] = hashLeaf(ptxt, size, j, rho);
+            });
+
+            return hashRoot(leaves, size, rho);
+        }
+
+        // Decrypts the body of a ciphertext of version AmmrVersion::Tree into the 
+        // fragments and returns the tree hash of the plaintext. Each thread decrypts
+        // and then hashes a range of leaves while they are in its cache.
+        block treeDecrypt(const oc::AES& enc, span<const block> body, span<const span<block>> ptxt, block rho, ThreadPool* pool)
+        {
+            u64 size = body.size();
+            std::vector<block> leaves(numLeaves(size));
+            forShards(pool, leaves.size(), 1, [&](u64 begin, u64 end)
+            {
+                for (u64 j = begin; j < end; ++j)
+                {
+                    auto leafBegin = j * AmmrTreeLeafSize;
+                    auto leafEnd = std::min(size, leafBegin + AmmrTreeLeafSize);
+                    forPieces(ptxt, leafBegin, leafEnd, [&](span<block> piece, u64 pos)
+                    {
+                        enc.ecbEncCounterMode(1 + pos, piece);
+                        for (u64 k = 0; k < u64(piece.size()); ++k)
+                            piece[k] = piece[k] ^ body[pos + k];
+                    });
+
+                    leaves[j] = hashLeaf(ptxt, size, j, rho);
+                }
+            });
+
+            return hashRoot(leaves, size, rho);
+        }
+    }
 
     template<typename DPRF>
 	void AmmrClient<DPRF>::init(u64 partyIdx, block seed, DPRF* dprf)
@@ -17,19 +141,48 @@ namespace dEnc
 		mPrng.SetSeed(seed);
 	}
 
+    template<typename DPRF>
+    void AmmrClient<DPRF>::setLargeMessageMode(std::shared_ptr<ThreadPool> pool, u64 minSize)
+    {
+        mThreadPool = std::move(pool);
+        mLargeMessageSize = minSize;
+    }
+
 
     template<typename DPRF>
     void AmmrClient<DPRF>::encrypt(span<block> ptxt, std::vector<block>& ctxt)
 	{
+		ctxt.resize(ciphertextSize(ptxt.size()));
+		span<const block> frags[] = { ptxt };
+		encrypt(frags, ctxt);
+	}
+
+    template<typename DPRF>
+    void AmmrClient<DPRF>::encrypt(span<const span<const block>> ptxt, span<block> ctxt)
+	{
+		u64 size = 0;
+		for (auto& frag : ptxt)
+			size += frag.size();
+
+		if (u64(ctxt.size()) != ciphertextSize(size))
+			throw std::runtime_error("ciphertext buffer has the wrong size. " LOCATION);
+
 		// Sample randomness rho for the commitment
 		block p = mPrng.get<block>();
 		block alpha;
+		bool large = size >= mLargeMessageSize;
 
-		// hash the {message, rho} to get the DPRF input
-		oc::RandomOracle H(sizeof(block));
-		H.Update((u8*)ptxt.data(), ptxt.size() * sizeof(block));
-		H.Update(p);
-		H.Final(alpha);
+		if (large)
+			alpha = treeCommit(ptxt, size, p, mThreadPool.get());
+		else
+		{
+			// hash the {message, rho} to get the DPRF input
+			oc::RandomOracle H(sizeof(block));
+			for (auto& frag : ptxt)
+				H.Update((u8*)frag.data(), frag.size() * sizeof(block));
+			H.Update(p);
+			H.Final(alpha);
+		}
 
 		// eval DPRF(x)
 		auto fx = mDprf->eval(alpha);
@@ -37,21 +190,37 @@ namespace dEnc
 		// expend the DPRF to get a key and tag. This is a PRG (AES counter mode).
         oc::AES enc(fx);
 
-		// append the preable to the ciphertext
-		ctxt.resize(ptxt.size() + 3);
-		ctxt[0] = oc::toBlock(mPartyIdx);
+		// write the preable of the ciphertext
+		ctxt[0] = headerBlock(mPartyIdx, large ? AmmrVersion::Tree : AmmrVersion::Serial);
 		ctxt[1] = alpha;
 		ctxt[2] = enc.ecbEncBlock(oc::ZeroBlock) ^ p;
 
+		if (large)
+		{
+			// each thread encrypts a range of counters.
+			auto body = ctxt.subspan(3);
+			forShards(mThreadPool.get(), size, AmmrTreeLeafSize, [&](u64 begin, u64 end)
+			{
+				enc.ecbEncCounterMode(1 + begin, body.subspan(begin, end - begin));
+				forPieces(ptxt, begin, end, [&](span<const block> piece, u64 pos)
+				{
+					for (u64 k = 0; k < u64(piece.size()); ++k)
+						body[pos + k] = body[pos + k] ^ piece[k];
+				});
+			});
+			return;
+		}
+
 		auto dest = ctxt.begin() + 3;
-		auto src = ptxt.data();
         enc.ecbEncCounterMode(1, { dest, ctxt.end() } );
 
-		for (u64 i = 0; i < ptxt.size(); ++i)
+		for (auto& frag : ptxt)
 		{
-			*dest = *dest  ^ *src;
-			++dest;
-			++src;
+			for (auto& src : frag)
+			{
+				*dest = *dest ^ src;
+				++dest;
+			}
 		}
 	}
 
@@ -201,33 +370,64 @@ namespace dEnc
         if(ctxt.size() < 4)            
             throw std::runtime_error("ciphertext is too small. " LOCATION);
 
+		ptxt.resize(plaintextSize(ctxt.size()));
+		span<block> frags[] = { ptxt };
+		decrypt(ctxt, frags);
+	}
+
+    template<typename DPRF>
+    void AmmrClient<DPRF>::decrypt(span<const block> ctxt, span<const span<block>> ptxt)
+	{
+		if (ctxt.size() < 4)
+			throw std::runtime_error("ciphertext is too small. " LOCATION);
+
+		u64 size = 0;
+		for (auto& frag : ptxt)
+			size += frag.size();
+
+		if (size != plaintextSize(ctxt.size()))
+			throw std::runtime_error("plaintext buffers have the wrong size. " LOCATION);
+
+		auto version = ciphertextVersion(ctxt[0]);
+		if (version != AmmrVersion::Serial && version != AmmrVersion::Tree)
+			throw std::runtime_error("unknown ciphertext version. " LOCATION);
+
 		//auto& partyID = *(u64*)ctxt.ptxt();
 		auto& alpha = ctxt[1];
 
 		// DPRF eval
 		auto fx = mDprf->eval(alpha);
 
-		// append the preable to the ctxt
-		ptxt.resize(ctxt.size() - 3);
-
-        // expend the DPRF to get a key and 
-		// encrypt the message using counter mode.
-        oc::AES enc(fx);
-        enc.ecbEncCounterMode(1, ptxt);
-
+		// expend the DPRF to get a key and 
+		// decrypt the message using counter mode.
+		oc::AES enc(fx);
 		auto p = enc.ecbEncBlock(oc::ZeroBlock) ^ ctxt[2];
 
+		if (version == AmmrVersion::Tree)
+		{
+			auto alpha2 = treeDecrypt(enc, ctxt.subspan(3), ptxt, p, mThreadPool.get());
+			if (neq(alpha, alpha2))
+				throw std::runtime_error("alpha mismatch" LOCATION);
+			return;
+		}
+
+		oc::RandomOracle H(sizeof(block));
 		auto src = ctxt.begin() + 3;
-		auto dest = ptxt.begin();
-		for (u64 i = 0; i < ptxt.size(); ++i)
+		u64 idx = 1;
+		for (auto& frag : ptxt)
 		{
-			*dest = *dest  ^ *src;
-			++dest;
-			++src;
+			enc.ecbEncCounterMode(idx, frag);
+			idx += frag.size();
+
+			for (auto& dest : frag)
+			{
+				dest = dest ^ *src;
+				++src;
+			}
+
+			H.Update((u8*)frag.data(), frag.size() * sizeof(block));
 		}
 
-        oc::RandomOracle H(sizeof(block));
-		H.Update((u8*)ptxt.data(), ptxt.size() * sizeof(block));
 		H.Update(p);
 		block alpha2;
 		H.Final(alpha2);
@@ -242,6 +442,8 @@ namespace dEnc
 
         if (ctxt.size() < 4)
             throw std::runtime_error("ciphertext is too small. " LOCATION);
+        if (ciphertextVersion(ctxt[0]) != AmmrVersion::Serial)
+            throw std::runtime_error("only the sync decrypt(...) supports this ciphertext version. " LOCATION);
 
         // allocate space for the ptxt.
         ptxt.resize(ctxt.size() - 3);
@@ -317,6 +519,8 @@ namespace dEnc
 		{
             if (ctxts[i].size() < 4)
                 throw std::runtime_error("ciphertext is too small. " LOCATION);
+            if (ciphertextVersion(ctxts[i][0]) != AmmrVersion::Serial)
+                throw std::runtime_error("only the sync decrypt(...) supports this ciphertext version. " LOCATION);
 
             alphas[i] = ctxts[i][1];
             ptxts[i].resize(ctxts[i].size() - 3);
@@ -383,5 +587,7 @@ namespace dEnc
     
     template class AmmrClient<Npr03AsymDprf>;
 
+    template class AmmrClient<Npr03AsymRist255Dprf>;
+
     template class AmmrClient<Npr03SymDprf>;
 }
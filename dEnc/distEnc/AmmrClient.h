@@ -2,9 +2,28 @@
 
 #include <dEnc/Defines.h>
 #include <dEnc/dprf/Dprf.h>
+#include <dEnc/tools/ThreadPool.h>
 #include <cryptoTools/Network/Endpoint.h>
+#include <memory>
 namespace dEnc{
 
+    // The version of a ciphertext, which is stored in the last byte of its
+    // first block next to the index of the party that made it.
+    enum class AmmrVersion : u8
+    {
+        // The commitment is one hash of the message and rho.
+        Serial = 0,
+        // The commitment is a tree hash with leaves of AmmrTreeLeafSize blocks, 
+        // see AmmrClient::setLargeMessageMode(...).
+        Tree = 1
+    };
+
+    // The number of blocks in a leaf of the tree hash, i.e. 256 KiB.
+    const u64 AmmrTreeLeafSize = 1 << 14;
+
+    // The version of the ciphertext whose first block is b.
+    inline AmmrVersion ciphertextVersion(const block& b) { return AmmrVersion(((const u8*)&b)[15]); }
+
 	struct AsyncEncrypt
 	{
 		std::function<void()> get;
@@ -21,6 +40,12 @@ namespace dEnc{
 		u64 mPartyIdx;
 		PRNG mPrng;
 
+        // The threads that large messages are split across, see setLargeMessageMode(...).
+        std::shared_ptr<ThreadPool> mThreadPool;
+
+        // The number of blocks from which encrypt(...) uses the large message mode.
+        u64 mLargeMessageSize = ~0ull;
+
 
         /**
          * Initializes the increction scheme using a pre-initialized
@@ -31,6 +56,30 @@ namespace dEnc{
          */
 		void init(u64 partyIdx, block seed, DPRF* dprf);
 
+        /**
+         * Enables the large message mode for the sync encrypt(...) of messages with
+         * at least minSize blocks. Instead of one serial hash, the commitment alpha 
+         * is a tree hash whose leaves of AmmrTreeLeafSize blocks are hashed keyed 
+         * by rho and their index, and both the leaves and the counter mode are 
+         * split across pool. The ciphertexts have version AmmrVersion::Tree. 
+         * decrypt(...) accepts either version and uses pool for both.
+         * @param[in] pool     - The threads to use, or null to run on the caller.
+         * @param[in] minSize  - The smallest message, in blocks, that uses the mode.
+         */
+        void setLargeMessageMode(std::shared_ptr<ThreadPool> pool, u64 minSize = 4 * AmmrTreeLeafSize);
+
+        /**
+         * The number of blocks of the ciphertext of a plaintext with ptxtSize blocks.
+         * @param[in] ptxtSize - The number of blocks of the plaintext.
+         */
+        static u64 ciphertextSize(u64 ptxtSize) { return ptxtSize + 3; }
+
+        /**
+         * The number of blocks of the plaintext of a ciphertext with ctxtSize blocks.
+         * @param[in] ctxtSize - The number of blocks of the ciphertext.
+         */
+        static u64 plaintextSize(u64 ctxtSize) { return ctxtSize - 3; }
+
         /**
          * Synchonously encrypt the provided data.
          * @param[in] data     - The data to be encrypted.
@@ -38,6 +87,15 @@ namespace dEnc{
          */ 
 		void encrypt(span<block> data, std::vector<block>& ctxt);
 
+        /**
+         * Synchonously encrypt the concatenation of the provided fragments into 
+         * a buffer of the caller, without copying or allocating. 
+         * @param[in] data     - The fragments of the data to be encrypted.
+         * @param[out] ctxt    - The resulting ciphertext, must have ciphertextSize(...) 
+         *                       of the total size of the fragments.
+         */ 
+        void encrypt(span<const span<const block>> data, span<block> ctxt);
+
         /**
          * Asynchonously encrypt the provided data. Returns a completion handle
          * AsyncEncrypt which must have AsyncEncrypt::get() called before the 
@@ -64,6 +122,17 @@ namespace dEnc{
          */
 		void decrypt(span<block> ctxt, std::vector<block>& data);
 
+        /**
+         * Synchonously decrypts ciphtertext into buffers of the caller, without 
+         * copying or allocating. The plaintext is written across the fragments 
+         * in order. If the ciphertext is invalid, the fragments hold the 
+         * unverified plaintext when the exception is thrown.
+         * @param[in] ctxt     - The ciphertext that will be decrypted
+         * @param[out] data    - The fragments that the plaintext will be written to, 
+         *                       whose total size must be plaintextSize(ctxt.size()).
+         */
+        void decrypt(span<const block> ctxt, span<const span<block>> data);
+
         /**
          * Asynchonously decrypts a ciphertext. Returnsa completion handle 
          * AsyncDecrypt which must have AsyncDecrypt::get() called before 
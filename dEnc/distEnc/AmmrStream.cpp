@@ -0,0 +1,212 @@
+#include "AmmrStream.h"
+
+#include "dEnc/dprf/Npr03AsymDprf.h"
+#include "dEnc/dprf/Npr03SymDprf.h"
+#include <array>
+
+namespace dEnc
+{
+    namespace
+    {
+        // Sets dest[i] = src[i] ^ AES_k(baseIdx + i). The keystream is made a few
+        // blocks at a time so that no buffer of the chunk size is needed and dest
+        // may be src.
+        void xorKeystream(const oc::AES& enc, u64 baseIdx, span<const block> src, span<block> dest)
+        {
+            if (src.size() != dest.size())
+                throw std::runtime_error("input and output chunks differ in size. " LOCATION);
+
+            std::array<block, 8> ks;
+            u64 size = src.size();
+            for (u64 i = 0; i < size; i += ks.size())
+            {
+                auto n = std::min<u64>(ks.size(), size - i);
+                enc.ecbEncCounterMode(baseIdx + i, n, ks.data());
+
+                for (u64 j = 0; j < n; ++j)
+                    dest[i + j] = src[i + j] ^ ks[j];
+            }
+        }
+
+        // Returns a keyed hash of the ciphertext chunk that starts at block pos.
+        block chunkTag(const block& key, u64 pos, span<const block> ctxt)
+        {
+            oc::RandomOracle H(sizeof(block));
+            H.Update(key);
+            H.Update(pos);
+            H.Update(u64(ctxt.size()));
+            H.Update((u8*)ctxt.data(), ctxt.size() * sizeof(block));
+
+            block tag;
+            H.Final(tag);
+            return tag;
+        }
+    }
+
+    template<typename DPRF>
+    void AmmrEncryptStream<DPRF>::init(AmmrClient<DPRF>& client)
+    {
+        mClient = &client;
+
+        // Sample randomness rho for the commitment
+        mRho = client.mPrng.template get<block>();
+        mH.Reset(sizeof(block));
+        mSize = 0;
+        mPos = 0;
+        mState = State::Commit;
+    }
+
+    template<typename DPRF>
+    void AmmrEncryptStream<DPRF>::update(span<const block> ptxt)
+    {
+        if (mState != State::Commit)
+            throw std::runtime_error("update(...) must follow init(...). " LOCATION);
+
+        mH.Update((u8*)ptxt.data(), ptxt.size() * sizeof(block));
+        mSize += ptxt.size();
+    }
+
+    template<typename DPRF>
+    void AmmrEncryptStream<DPRF>::final(span<block> header)
+    {
+        if (mState != State::Commit)
+            throw std::runtime_error("final(...) must follow init(...). " LOCATION);
+        if (header.size() != AmmrHeaderSize)
+            throw std::runtime_error("the header must be AmmrHeaderSize blocks. " LOCATION);
+
+        // hash the {message, rho} to get the DPRF input
+        block alpha;
+        mH.Update(mRho);
+        mH.Final(alpha);
+
+        // eval DPRF(x) and expand it to the key
+        mEnc.setKey(mClient->mDprf->eval(alpha));
+
+        header[0] = oc::toBlock(mClient->mPartyIdx);
+        header[1] = alpha;
+        header[2] = mEnc.ecbEncBlock(oc::ZeroBlock) ^ mRho;
+        mState = State::Encrypt;
+    }
+
+    template<typename DPRF>
+    void AmmrEncryptStream<DPRF>::encrypt(span<const block> ptxt, span<block> ctxt)
+    {
+        if (mState != State::Encrypt)
+            throw std::runtime_error("encrypt(...) must follow final(...). " LOCATION);
+        if (mPos + ptxt.size() > mSize)
+            throw std::runtime_error("the message is longer than the one committed to. " LOCATION);
+
+        // block i of the message is encrypted with AES_k(1 + i)
+        xorKeystream(mEnc, 1 + mPos, ptxt, ctxt);
+        mPos += ptxt.size();
+    }
+
+
+    template<typename DPRF>
+    void AmmrDecryptStream<DPRF>::init(AmmrClient<DPRF>& client, span<const block> header)
+    {
+        if (header.size() != AmmrHeaderSize)
+            throw std::runtime_error("the header must be AmmrHeaderSize blocks. " LOCATION);
+        if (ciphertextVersion(header[0]) != AmmrVersion::Serial)
+            throw std::runtime_error("only the sync decrypt(...) supports this ciphertext version. " LOCATION);
+
+        mAlpha = header[1];
+
+        // DPRF eval
+        mEnc.setKey(client.mDprf->eval(mAlpha));
+        mRho = mEnc.ecbEncBlock(oc::ZeroBlock) ^ header[2];
+
+        // The tags must not be computable by whoever stores the ciphertext.
+        mTagKey = client.mPrng.template get<block>();
+        mTags.clear();
+        mChunk = 0;
+
+        mH.Reset(sizeof(block));
+        mSize = 0;
+        mPos = 0;
+        mState = State::Update;
+    }
+
+    template<typename DPRF>
+    void AmmrDecryptStream<DPRF>::update(span<const block> ctxt)
+    {
+        if (mState != State::Update)
+            throw std::runtime_error("update(...) must follow init(...). " LOCATION);
+
+        mTags.push_back(chunkTag(mTagKey, mSize, ctxt));
+
+        std::array<block, 8> ptxt;
+        for (u64 i = 0; i < u64(ctxt.size()); i += ptxt.size())
+        {
+            auto n = std::min<u64>(ptxt.size(), ctxt.size() - i);
+            span<block> dest(ptxt.data(), n);
+            xorKeystream(mEnc, 1 + mSize + i, ctxt.subspan(i, n), dest);
+            mH.Update((u8*)dest.data(), n * sizeof(block));
+        }
+        mSize += ctxt.size();
+    }
+
+    template<typename DPRF>
+    void AmmrDecryptStream<DPRF>::updateUnverified(span<const block> ctxt, span<block> ptxt)
+    {
+        if (mState != State::Update)
+            throw std::runtime_error("updateUnverified(...) must follow init(...). " LOCATION);
+
+        xorKeystream(mEnc, 1 + mSize, ctxt, ptxt);
+        mH.Update((u8*)ptxt.data(), ptxt.size() * sizeof(block));
+        mSize += ctxt.size();
+    }
+
+    template<typename DPRF>
+    void AmmrDecryptStream<DPRF>::final()
+    {
+        if (mState != State::Update)
+            throw std::runtime_error("final() must follow init(...). " LOCATION);
+
+        // same as AmmrClient::decrypt(...), which rejects an empty message.
+        if (mSize == 0)
+            throw std::runtime_error("ciphertext is too small. " LOCATION);
+
+        mH.Update(mRho);
+        block alpha2;
+        mH.Final(alpha2);
+
+        if (neq(mAlpha, alpha2))
+        {
+            mState = State::Uninit;
+            throw std::runtime_error("alpha mismatch" LOCATION);
+        }
+
+        mState = State::Verified;
+    }
+
+    template<typename DPRF>
+    void AmmrDecryptStream<DPRF>::decrypt(span<const block> ctxt, span<block> ptxt)
+    {
+        if (mState != State::Verified)
+            throw std::runtime_error("decrypt(...) must follow a successful final(). " LOCATION);
+        if (mChunk == mTags.size())
+            throw std::runtime_error("the ciphertext has more chunks than the one verified. " LOCATION);
+
+        // The chunk is checked before it is decrypted, since ptxt may be ctxt.
+        if (neq(chunkTag(mTagKey, mPos, ctxt), mTags[mChunk]))
+        {
+            mState = State::Uninit;
+            throw std::runtime_error("the chunk differs from the one verified. " LOCATION);
+        }
+
+        xorKeystream(mEnc, 1 + mPos, ctxt, ptxt);
+        mPos += ctxt.size();
+        ++mChunk;
+    }
+
+
+    template class AmmrEncryptStream<Npr03AsymDprf>;
+    template class AmmrDecryptStream<Npr03AsymDprf>;
+
+    template class AmmrEncryptStream<Npr03AsymRist255Dprf>;
+    template class AmmrDecryptStream<Npr03AsymRist255Dprf>;
+
+    template class AmmrEncryptStream<Npr03SymDprf>;
+    template class AmmrDecryptStream<Npr03SymDprf>;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <dEnc/Defines.h>
+#include "AmmrClient.h"
+#include <cryptoTools/Crypto/AES.h>
+#include <cryptoTools/Crypto/RandomOracle.h>
+
+namespace dEnc {
+
+    // The number of blocks in front of the encrypted message in a ciphertext
+    // of AmmrClient, i.e. [ party index | alpha | AES_k(0) ^ rho ].
+    const u64 AmmrHeaderSize = 3;
+
+    // Encrypts a message chunk by chunk so that it never has to be held in
+    // memory. The commitment alpha covers the whole message and the key is the
+    // DPRF of alpha, and so the message is read twice: once to commit to it
+    // and once to encrypt it. The ciphertext is the header followed by the
+    // encrypted chunks, the same as AmmrClient::encrypt(...) would output.
+    //
+    //   enc.init(client);
+    //   for (auto& chunk : message) enc.update(chunk);
+    //   enc.final(header);
+    //   for (auto& chunk : message) enc.encrypt(chunk, ctxtChunk);
+    template<typename DPRF>
+    class AmmrEncryptStream
+    {
+    public:
+
+        /**
+         * Starts the encryption of a new message.
+         * @param[in] client   - The client whose DPRF and randomness are used.
+         */
+        void init(AmmrClient<DPRF>& client);
+
+        /**
+         * Adds the next chunk of the message to the commitment.
+         * @param[in] ptxt     - The next chunk of the message.
+         */
+        void update(span<const block> ptxt);
+
+        /**
+         * Completes the commitment and evaluates the DPRF on it.
+         * @param[out] header  - The first AmmrHeaderSize blocks of the ciphertext.
+         */
+        void final(span<block> header);
+
+        /**
+         * Encrypts the next chunk of the message. The chunks must be the same
+         * as those passed to update(...), but may be split differently.
+         * @param[in] ptxt     - The next chunk of the message.
+         * @param[out] ctxt    - The encrypted chunk, may be ptxt.
+         */
+        void encrypt(span<const block> ptxt, span<block> ctxt);
+
+    private:
+        enum class State { Uninit, Commit, Encrypt };
+
+        State mState = State::Uninit;
+        AmmrClient<DPRF>* mClient = nullptr;
+        oc::RandomOracle mH;
+        oc::AES mEnc;
+        block mRho;
+
+        // The number of blocks committed to and encrypted.
+        u64 mSize = 0, mPos = 0;
+    };
+
+    // Decrypts a ciphertext of AmmrClient chunk by chunk. The plaintext can
+    // only be checked against alpha once all of it is known, and so by default
+    // the ciphertext is read twice: update(...) checks it without keeping the
+    // plaintext, and once final() succeeds decrypt(...) releases it.
+    //
+    // The ciphertext may be changed by whoever stores it between the two passes.
+    // update(...) therefore also records a tag of each chunk, keyed with a secret
+    // of this stream, and decrypt(...) rejects a chunk that does not match its
+    // tag before releasing any of its plaintext. This costs one block of memory
+    // per chunk, and the chunks of both passes must be split the same way.
+    //
+    //   dec.init(client, header);
+    //   for (auto& chunk : ctxt) dec.update(chunk);
+    //   dec.final();
+    //   for (auto& chunk : ctxt) dec.decrypt(chunk, ptxtChunk);
+    //
+    // If the caller can handle plaintext that turns out to be forged, e.g. by
+    // deleting it when final() throws, updateUnverified(...) releases the
+    // plaintext in a single pass.
+    template<typename DPRF>
+    class AmmrDecryptStream
+    {
+    public:
+
+        /**
+         * Starts the decryption of a new ciphertext and evaluates the DPRF.
+         * @param[in] client   - The client whose DPRF is used.
+         * @param[in] header   - The first AmmrHeaderSize blocks of the ciphertext.
+         */
+        void init(AmmrClient<DPRF>& client, span<const block> header);
+
+        /**
+         * Checks the next chunk of the ciphertext without outputting its plaintext,
+         * and records its tag for decrypt(...).
+         * @param[in] ctxt     - The next chunk of the ciphertext.
+         */
+        void update(span<const block> ctxt);
+
+        /**
+         * Decrypts the next chunk of the ciphertext before it has been checked.
+         * The plaintext must not be trusted until final() returns.
+         * @param[in] ctxt     - The next chunk of the ciphertext.
+         * @param[out] ptxt    - The decrypted chunk, may be ctxt.
+         */
+        void updateUnverified(span<const block> ctxt, span<block> ptxt);
+
+        /**
+         * Checks the chunks passed to update(...) or updateUnverified(...) against
+         * the commitment. Throws if the ciphertext is invalid.
+         */
+        void final();
+
+        /**
+         * Decrypts the next chunk of a ciphertext that final() has checked. The
+         * chunks must be the same as those passed to update(...), split the same 
+         * way. Throws without outputting anything if the chunk differs.
+         * @param[in] ctxt     - The next chunk of the ciphertext.
+         * @param[out] ptxt    - The decrypted chunk, may be ctxt.
+         */
+        void decrypt(span<const block> ctxt, span<block> ptxt);
+
+    private:
+        enum class State { Uninit, Update, Verified };
+
+        State mState = State::Uninit;
+        oc::RandomOracle mH;
+        oc::AES mEnc;
+        block mAlpha, mRho;
+
+        // The number of blocks checked and decrypted.
+        u64 mSize = 0, mPos = 0;
+
+        // The key of the chunk tags, the tag of each chunk passed to update(...),
+        // and the number of chunks decrypted.
+        block mTagKey;
+        std::vector<block> mTags;
+        u64 mChunk = 0;
+    };
+}
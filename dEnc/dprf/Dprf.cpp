@@ -0,0 +1,38 @@
+#include "Dprf.h"
+#include "EvalCoalescer.h"
+#include "dEnc/tools/ThreadPool.h"
+
+namespace dEnc {
+
+    void Dprf::enableCoalescing(u64 maxBatch, std::chrono::microseconds window)
+    {
+        auto coalescer = std::make_shared<EvalCoalescer>(
+            [this](span<block> in) { return asyncEval(in); }, maxBatch, window);
+
+        // asyncEval(block) may concurrently load mCoalescer.
+        auto old = std::atomic_exchange(&mCoalescer, std::move(coalescer));
+        if (old)
+            old->stop();
+    }
+
+    void Dprf::disableCoalescing()
+    {
+        // Callers that already hold the old coalescer have their inputs 
+        // evaluated immediately once it is stopped.
+        auto old = std::atomic_exchange(&mCoalescer, std::shared_ptr<EvalCoalescer>());
+        if (old)
+            old->stop();
+    }
+
+    void Dprf::setThreadPool(std::shared_ptr<ThreadPool> pool)
+    {
+        mThreadPool = std::move(pool);
+    }
+
+    void Dprf::setPartySelection(PartySelector::Policy policy)
+    {
+        mSelectionPolicy = policy;
+        if (mSelector)
+            mSelector->setPolicy(policy);
+    }
+}
@@ -1,8 +1,14 @@
 #pragma once
 
 #include <dEnc/Defines.h>
+#include "PartySelector.h"
+#include <chrono>
+#include <memory>
 namespace dEnc {
 
+    class EvalCoalescer;
+    class ThreadPool;
+
 	struct AsyncEval {
         std::function<std::vector<block>()> get;
         //std::function<void()>destructor;
@@ -37,6 +43,53 @@ namespace dEnc {
 		virtual AsyncEval asyncEval(span<block> input) = 0;
 
 		virtual void close() = 0;
+
+        /**
+         * Opt in to gathering concurrent single input asyncEval(block) calls into 
+         * batched requests of up to maxBatch inputs. An input waits at most window
+         * for other inputs, or until its result is requested.
+         * @param[in] maxBatch - The maximum number of inputs per request.
+         * @param[in] window   - The maximum time an input waits for other inputs.
+         */
+        void enableCoalescing(u64 maxBatch, std::chrono::microseconds window);
+
+        /**
+         * Sends any pending coalesced inputs and stops coalescing.
+         */
+        void disableCoalescing();
+
+        /**
+         * Lets serveOne split large requests across the threads of pool. The
+         * response is sent once every shard is done. Passing nullptr serves
+         * every request on the thread that received it.
+         * @param[in] pool - The worker threads, which may be shared with other instances.
+         */
+        void setThreadPool(std::shared_ptr<ThreadPool> pool);
+
+        /**
+         * Selects how the other parties that each request is sent to are chosen.
+         * The default is PartySelector::Policy::Cyclic, i.e. the next m-1 parties.
+         * @param[in] policy - The selection policy.
+         */
+        void setPartySelection(PartySelector::Policy policy);
+
+        // The per-party statistics that requests are sent by. Valid after init(...).
+        const PartySelector& partySelector() const { return *mSelector; }
+
+    protected:
+        // The coalescer used by asyncEval(block), if coalescing is enabled. 
+        // Only accessed with std::atomic_load/store/exchange.
+        std::shared_ptr<EvalCoalescer> mCoalescer;
+
+        // The threads that serveOne splits large requests across, if any.
+        std::shared_ptr<ThreadPool> mThreadPool;
+
+        // The policy that mSelector is initialized with.
+        PartySelector::Policy mSelectionPolicy = PartySelector::Policy::Cyclic;
+
+        // Chooses the parties that each request is sent to. Created by init(...). 
+        // Shared with the receive callbacks, which report the round trip times.
+        std::shared_ptr<PartySelector> mSelector;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "DprfAuditor.h"
+#include "Npr03AsymDprf.h"
+#include "dEnc/tools/Msm.h"
+#include "cryptoTools/Crypto/RandomOracle.h"
+#include <algorithm>
+#include <cstring>
+
+namespace dEnc {
+
+    template<typename Group>
+    u64 DprfTranscriptT<Group>::sizeBytes() const
+    {
+        Point p;
+        Num z;
+        auto m = mParties.size();
+
+        // [ input | m | parties | output | (share, a1, a2, z) * m ]
+        return sizeof(block) + sizeof(u64) * (1 + m) + p.sizeBytes() * (1 + 3 * m) + z.sizeBytes() * m;
+    }
+
+    template<typename Group>
+    void DprfTranscriptT<Group>::toBytes(u8* dest) const
+    {
+        auto m = mParties.size();
+        if (mShares.size() != m || mA1.size() != m || mA2.size() != m || mZ.size() != m)
+            throw std::runtime_error("malformed transcript. " LOCATION);
+
+        memcpy(dest, &mInput, sizeof(block)); dest += sizeof(block);
+        memcpy(dest, &m, sizeof(u64)); dest += sizeof(u64);
+        memcpy(dest, mParties.data(), m * sizeof(u64)); dest += m * sizeof(u64);
+        mOutput.toBytes(dest); dest += mOutput.sizeBytes();
+
+        for (u64 i = 0; i < m; ++i)
+        {
+            mShares[i].toBytes(dest); dest += mShares[i].sizeBytes();
+            mA1[i].toBytes(dest); dest += mA1[i].sizeBytes();
+            mA2[i].toBytes(dest); dest += mA2[i].sizeBytes();
+            mZ[i].toBytes(dest); dest += mZ[i].sizeBytes();
+        }
+    }
+
+    template<typename Group>
+    void DprfTranscriptT<Group>::fromBytes(span<const u8> src)
+    {
+        u64 m;
+        auto iter = (u8*)src.data();
+        if (src.size() < sizeof(block) + sizeof(u64))
+            throw std::runtime_error("malformed transcript. " LOCATION);
+
+        memcpy(&mInput, iter, sizeof(block)); iter += sizeof(block);
+        memcpy(&m, iter, sizeof(u64)); iter += sizeof(u64);
+
+        // check the size before allocating anything.
+        mParties.resize(0);
+        if (m > src.size())
+            throw std::runtime_error("malformed transcript. " LOCATION);
+        mParties.resize(m);
+        if (sizeBytes() != u64(src.size()))
+            throw std::runtime_error("malformed transcript. " LOCATION);
+
+        memcpy(mParties.data(), iter, m * sizeof(u64)); iter += m * sizeof(u64);
+        mOutput.fromBytes(iter); iter += mOutput.sizeBytes();
+
+        mShares.resize(m);
+        mA1.resize(m);
+        mA2.resize(m);
+        mZ.resize(m);
+        for (u64 i = 0; i < m; ++i)
+        {
+            mShares[i].fromBytes(iter); iter += mShares[i].sizeBytes();
+            mA1[i].fromBytes(iter); iter += mA1[i].sizeBytes();
+            mA2[i].fromBytes(iter); iter += mA2[i].sizeBytes();
+            mZ[i].fromBytes(iter); iter += mZ[i].sizeBytes();
+        }
+    }
+
+    template<typename Group>
+    DprfAuditorT<Group>::DprfAuditorT(u64 m, span<const Point> commits)
+        : mM(m)
+        , mCommits(commits.begin(), commits.end())
+    {
+        if (m == 0 || m > mCommits.size())
+            throw std::runtime_error("bad threshold. " LOCATION);
+    }
+
+    template<typename Group>
+    bool DprfAuditorT<Group>::verify(span<const DprfTranscriptT<Group>> transcripts, span<const block> outputs, PRNG& prng)
+    {
+        if (transcripts.size() != outputs.size())
+            throw std::runtime_error("the number of transcripts and outputs must match. " LOCATION);
+
+        typename Group::Context ctx;
+        auto n = mCommits.size();
+        std::vector<u8> buff(Point().sizeBytes());
+
+        std::vector<Point> points; points.reserve(transcripts.size() * (3 * mM + 2) + n + 1);
+        std::vector<Num> scalars; scalars.reserve(points.capacity());
+
+        // The scalars of g and of each commitment are accumulated across the equations.
+        Num gScalar(0);
+        std::vector<Num> kScalars(n, Num(0));
+        std::vector<u8> seen(n);
+
+        for (u64 j = 0; j < transcripts.size(); ++j)
+        {
+            auto& t = transcripts[j];
+            if (t.mParties.size() != mM || t.mShares.size() != mM ||
+                t.mA1.size() != mM || t.mA2.size() != mM || t.mZ.size() != mM)
+                return false;
+
+            // the parties must be distinct.
+            std::fill(seen.begin(), seen.end(), 0);
+            for (auto p : t.mParties)
+            {
+                if (p >= n || seen[p])
+                    return false;
+                seen[p] = 1;
+            }
+
+            // The output is H(y), which is checked directly. That y is the
+            // interpolation of the shares is part of the multi-scalar multiplication.
+            block h;
+            oc::RandomOracle H(sizeof(block));
+            t.mOutput.toBytes(buff.data());
+            H.Update(buff.data(), buff.size());
+            H.Final(h);
+            if (neq(h, outputs[j]))
+                return false;
+
+            std::string key((char*)t.mParties.data(), t.mParties.size() * sizeof(u64));
+            auto lag = mLagrangeCache.getOrInsert(key, [&]()
+            {
+                return std::make_shared<const std::vector<Num>>(Npr03AsymDprfT<Group>::lagrangeCoefficients(t.mParties));
+            });
+
+            Point v;
+            v.randomize(t.mInput);
+
+            // tau * (SUM_i l_i * share_i - y)
+            Num vScalar(0), tau(prng);
+            for (u64 i = 0; i < mM; ++i)
+            {
+                auto p = t.mParties[i];
+                auto c = Npr03AsymDprfT<Group>::dleqChallenge(mCommits[p], v, t.mShares[i], t.mA1[i], t.mA2[i]);
+                Num rho(prng), sigma(prng);
+
+                //   rho   * (z * g - a1 - c * g^{k_i})
+                // + sigma * (z * v - a2 - c * share_i)
+                gScalar += rho * t.mZ[i];
+                kScalars[p] -= rho * c;
+                vScalar += sigma * t.mZ[i];
+
+                points.push_back(t.mA1[i]); scalars.push_back(-rho);
+                points.push_back(t.mA2[i]); scalars.push_back(-sigma);
+                points.push_back(t.mShares[i]); scalars.push_back(tau * (*lag)[i] - sigma * c);
+            }
+
+            points.push_back(v); scalars.push_back(vScalar);
+            points.push_back(t.mOutput); scalars.push_back(-tau);
+        }
+
+        points.push_back(Group::generator()); scalars.push_back(gScalar);
+        for (u64 p = 0; p < n; ++p)
+        {
+            points.push_back(mCommits[p]);
+            scalars.push_back(kScalars[p]);
+        }
+
+        auto sum = Group::multiScalarMul(points, scalars);
+        return Group::isIdentity(sum);
+    }
+
+    template struct DprfTranscriptT<RelicGroup>;
+    template struct DprfTranscriptT<Rist255Group>;
+    template class DprfAuditorT<RelicGroup>;
+    template class DprfAuditorT<Rist255Group>;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <dEnc/Defines.h>
+#include <cryptoTools/Crypto/RCurve.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include "dEnc/tools/LruCache.h"
+#include "dEnc/tools/Group.h"
+
+namespace dEnc {
+
+    // The evidence that an output of a PublicVarifiable Npr03AsymDprf is
+    // H(H(x)^k) where k is the master key. It holds the output shares of the m
+    // parties that took part in the evaluation, each with a proof that it
+    // matches the published commitment g^{k_i} of its party.
+    template<typename Group>
+    struct DprfTranscriptT
+    {
+        using Num = typename Group::Num;
+        using Point = typename Group::Point;
+
+        // The DPRF input x.
+        block mInput;
+
+        // The indices of the parties whose output shares were combined.
+        std::vector<u64> mParties;
+
+        // The combined output y = H(x)^k, such that the DPRF output is H(y).
+        Point mOutput;
+
+        // mShares[i] = H(x)^{k_i} for party i = mParties[i], and the proof (mA1[i], mA2[i], mZ[i]) that
+        //   mZ[i] * g    = mA1[i] + c_i * g^{k_i}
+        //   mZ[i] * H(x) = mA2[i] + c_i * mShares[i]
+        // where c_i = Npr03AsymDprf::dleqChallenge(g^{k_i}, H(x), mShares[i], mA1[i], mA2[i]).
+        std::vector<Point> mShares, mA1, mA2;
+        std::vector<Num> mZ;
+
+        // The number of bytes that toBytes(...) writes.
+        u64 sizeBytes() const;
+
+        /**
+         * Serializes the transcript.
+         * @param[out] dest  - The sizeBytes() bytes to write to.
+         */
+        void toBytes(u8* dest) const;
+
+        /**
+         * Parses a transcript that was serialized with toBytes(...). Throws if it is malformed.
+         * @param[in] src  - The serialized transcript.
+         */
+        void fromBytes(span<const u8> src);
+    };
+
+    // Checks DPRF outputs against the published commitments of the parties' keys,
+    // without holding any key. This lets any third party audit the outputs of a
+    // PublicVarifiable Npr03AsymDprf.
+    template<typename Group>
+    class DprfAuditorT
+    {
+    public:
+        using Num = typename Group::Num;
+        using Point = typename Group::Point;
+
+        /**
+         * @param[in] m        - The number of parties that take part in an evaluation.
+         * @param[in] commits  - The commitments g^{k_i} to the key shares of all n parties.
+         */
+        DprfAuditorT(u64 m, span<const Point> commits);
+
+        /**
+         * Checks that outputs[j] is the DPRF output for the transcript transcripts[j]
+         * for every j. The equations of all proofs, and that each output is the
+         * interpolation of its shares, are multiplied by random coefficients and
+         * checked to sum to zero with one multi-scalar multiplication. Returns false
+         * if any of the transcripts is invalid.
+         * @param[in] transcripts  - The transcripts.
+         * @param[in] outputs      - The DPRF outputs, one per transcript.
+         * @param[in] prng         - The source of the random coefficients.
+         */
+        bool verify(span<const DprfTranscriptT<Group>> transcripts, span<const block> outputs, PRNG& prng);
+
+    private:
+        u64 mM;
+        std::vector<Point> mCommits;
+
+        // The lagrange coefficients of each quorum, keyed by the party indices.
+        LruCache<std::string, std::shared_ptr<const std::vector<Num>>> mLagrangeCache;
+    };
+
+    using DprfTranscript = DprfTranscriptT<RelicGroup>;
+    using DprfAuditor = DprfAuditorT<RelicGroup>;
+}
\ No newline at end of file
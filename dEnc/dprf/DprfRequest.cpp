@@ -0,0 +1,90 @@
+#include "DprfRequest.h"
+
+namespace dEnc {
+
+    void RequestTrailer::setQuorum(const oc::BitVector& quorum)
+    {
+        mQuorum = quorum;
+        mFlags |= HasQuorum;
+    }
+
+    void RequestTrailer::setWeighted(const oc::BitVector& quorum)
+    {
+        setQuorum(quorum);
+        mFlags |= Weighted;
+    }
+
+    void RequestTrailer::setProofVersion(u8 version)
+    {
+        mProofVersion = version;
+        mFlags |= HasProofVersion;
+    }
+
+    void RequestTrailer::append(std::vector<u8>& dest) const
+    {
+        auto begin = dest.size();
+
+        if (mFlags & HasQuorum)
+            dest.insert(dest.end(), mQuorum.data(), mQuorum.data() + mQuorum.sizeBytes());
+
+        if (mFlags & HasProofVersion)
+            dest.push_back(mProofVersion);
+
+        // flags and length.
+        auto length = dest.size() - begin + 2;
+        if (length % sizeof(block) == 0)
+        {
+            dest.push_back(0);
+            ++length;
+        }
+
+        if (length > 255)
+            throw std::runtime_error("request trailer is too large. " LOCATION);
+
+        dest.push_back(mFlags);
+        dest.push_back(static_cast<u8>(length));
+    }
+
+    bool RequestTrailer::parse(span<u8> request, u64 n, span<block>& inputs, RequestTrailer& trailer)
+    {
+        auto size = request.size();
+        if (size % sizeof(block) == 0)
+        {
+            inputs = span<block>((block*)request.data(), size / sizeof(block));
+            return false;
+        }
+
+        u64 length = request[size - 1];
+        if (length < 2 || length > size || (size - length) % sizeof(block))
+            throw std::runtime_error("malformed request trailer. " LOCATION);
+
+        auto iter = request.data() + size - length;
+        auto end = request.data() + size - 2;
+        inputs = span<block>((block*)request.data(), (size - length) / sizeof(block));
+
+        trailer.mFlags = end[0];
+        if ((trailer.mFlags & Weighted) && (trailer.mFlags & HasQuorum) == 0)
+            throw std::runtime_error("malformed request trailer. " LOCATION);
+
+        if (trailer.mFlags & HasQuorum)
+        {
+            auto bytes = (n + 7) / 8;
+            if (iter + bytes > end)
+                throw std::runtime_error("malformed request trailer. " LOCATION);
+
+            trailer.mQuorum.resize(0);
+            trailer.mQuorum.append(iter, n);
+            iter += bytes;
+        }
+
+        if (trailer.mFlags & HasProofVersion)
+        {
+            if (iter + 1 > end)
+                throw std::runtime_error("malformed request trailer. " LOCATION);
+
+            trailer.mProofVersion = *iter++;
+        }
+
+        return true;
+    }
+}
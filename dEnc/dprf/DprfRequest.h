@@ -0,0 +1,75 @@
+#pragma once
+
+#include <dEnc/Defines.h>
+#include <cryptoTools/Common/BitVector.h>
+
+namespace dEnc {
+
+    // A DPRF evaluation request consists of the 16 byte inputs followed by an
+    // optional trailer with options for the evaluation:
+    //
+    //   [ inputs | quorum | proof version | padding | flags | length ]
+    //
+    // where length is the number of bytes in the trailer, including the flags and
+    // length bytes. A zero byte of padding is added if the length would otherwise
+    // be a multiple of 16, so that a request has a trailer if and only if its size
+    // is not a multiple of 16. Requests without a trailer are the plain list of
+    // inputs that has always been sent.
+    struct RequestTrailer
+    {
+        enum Flags : u8
+        {
+            // The trailer holds a bit vector of the parties taking part in the evaluation.
+            HasQuorum = 1,
+            // The trailer holds the encoding of the proofs that the response should use.
+            HasProofVersion = 2,
+            // The output shares should be weighted by the lagrange coefficient of the 
+            // server for the quorum. Requires HasQuorum.
+            Weighted = 4
+        };
+
+        // The Flags that are set.
+        u8 mFlags = 0;
+
+        // If HasQuorum is set, the i'th bit is set if party i takes part in the evaluation.
+        oc::BitVector mQuorum;
+
+        // If HasProofVersion is set, the requested proof encoding. Its meaning is up to the DPRF.
+        u8 mProofVersion = 0;
+
+        /**
+         * Sets the quorum and the HasQuorum flag.
+         * @param[in] quorum  - A bit vector with one bit per party.
+         */
+        void setQuorum(const oc::BitVector& quorum);
+
+        /**
+         * Sets the quorum and the HasQuorum and Weighted flags.
+         * @param[in] quorum  - A bit vector with one bit per party.
+         */
+        void setWeighted(const oc::BitVector& quorum);
+
+        /**
+         * Sets the requested proof encoding and the HasProofVersion flag.
+         * @param[in] version  - The proof encoding.
+         */
+        void setProofVersion(u8 version);
+
+        /**
+         * Appends the serialized trailer to dest.
+         * @param[in,out] dest  - The request that the trailer is appended to.
+         */
+        void append(std::vector<u8>& dest) const;
+
+        /**
+         * Splits a request into its inputs and trailer. Returns false if the
+         * request has no trailer. Throws if the request is malformed.
+         * @param[in] request   - The request as it was received.
+         * @param[in] n         - The number of parties.
+         * @param[out] inputs   - The inputs of the request.
+         * @param[out] trailer  - The parsed trailer, if there is one.
+         */
+        static bool parse(span<u8> request, u64 n, span<block>& inputs, RequestTrailer& trailer);
+    };
+
+}
@@ -0,0 +1,169 @@
+#include "EvalCoalescer.h"
+#include <algorithm>
+
+namespace dEnc {
+
+    EvalCoalescer::EvalCoalescer(BatchEval eval, u64 maxBatch, std::chrono::microseconds window)
+        : mEval(std::move(eval))
+        , mMaxBatch(std::max<u64>(1, maxBatch))
+        , mWindow(window)
+    {
+        mThread = std::thread([this]() { flushLoop(); });
+    }
+
+    EvalCoalescer::~EvalCoalescer()
+    {
+        stop();
+    }
+
+    AsyncEval EvalCoalescer::add(block input)
+    {
+        std::unique_lock<std::mutex> lock(mMtx);
+
+        // after stop() there is no thread to send the batch.
+        if (mStopped)
+        {
+            lock.unlock();
+            return mEval({ &input, 1 });
+        }
+
+        if (!mCurrent)
+        {
+            mCurrent = std::make_shared<Batch>();
+            mCurrent->mInputs.reserve(mMaxBatch);
+            mDeadline = std::chrono::steady_clock::now() + mWindow;
+            mCv.notify_one();
+        }
+
+        auto batch = mCurrent;
+        auto idx = batch->mInputs.size();
+        batch->mInputs.push_back(input);
+
+        if (batch->mInputs.size() == mMaxBatch)
+        {
+            takeCurrent();
+            lock.unlock();
+            send(batch);
+        }
+        else
+            lock.unlock();
+
+        AsyncEval ae;
+        ae.get = [self = shared_from_this(), batch, idx]()->std::vector<block>
+        {
+            // the result is needed now, don't wait for the window to pass.
+            self->flush(batch);
+
+            // The batch may have been taken by another thread that is still sending it.
+            {
+                std::unique_lock<std::mutex> lock(batch->mMtx);
+                batch->mCv.wait(lock, [&]() { return batch->mSent; });
+            }
+
+            // The first handle to complete receives the results of the
+            // whole batch. The others read their output from it.
+            std::call_once(batch->mOnce, [&]()
+            {
+                if (batch->mError)
+                    return;
+
+                try { batch->mOutputs = batch->mEval.get(); }
+                catch (...) { batch->mError = std::current_exception(); }
+            });
+
+            if (batch->mError)
+                std::rethrow_exception(batch->mError);
+
+            return { batch->mOutputs[idx] };
+        };
+
+        return ae;
+    }
+
+    void EvalCoalescer::flush()
+    {
+        std::unique_lock<std::mutex> lock(mMtx);
+        auto batch = takeCurrent();
+        lock.unlock();
+
+        if (batch)
+            send(batch);
+    }
+
+    void EvalCoalescer::flush(const std::shared_ptr<Batch>& batch)
+    {
+        std::unique_lock<std::mutex> lock(mMtx);
+        if (mCurrent != batch)
+            return;
+
+        takeCurrent();
+        lock.unlock();
+        send(batch);
+    }
+
+    std::shared_ptr<EvalCoalescer::Batch> EvalCoalescer::takeCurrent()
+    {
+        auto batch = std::move(mCurrent);
+        mCurrent.reset();
+        return batch;
+    }
+
+    void EvalCoalescer::send(const std::shared_ptr<Batch>& batch)
+    {
+        // errors are reported by the handles of the batch.
+        AsyncEval eval;
+        std::exception_ptr error;
+        try { eval = mEval(batch->mInputs); }
+        catch (...) { error = std::current_exception(); }
+
+        std::lock_guard<std::mutex> lock(batch->mMtx);
+        batch->mEval = std::move(eval);
+        batch->mError = error;
+        batch->mSent = true;
+        batch->mCv.notify_all();
+    }
+
+    void EvalCoalescer::stop()
+    {
+        std::shared_ptr<Batch> batch;
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            if (mStopped)
+                return;
+
+            mStopped = true;
+            batch = takeCurrent();
+        }
+
+        if (batch)
+            send(batch);
+
+        mCv.notify_one();
+        if (mThread.joinable())
+            mThread.join();
+    }
+
+    void EvalCoalescer::flushLoop()
+    {
+        std::unique_lock<std::mutex> lock(mMtx);
+        while (mStopped == false)
+        {
+            if (!mCurrent)
+            {
+                mCv.wait(lock);
+            }
+            else if (mCv.wait_until(lock, mDeadline) == std::cv_status::timeout && mCurrent)
+            {
+                // A new batch has a later deadline. Only send
+                // the batch once its own window has passed.
+                if (std::chrono::steady_clock::now() >= mDeadline)
+                {
+                    auto batch = takeCurrent();
+                    lock.unlock();
+                    send(batch);
+                    lock.lock();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <dEnc/Defines.h>
+#include "Dprf.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace dEnc {
+
+    // Gathers concurrent single input DPRF evaluations into one batched
+    // evaluation. A batch is sent once it holds maxBatch inputs, once the
+    // window has passed since its first input, or once the result of one of
+    // its inputs is requested, whichever happens first. The batched results
+    // are then handed back to the individual AsyncEval handles.
+    class EvalCoalescer : public std::enable_shared_from_this<EvalCoalescer>
+    {
+    public:
+        // Evaluates the DPRF on a batch of inputs, e.g. Dprf::asyncEval(span<block>).
+        using BatchEval = std::function<AsyncEval(span<block>)>;
+
+        /**
+         * Starts the background thread that sends batches once their window has passed.
+         * @param[in] eval      - The function that evaluates a batch of inputs.
+         * @param[in] maxBatch  - The maximum number of inputs in a batch.
+         * @param[in] window    - The maximum time that an input waits for other inputs.
+         */
+        EvalCoalescer(BatchEval eval, u64 maxBatch, std::chrono::microseconds window);
+
+        ~EvalCoalescer();
+
+        /**
+         * Adds the input to the current batch. The returned handle completes
+         * the evaluation of this input only.
+         * @param[in] input  - The DPRF input.
+         */
+        AsyncEval add(block input);
+
+        /**
+         * Sends the current batch, if any.
+         */
+        void flush();
+
+        /**
+         * Sends the current batch and stops the background thread. Inputs that
+         * are added afterwards are evaluated immediately.
+         */
+        void stop();
+
+    private:
+        struct Batch
+        {
+            std::vector<block> mInputs;
+
+            // The handle of the batched evaluation, set once the batch is sent.
+            AsyncEval mEval;
+
+            // Set and signaled on mCv once mEval or mError has been set. The
+            // batch is sent without holding the mutex of the coalescer.
+            std::mutex mMtx;
+            std::condition_variable mCv;
+            bool mSent = false;
+
+            // The batched result, computed by the first call to get().
+            std::once_flag mOnce;
+            std::vector<block> mOutputs;
+
+            // Set if sending or completing the batch failed.
+            std::exception_ptr mError;
+        };
+
+        // Removes and returns mCurrent, which the caller must send. mMtx must be held.
+        std::shared_ptr<Batch> takeCurrent();
+
+        // Evaluates the batch and wakes up its handles. mMtx must not be held so 
+        // that inputs can be added to the next batch in the meantime.
+        void send(const std::shared_ptr<Batch>& batch);
+
+        // Sends batch if it is still the current one.
+        void flush(const std::shared_ptr<Batch>& batch);
+
+        // The background thread that sends batches when their window has passed.
+        void flushLoop();
+
+        BatchEval mEval;
+        u64 mMaxBatch;
+        std::chrono::microseconds mWindow;
+
+        std::mutex mMtx;
+        std::condition_variable mCv;
+
+        // The batch that inputs are currently added to.
+        std::shared_ptr<Batch> mCurrent;
+
+        // The time at which mCurrent is sent.
+        std::chrono::steady_clock::time_point mDeadline;
+
+        bool mStopped = false;
+        std::thread mThread;
+    };
+
+}
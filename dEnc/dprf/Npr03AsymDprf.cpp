@@ -1,11 +1,20 @@
 #include "Npr03AsymDprf.h"
+#include "EvalCoalescer.h"
+#include "DprfRequest.h"
+#include "dEnc/tools/ThreadPool.h"
+#include "dEnc/tools/Msm.h"
+#include "dEnc/tools/Lagrange.h"
 #include "cryptoTools/Crypto/RandomOracle.h"
 #include "cryptoTools/Common/Matrix.h"
 #include "cryptoTools/Common/Log.h"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
 
 namespace dEnc
 {
-    Npr03AsymDprf::~Npr03AsymDprf()
+    template<typename Group>
+    Npr03AsymDprfT<Group>::~Npr03AsymDprfT()
     {
         close();
 
@@ -14,43 +23,38 @@ namespace dEnc
     }
 
 
-    std::function<Npr03AsymDprf::Num(u64 i)> Npr03AsymDprf::interpolate(span<Num> fx, span<Num> xi)
+    template<typename Group>
+    std::function<typename Npr03AsymDprfT<Group>::Num(u64 i)> Npr03AsymDprfT<Group>::interpolate(span<Num> fx, span<Num> xi)
     {
-        std::vector<Num> fxx(fx.begin(), fx.end());
-        std::vector<Num> xxi(xi.begin(), xi.end());
+        if (fx.size() != xi.size())
+            throw std::runtime_error("the number of points and values must match. " LOCATION);
 
+        // The degree m-1 polynomial L(x) such that L(x_i) = fx[i] in barycentric form
+        //    L(x) = \sum_i   fx[i] * w_i * \prod_{j != i} (x - x_j)
+        // where w_i = 1 / \prod_{j != i} (x_i - x_j) is computed once.
+        std::vector<Num> xxi(xi.begin(), xi.end());
+        auto fxw = barycentricWeights<Group>(xxi);
+        for (u64 i = 0; i < fxw.size(); ++i)
+            fxw[i] *= fx[i];
 
-        auto L = [fxx, xxi](u64 xx)
+        auto L = [fxw, xxi](u64 xx)
         {
-            auto m = fxx.size();
-            Num ret(0);
-            Num x(xx);
-
-            // Now compute the degree m-1 lagrange polynomial L(x) such that
-            //       L(i) = fx[i]   for i \in {0,...,m}
-
-            // The formula is
-            //    L(x) = \sum_{i=0,...,m}   fx[i] * l_i(x)
-            // where
-            //    l_i(x) = \prod_{m=0,...,m;  m!=i}   (x - x_i) / (x_i - x_j)
-            //           = \prod_{m=0,...,m;  m!=i}   (x - i) / (i - j)     since x_i = i
-            std::vector<std::function<Num(const Num&)>> l(m);
-
-            Num one(1);
+            typename Group::Context ctx;
+            auto m = fxw.size();
+            Num x = Num(i32(xx));
+
+            // suffix[i] = \prod_{j >= i} (x - x_j), so that the products 
+            // without x_i take two multiplications each and no divisions.
+            std::vector<Num> suffix(m + 1);
+            suffix[m] = 1;
+            for (u64 i = m; i-- > 0;)
+                suffix[i] = suffix[i + 1] * (x - xxi[i]);
+
+            Num ret(0), prefix(1);
             for (u64 i = 0; i < m; ++i)
             {
-                //l[i] = [&,i](const Num& x)
-                //{
-                Num l_i(1);
-
-                for (u64 j = 0; j < m; ++j)
-                    if (j != i)
-                        l_i *= (x - xxi[j]) / (xxi[i] - xxi[j]);
-
-                //return l_i;
-                //};
-
-                ret += fxx[i] * l_i;// l[i](x);
+                ret += fxw[i] * prefix * suffix[i + 1];
+                prefix *= x - xxi[i];
             }
             return ret;
         };
@@ -58,7 +62,8 @@ namespace dEnc
         return L;
     }
 
-    std::function<Npr03AsymDprf::Num(u64 i)> Npr03AsymDprf::interpolate(span<Num> fx)
+    template<typename Group>
+    std::function<typename Npr03AsymDprfT<Group>::Num(u64 i)> Npr03AsymDprfT<Group>::interpolate(span<Num> fx)
     {
         std::vector<Num> xi; xi.reserve(fx.size());
         for (u64 i = 0; i < fx.size(); ++i)
@@ -69,45 +74,326 @@ namespace dEnc
 
 
 
-    void Npr03AsymDprf::MasterKey::KeyGen(u64 n, u64 m, PRNG & prng, Type type)
+    template<typename Group>
+    std::vector<typename Npr03AsymDprfT<Group>::Num> Npr03AsymDprfT<Group>::lagrangeCoefficients(span<const u64> parties)
+    {
+        // The key share of party p is the key polynomial at x_p = p + 1. 
+        // The master key is interpolated at zero with the coefficients
+        //    l_i = \prod_{j != i}   x_j / (x_j - x_i)
+        std::vector<Num> xi(parties.size());
+        for (u64 i = 0; i < parties.size(); ++i)
+            xi[i] = i32(parties[i] + 1);
+
+        return lagrangeAtZero<Group>(xi);
+    }
+
+    template<typename Group>
+    std::shared_ptr<const std::vector<typename Npr03AsymDprfT<Group>::Num>> Npr03AsymDprfT<Group>::getLagrange(span<const u64> parties)
+    {
+        // The coefficients do not depend on the order of the parties.
+        oc::BitVector quorum(mN);
+        for (auto p : parties)
+            quorum[p] = true;
+
+        auto byParty = getLagrange(quorum);
+        auto ret = std::make_shared<std::vector<Num>>(parties.size());
+        for (u64 i = 0; i < parties.size(); ++i)
+            (*ret)[i] = (*byParty)[parties[i]];
+        return ret;
+    }
+
+    template<typename Group>
+    std::shared_ptr<const std::vector<typename Npr03AsymDprfT<Group>::Num>> Npr03AsymDprfT<Group>::getLagrange(const oc::BitVector& quorum)
+    {
+        // The coefficients are cached by quorum, indexed by party.
+        std::string key((char*)quorum.data(), quorum.sizeBytes());
+        return mLagrangeCache.getOrInsert(key, [&]()
+        {
+            std::vector<u64> sorted;
+            for (u64 p = 0; p < mN; ++p)
+                if (quorum[p])
+                    sorted.push_back(p);
+            auto lag = lagrangeCoefficients(sorted);
+
+            auto ret = std::make_shared<std::vector<Num>>(mN, Num(0));
+            for (u64 i = 0; i < sorted.size(); ++i)
+                (*ret)[sorted[i]] = lag[i];
+            return std::shared_ptr<const std::vector<Num>>(std::move(ret));
+        });
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::setHedge(u64 extra)
+    {
+        if (mM - 1 + extra > mN - 1)
+            throw std::runtime_error("can not contact more parties than there are. " LOCATION);
+
+        mHedge = extra;
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::setServerWeighting(bool enabled)
+    {
+        if (enabled && mType != Type::SemiHonest)
+            throw std::runtime_error("the parties can only weight their output shares in semi-honest mode. " LOCATION);
+
+        mServerWeighting = enabled;
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::setClientThreadPool(std::shared_ptr<ThreadPool> pool)
+    {
+        mClientPool = std::move(pool);
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::clientFor(u64 n, const std::function<void(u64 begin, u64 end)>& fn) const
+    {
+        auto numShards = mClientPool ?
+            std::min<u64>(mClientPool->numThreads(), n / mMinShardSize) : 1;
+
+        if (numShards < 2)
+            fn(0, n);
+        else
+        {
+            mClientPool->parallelFor(n, numShards, [&](u64 begin, u64 end)
+            {
+                // sets up the group on the worker thread.
+                typename Group::Context ctx;
+                fn(begin, end);
+            });
+        }
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::setProofEncoding(ProofEncoding encoding)
+    {
+        for (u64 i = 0; i < mN; ++i)
+            if (i != u64(mPartyIdx))
+                setProofEncoding(i, encoding);
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::setProofEncoding(u64 partyIdx, ProofEncoding encoding)
+    {
+        if (partyIdx >= mProofEncodings.size())
+            throw std::runtime_error("bad party index. " LOCATION);
+        if (encoding > ProofEncoding::Full)
+            throw std::runtime_error("unknown proof encoding. " LOCATION);
+
+        mProofEncodings[partyIdx] = encoding;
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::setNoncePool(u64 capacity, u64 lowWatermark)
     {
-        oc::REllipticCurve curve;
+        if (capacity)
+            mNoncePool.start(mGenTable, capacity, lowWatermark, mPrng.get<block>());
+        else
+            mNoncePool.stop();
+    }
 
-        // gnerate m random points wich will define our m-1 degree polynomial
-        std::vector<Num> fx(m);
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::nonce(PRNG& prng, Num& r, Point& a1)
+    {
+        if (mNoncePool.tryTake(r, a1))
+            return;
+
+        r.randomize(prng);
+        mGenTable.mul(r, a1);
+    }
+
+    template<typename Group>
+    u64 Npr03AsymDprfT<Group>::responseSize(ProofEncoding encoding) const
+    {
+        u64 pointSize = mGen.sizeBytes();
+        u64 numSize = mSk.sizeBytes();
+
+        if (mType == Type::SemiHonest)
+            return pointSize;
+
+        switch (encoding)
+        {
+        case ProofEncoding::Legacy:
+        case ProofEncoding::Full:
+            return pointSize * 3 + numSize;
+        case ProofEncoding::Compact:
+            return pointSize + 2 * numSize;
+        case ProofEncoding::Batch:
+            return pointSize;
+        default:
+            throw std::runtime_error("unknown proof encoding. " LOCATION);
+        }
+    }
+
+    template<typename Group>
+    u64 Npr03AsymDprfT<Group>::responseTail(ProofEncoding encoding) const
+    {
+        if (mType == Type::SemiHonest || encoding == ProofEncoding::Legacy)
+            return 0;
+
+        return 1 + (encoding == ProofEncoding::Batch) * 2 * mSk.sizeBytes();
+    }
+
+    template<typename Group>
+    typename Npr03AsymDprfT<Group>::Num Npr03AsymDprfT<Group>::dleqChallenge(const Point& gk, const Point& v, const Point& vk, const Point& a1, const Point& a2)
+    {
+        Num c;
+        std::vector<u8> buff;
+        dleqChallenge(gk, v, vk, a1, a2, c, buff);
+        return c;
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::dleqChallenge(const Point& gk, const Point& v, const Point& vk, const Point& a1, const Point& a2, Num& c, std::vector<u8>& buff)
+    {
+        // c = H(g^k, v, v^k, a1, a2). The generator is fixed and not hashed.
+        const Point* points[] = { &gk, &v, &vk, &a1, &a2 };
+        buff.resize(gk.sizeBytes());
+
+        oc::RandomOracle ro(sizeof(block));
+        for (auto p : points)
+        {
+            p->toBytes(buff.data());
+            ro.Update(buff.data(), buff.size());
+        }
+
+        block challenge;
+        ro.Final(challenge);
+        c.randomize(challenge);
+    }
+
+    template<typename Group>
+    std::vector<typename Npr03AsymDprfT<Group>::Num> Npr03AsymDprfT<Group>::batchCoefficients(const Point& gk, span<const Point> v, span<const Point> vk)
+    {
+        if (v.size() != vk.size())
+            throw std::runtime_error("the number of inputs and outputs must match. " LOCATION);
+
+        // The coefficients are fixed by the outputs so that the prover 
+        // can not choose outputs whose errors cancel in V and Y.
+        std::vector<u8> buff(gk.sizeBytes());
+        oc::RandomOracle ro(sizeof(block));
+        auto update = [&](const Point& p)
+        {
+            p.toBytes(buff.data());
+            ro.Update(buff.data(), buff.size());
+        };
+
+        update(gk);
+        for (auto& p : v) update(p);
+        for (auto& p : vk) update(p);
+
+        block seed;
+        ro.Final(seed);
+        PRNG prng(seed);
+
+        std::vector<Num> e; e.reserve(v.size());
+        for (u64 j = 0; j < v.size(); ++j)
+            e.emplace_back(prng);
+        return e;
+    }
+
+    template<typename Group>
+    typename Npr03AsymDprfT<Group>::Num Npr03AsymDprfT<Group>::proveDleq(const Point& v, const Point& vk, PRNG& prng, Point& a1, Point& a2, Num& z)
+    {
+        // The Fiat-Shamir proof that log_g(g^sk) = log_v(vk), where the 
+        // challenge is a hash of the statement and the commitments a1, a2.
+        ServeScratch s;
+        proveDleq(v, vk, prng, s);
+        a1 = s.a1;
+        a2 = s.a2;
+        z = s.z;
+        return s.c;
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::proveDleq(const Point& v, const Point& vk, PRNG& prng, ServeScratch& s)
+    {
+        // The operations are in place so that no point or number is constructed.
+        nonce(prng, s.r, s.a1);
+        s.a2 = v;
+        s.a2 *= s.r;
+        dleqChallenge(mGSks[mPartyIdx], v, vk, s.a1, s.a2, s.c, s.buff);
+        s.z = mSk;
+        s.z *= s.c;
+        s.z += s.r;
+    }
+
+    template<typename Group>
+    bool Npr03AsymDprfT<Group>::ServeScratch::reserve(u64 numInputs, u64 numShards)
+    {
+        // The storage only grows so that it fits the largest request so far.
+        bool grew = false;
+        if (batchV.size() < numInputs)
+        {
+            batchV.resize(numInputs);
+            batchVk.resize(numInputs);
+            grew = true;
+        }
+        if (seeds.size() < numShards)
+        {
+            seeds.resize(numShards);
+            grew = true;
+        }
+        return grew;
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::proveBatch(span<const Point> v, span<const Point> vk, span<u8> dest, PRNG& prng)
+    {
+        auto& gk = mGSks[mPartyIdx];
+        auto e = batchCoefficients(gk, v, vk);
+
+        // Y = SUM_j e_j * vk[j] = V * sk.
+        auto V = Group::multiScalarMul(v, e);
+        auto Y = V * mSk;
+
+        Point a1, a2;
+        Num z;
+        auto c = proveDleq(V, Y, prng, a1, a2, z);
+
+        auto iter = dest.data();
+        c.toBytes(iter); iter += c.sizeBytes();
+        z.toBytes(iter);
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::MasterKey::KeyGen(u64 n, u64 m, PRNG & prng, Type type)
+    {
+        typename Group::Context ctx;
+
+        // gnerate the m random coefficients of our m-1 degree polynomial
+        std::vector<Num> coeffs(m);
         for (u64 i = 0; i < m; ++i)
-            fx[i].randomize(prng);
+            coeffs[i].randomize(prng);
 
-        // interpolate these points. The 
-        mKeyPoly = interpolate(fx);
+        mKeyPoly = [coeffs](u64 i)
+        {
+            return hornerEval<Group>(coeffs, Num(i32(i)));
+        };
 
         // The master key is the polynomial at zero.
-        mMasterKey = fx[0] /* == mKeyPoly(0) */;
+        mMasterKey = coeffs[0] /* == mKeyPoly(0) */;
 
         // The key shars are the polynomial at 1, 2, ..., n
         mKeyShares.resize(n);
         for (u64 i = 0; i < n; ++i)
-        {
-            mKeyShares[i] = mKeyPoly(i + 1);
-            //std::cout << "sk[" << i << "] " << mKeyShares[i] << std::endl;
-        }
+            mKeyShares[i] = hornerEval<Group>(coeffs, Num(i32(i + 1)));
 
-        // For malicious security, we need to compute
-        if (type == Type::Malicious)
+        // For malicious security and public verifiability, we need to 
+        // compute the commitments g^{k_i} to the key shares.
+        if (type != Type::SemiHonest)
         {
-            auto gen = curve.getGenerator();
+            typename Group::FixedBase gen(Group::generator());
             mCommits.resize(n);
             for (u64 i = 0; i < n; ++i)
-                mCommits[i] = gen * mKeyShares[i];
+                mCommits[i] = gen.mul(mKeyShares[i]);
 
         }
-        else if (type == Type::PublicVarifiable)
-        {
-            throw std::runtime_error("PublicVarifiable is not implemented. " LOCATION);
-        }
     }
 
-    void Npr03AsymDprf::init(
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::init(
         u64 partyIdx,
         u64 m,
         span<Channel> requestChls,
@@ -125,7 +411,7 @@ namespace dEnc
         mIsClosed = false;
 
         // Make sure gSks is the right size 
-        if (gSks.size() != mN * (type == Type::Malicious))
+        if (gSks.size() != mN * (type != Type::SemiHonest))
             throw std::runtime_error("Commitments to the secret keys is required for malicious security. " LOCATION);
 
         mRequestChls = { requestChls.begin(), requestChls.end() };
@@ -138,82 +424,207 @@ namespace dEnc
         mGSks = { gSks.begin(), gSks.end() };
 
         // Take a copy of the generator
-        oc::REllipticCurve curve;
-        mGen = curve.getGenerator();
-
-        // Precompute the lagrange interpolation coefficients
-        mDefaultLag.resize(mM);
-
-        // pre compute a vector containing { mPartyIdx + 1, mPartyIdx + 2, ..., mPartyIdx + m}
-        std::vector<Num> xi(mM);
-        for (u64 i = 0, j = mPartyIdx; i < mM; ++i, ++j)
-            xi[i] = j % mN + 1;
-
-
+        typename Group::Context ctx;
+        mGen = Group::generator();
+
+        // Precompute the tables for the fixed base multiplications of the 
+        // proofs, i.e. by the generator and by the commitments.
+        mGenTable.init(mGen);
+        mGSkTables.resize(mGSks.size());
+        for (u64 i = 0; i < mGSks.size(); ++i)
+            mGSkTables[i].init(mGSks[i]);
+
+        // Precompute the lagrange interpolation coefficients for 
+        // the default parties { mPartyIdx, mPartyIdx + 1, ..., mPartyIdx + m - 1}.
         // mDefaultLag[i] will hold the lagrange coefficient to use
-        // with party i.
-        for (i64 i = 0; i < mM; ++i)
-        {
-            auto& l_i = mDefaultLag[i];
+        // with party mPartyIdx + i.
+        std::vector<u64> parties(mM);
+        for (u64 i = 0; i < mM; ++i)
+            parties[i] = (mPartyIdx + i) % mN;
+        mDefaultLag = lagrangeCoefficients(parties);
 
-            l_i = 1;
-            for (u64 j = 0; j < m; ++j)
-                if (j != i) l_i *= xi[j] / (xi[j] - xi[i]);
-        }
-
-        // cache some values that will be used as temporary storage
-        mTempPoints.resize(6);
-        mTempNums.resize(6);
+        mSelector = std::make_shared<PartySelector>(mN, mPartyIdx, mSelectionPolicy, mPrng.get<block>());
+        mProofEncodings.assign(mN, ProofEncoding::Legacy);
+        mClientPrng.SetSeed(mPrng.get<block>());
 
         // Start the service that listens to OPRF evaluations requests 
         // from the other parties.
         startListening();
     }
 
-    void Npr03AsymDprf::serveOne(span<u8> request, u64 outputPartyIdx)
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::serveOne(span<u8> request, u64 outputPartyIdx)
     {
-        oc::REllipticCurve curve;
-        int pointSize = mGen.sizeBytes();
-        int numSize = mSk.sizeBytes();
+        typename Group::Context ctx;
+
+        // Split off the trailer, which may request a proof encoding.
+        span<block> inputs;
+        RequestTrailer trailer;
+        RequestTrailer::parse(request, mN, inputs, trailer);
+
+        auto encoding = ProofEncoding::Legacy;
+        if (mType != Type::SemiHonest && (trailer.mFlags & RequestTrailer::HasProofVersion))
+        {
+            if (trailer.mProofVersion > u8(ProofEncoding::Full))
+                throw std::runtime_error("unknown proof encoding. " LOCATION);
+
+            encoding = ProofEncoding(trailer.mProofVersion);
+        }
+
+        // The output shares can be asked to be weighted by the lagrange 
+        // coefficient of this party for the quorum, see setServerWeighting(...).
+        Num weightedSk;
+        bool weighted = (trailer.mFlags & RequestTrailer::Weighted) != 0;
+        if (weighted)
+        {
+            // compute the partyIdx of the requester based on the channel idx.
+            auto requester = outputPartyIdx + (outputPartyIdx >= u64(mPartyIdx));
 
+            auto& quorum = trailer.mQuorum;
+            if (mType != Type::SemiHonest)
+                throw std::runtime_error("weighted output shares require the SemiHonest type. " LOCATION);
+            if (quorum[requester] == 0 || quorum[mPartyIdx] == 0 || quorum.hammingWeight() != mM)
+                throw std::runtime_error("invalid quorum. " LOCATION);
+
+            weightedSk = (*getLagrange(quorum))[mPartyIdx] * mSk;
+        }
 
-        // Make sure that the requests are a 
-        if (request.size() % sizeof(block))
-            throw std::runtime_error(LOCATION);
+        auto numRequests = inputs.size();
+        auto sizePer = responseSize(encoding);
 
-        auto numRequests = request.size() / sizeof(block);
+        // Responses other than Legacy end with the version byte so that 
+        // the client can check that its request was understood.
+        auto tail = responseTail(encoding);
+        std::vector<u8> response(numRequests * sizePer + tail);
+        if (tail)
+            response.back() = u8(encoding);
 
-        auto sizePer = (mType != Type::SemiHonest) ?
-            pointSize * 3 + numSize :
-            pointSize;
+        auto numShards = mThreadPool ? 
+            std::min<u64>(mThreadPool->numThreads(), numRequests / mMinShardSize) : 1;
 
-        std::vector<u8> response(numRequests * sizePer);
+        // The batch proof is over every input and output, which are kept until 
+        // it is made. They and the seeds of the shards live in the scratch of
+        // the request, whose storage is reused by later requests.
+        auto req = mScratchPool.acquire();
+        if (req->reserve(encoding == ProofEncoding::Batch ? numRequests : 0, numShards))
+            mScratchPool.countGrowth();
 
-        auto sIter = (block*)request.data();
-        auto dIter = response.data();
+        auto sIter = inputs.data();
+        auto serveAt = [&](u64 i, PRNG& prng, ServeScratch& s)
+        {
+            span<u8> dest(response.data() + i * sizePer, sizePer);
+            if (encoding == ProofEncoding::Batch)
+            {
+                auto& v = req->batchV[i];
+                auto& vk = req->batchVk[i];
+                v.randomize(sIter[i]);
+                vk = v;
+                vk *= mSk;
+                vk.toBytes(dest.data());
+            }
+            else if (weighted)
+            {
+                auto& v = s.v;
+                v.randomize(sIter[i]);
+                v *= weightedSk;
+                v.toBytes(dest.data());
+            }
+            else
+                serveInput(sIter[i], dest, prng, encoding, s);
+        };
 
-        for (u64 i = 0; i < numRequests; ++i)
+        if (numShards < 2)
         {
-            serveOne(sIter[i], span<u8>(dIter, sizePer), outputPartyIdx);
+            for (u64 i = 0; i < numRequests; ++i)
+                serveAt(i, mPrng, *req);
+        }
+        else
+        {
+            // mPrng is not thread safe. Each shard gets its own PRNG.
+            auto& seeds = req->seeds;
+            mPrng.get(seeds.data(), numShards);
+
+            // Each shard serializes the responses of its slice of the inputs.
+            mThreadPool->parallelFor(numShards, numShards, [&](u64 begin, u64 end)
+            {
+                // sets up the group on the worker thread.
+                typename Group::Context ctx;
+                auto s = mScratchPool.acquire();
 
-            dIter += sizePer;
+                for (auto shard = begin; shard < end; ++shard)
+                {
+                    s->prng.SetSeed(seeds[shard]);
+                    auto iBegin = numRequests * shard / numShards;
+                    auto iEnd = numRequests * (shard + 1) / numShards;
+                    for (auto i = iBegin; i < iEnd; ++i)
+                        serveAt(i, s->prng, *s);
+                }
+            });
         }
 
+        if (encoding == ProofEncoding::Batch)
+            proveBatch(
+                span<const Point>(req->batchV.data(), numRequests), 
+                span<const Point>(req->batchVk.data(), numRequests), 
+                span<u8>(response.data() + numRequests * sizePer, tail - 1), mPrng);
+
+        // send the response once every shard is done.
         mListenChls[outputPartyIdx].asyncSend(std::move(response));
     }
 
-    void Npr03AsymDprf::serveOne(block in, span<u8> dest, u64 outputPartyIdx)
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::serveOne(block in, span<u8> dest, u64 outputPartyIdx)
+    {
+        serveOne(in, dest, outputPartyIdx, mPrng);
+    }
+
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::serveOne(block in, span<u8> dest, u64 outputPartyIdx, PRNG& prng, ProofEncoding encoding)
     {
-        oc::REllipticCurve curve;
+        // also sets up the group when called on a thread pool worker.
+        typename Group::Context ctx;
+        auto s = mScratchPool.acquire();
+        serveInput(in, dest, prng, encoding, *s);
+    }
 
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::serveInput(block in, span<u8> dest, PRNG& prng, ProofEncoding encoding, ServeScratch& s)
+    {
         // hash the input to a random point
-        oc::REccPoint v;
+        auto& v = s.v;
         v.randomize(in);
 
-        if (mType != Type::SemiHonest)
+        if (mType != Type::SemiHonest && encoding == ProofEncoding::Compact)
+        {
+            auto& vk = s.vk;
+            vk = v;
+            vk *= mSk;
+            proveDleq(v, vk, prng, s);
+
+            // serialize the output and proof
+            auto iter = dest.data();
+            vk.toBytes(iter);  iter += vk.sizeBytes();
+            s.c.toBytes(iter); iter += s.c.sizeBytes();
+            s.z.toBytes(iter); iter += s.z.sizeBytes();
+        }
+        else if (mType != Type::SemiHonest && encoding == ProofEncoding::Full)
+        {
+            auto& vk = s.vk;
+            vk = v;
+            vk *= mSk;
+            proveDleq(v, vk, prng, s);
+
+            // serialize the output and proof
+            auto iter = dest.data();
+            vk.toBytes(iter);   iter += vk.sizeBytes();
+            s.a1.toBytes(iter); iter += s.a1.sizeBytes();
+            s.a2.toBytes(iter); iter += s.a2.sizeBytes();
+            s.z.toBytes(iter);  iter += s.z.sizeBytes();
+        }
+        else if (mType != Type::SemiHonest)
         {
             // compute the challenge by hashing the input.
-            Num c;
+            auto& c = s.c;
             oc::RandomOracle ro(sizeof(block));
             ro.Update(in ^ oc::AllOneBlock);
             block challenge;
@@ -223,10 +634,16 @@ namespace dEnc
 
             // compute the zero knowledge proof with respect to c
 
-            Num r(mPrng);
-            auto a1 = mGen * r;
-            auto a2 = v * r;
-            auto z = r + mSk * c;
+            auto& r = s.r;
+            auto& a1 = s.a1;
+            auto& a2 = s.a2;
+            auto& z = s.z;
+            nonce(prng, r, a1);
+            a2 = v;
+            a2 *= r;
+            z = mSk;
+            z *= c;
+            z += r;
 
             // Compute the output share
             v *= mSk;
@@ -247,29 +664,37 @@ namespace dEnc
         }
     }
 
-    block Npr03AsymDprf::eval(block input)
+    template<typename Group>
+    block Npr03AsymDprfT<Group>::eval(block input)
     {
         return asyncEval(input).get()[0];
     }
 
-    AsyncEval Npr03AsymDprf::asyncEval(block input)
+    template<typename Group>
+    AsyncEval Npr03AsymDprfT<Group>::asyncEval(block input)
     {
+        // Gather concurrent single evaluations into one request.
+        auto coalescer = std::atomic_load(&mCoalescer);
+        if (coalescer)
+            return coalescer->add(input);
+
         return asyncEval({ &input, 1 });
     }
 
     // A struct that holds some intermidiate values using the async operation
-    struct Workspace
+    template<typename Group>
+    struct Npr03AsymDprfT<Group>::Workspace
     {
         // An instance of a single evaluation
         struct W {
             // The input point
-            oc::REccPoint v;
+            Point v;
 
-            // The output share
-            oc::REccPoint y;
+            // The DPRF output, interpolated from the output shares.
+            Point y;
 
             // The challenge 
-            oc::REccNumber c;
+            Num c;
         };
 
         // a vector to hold the temps for many (concurrent)
@@ -286,158 +711,668 @@ namespace dEnc
             w.resize(n);
         }
 
-        // a buffer to receive the DPRF output shares into.
-        oc::Matrix<u8> buff2;
+        // A receive that fails does not call its callback. Any contacted party 
+        // that has not been settled by the time the workspace is released, i.e. 
+        // once every receive has completed or failed, is reported as failed.
+        ~Workspace()
+        {
+            for (u64 k = 0; k < numSent; ++k)
+                if (settle(k))
+                    selector->onFailure(parties[k]);
+        }
+
+        // Returns true the first time it is called for the k'th contacted party, 
+        // which is then reported to the selector exactly once.
+        bool settle(u64 k)
+        {
+            return settled[k].exchange(true) == false;
+        }
+
+        // The index of each party that was sent the request, in the 
+        // order they were contacted.
+        std::vector<u64> parties;
+
+        // The proof encoding requested from each contacted party.
+        std::vector<ProofEncoding> encodings;
+
+        // If the first m-1 contacted parties weight their output shares 
+        // by the lagrange coefficients in lag.
+        bool weighted = false;
+
+        // The inputs, which are only kept if transcripts are requested.
+        std::vector<block> inputs;
+
+        // The lagrange coefficients for this party and the first m-1 parties.
+        std::shared_ptr<const std::vector<Num>> lag;
+
+        // buffers to receive the DPRF output shares into, one per party.
+        std::vector<std::vector<u8>> buff2;
 
         // a set of futures that will be fulfilled when the 
         // DPRF output shares have arrived.
         std::vector<std::future<void>> asyncs;
+
+        // The selector that the contacted parties are reported to, the number 
+        // of parties it was told the request was sent to, and which of them 
+        // have since been reported as responded or failed.
+        std::shared_ptr<PartySelector> selector;
+        u64 numSent = 0;
+        std::unique_ptr<std::atomic<bool>[]> settled;
+
+        // The number of responses that have arrived so far. 
+        // Signaled on cv whenever a response arrives.
+        std::mutex mtx;
+        std::condition_variable cv;
+        u64 arrivals = 0;
     };
 
-    AsyncEval Npr03AsymDprf::asyncEval(span<block> in)
+    // The output shares that one party sent for every input of 
+    // a request, and in malicious mode the proofs for them.
+    template<typename Group>
+    struct Npr03AsymDprfT<Group>::Response
     {
-        // create a shared copy of the input and send it to the other
-        // parties as the OPRF input.
-        auto sendBuff = std::make_shared<std::vector<block>>(in.begin(), in.end());
-        for (u64 i = 1, j = mPartyIdx; i < mM; ++i, ++j)
+        // The index of the party in Workspace::parties.
+        u64 k;
+
+        // The encoding of the proofs.
+        ProofEncoding encoding;
+
+        // vk[i] = v_i * sk, and the proof (a1[i], a2[i], z[i]) that 
+        //   z[i] * g   = a1[i] + c_i * g^sk
+        //   z[i] * v_i = a2[i] + c_i * vk[i].
+        // Compact proofs hold c[i] = dleqChallenge(g^sk, v_i, vk[i], a1[i], a2[i])
+        // instead of a1[i] and a2[i]. Batch proofs hold one (c[0], z[0]) for 
+        // V = SUM_i e_i * v_i and Y = SUM_i e_i * vk[i], see batchCoefficients(...).
+        std::vector<Point> vk, a1, a2;
+        std::vector<Num> c, z;
+    };
+
+    template<typename Group>
+    bool Npr03AsymDprfT<Group>::verifyProofs(const Workspace& w, span<Response> responses) const
+    {
+        auto inSize = w.w.size();
+
+        // A Fiat-Shamir proof (c, z) that vk = v * sk is checked by recomputing 
+        //   a1 = z * g - c * g^sk
+        //   a2 = z * v - c * vk
+        // and then the challenge from them. The hash prevents batching these.
+        auto checkDleq = [&](u64 p, const Point& v, const Point& vk, const Num& c, const Num& z)
+        {
+            auto negC = -c;
+            auto a1 = mGenTable.mul(z) + mGSkTables[p].mul(negC);
+
+            std::array<Point, 2> points{ { v, vk } };
+            std::array<Num, 2> scalars{ { z, negC } };
+            auto a2 = Group::multiScalarMul(points, scalars);
+
+            return dleqChallenge(mGSks[p], v, vk, a1, a2) == c;
+        };
+
+        // Legacy and Full proofs hold a1 and a2, and are checked together below.
+        auto isLinear = [](const Response& r)
         {
-            mRequestChls[j % mRequestChls.size()].asyncSend(sendBuff);
+            return r.encoding == ProofEncoding::Legacy || r.encoding == ProofEncoding::Full;
+        };
+
+        std::vector<Point> vs;
+        u64 numLegacy = 0;
+        for (auto& r : responses)
+        {
+            auto p = w.parties[r.k];
+            if (isLinear(r))
+            {
+                ++numLegacy;
+            }
+            else if (r.encoding == ProofEncoding::Batch)
+            {
+                // one proof for the random linear combinations of the inputs and outputs.
+                if (vs.empty())
+                    for (auto& wi : w.w)
+                        vs.push_back(wi.v);
+
+                auto e = batchCoefficients(mGSks[p], vs, r.vk);
+                auto V = Group::multiScalarMul(vs, e);
+                auto Y = Group::multiScalarMul(r.vk, e);
+                if (checkDleq(p, V, Y, r.c[0], r.z[0]) == false)
+                    return false;
+            }
+            else
+            {
+                std::atomic<bool> valid(true);
+                clientFor(inSize, [&](u64 begin, u64 end)
+                {
+                    for (u64 i = begin; i < end && valid; ++i)
+                        if (checkDleq(p, w.w[i].v, r.vk[i], r.c[i], r.z[i]) == false)
+                            valid = false;
+                });
+
+                if (valid == false)
+                    return false;
+            }
+        }
+
+        if (numLegacy == 0)
+            return true;
+
+        // Each equation is multiplied by its own random coefficient and
+        // the sum is checked to be zero with one multi-scalar multiplication.
+        // The coefficients are derived from a hash of the responses so that
+        // they are fixed only after the proofs have been sent.
+        oc::RandomOracle ro(sizeof(block));
+        for (auto& r : responses)
+            ro.Update(w.buff2[r.k].data(), w.buff2[r.k].size());
+        block seed;
+        ro.Final(seed);
+        PRNG prng(seed);
+
+        std::vector<Point> points; points.reserve(inSize + numLegacy * 3 * inSize);
+        std::vector<Num> scalars; scalars.reserve(points.capacity());
+        std::vector<Num> cSums; cSums.reserve(numLegacy);
+        std::vector<u64> cParties; cParties.reserve(numLegacy);
+
+        // The scalars of g and each v_i are accumulated across the equations.
+        Num gScalar(0);
+        std::vector<Num> vScalar(inSize, Num(0));
+
+        for (auto& r : responses)
+        {
+            if (isLinear(r) == false)
+                continue;
+
+            auto p = w.parties[r.k];
+            Num cSum(0), fsC;
+            for (u64 i = 0; i < inSize; ++i)
+            {
+                // The challenge of a Legacy proof is a hash of the input.
+                auto isFull = r.encoding == ProofEncoding::Full;
+                if (isFull)
+                    fsC = dleqChallenge(mGSks[p], w.w[i].v, r.vk[i], r.a1[i], r.a2[i]);
+
+                auto& c = isFull ? fsC : w.w[i].c;
+                Num rho(prng), sigma(prng);
+
+                //   rho   * (z * g   - a1 - c * g^sk)
+                // + sigma * (z * v_i - a2 - c * vk) 
+                gScalar += rho * r.z[i];
+                cSum += rho * c;
+                vScalar[i] += sigma * r.z[i];
+
+                points.push_back(r.a1[i]); scalars.push_back(-rho);
+                points.push_back(r.a2[i]); scalars.push_back(-sigma);
+                points.push_back(r.vk[i]); scalars.push_back(-(sigma * c));
+            }
+
+            cSums.push_back(-cSum);
+            cParties.push_back(p);
         }
 
-        oc::REllipticCurve curve;
+        for (u64 i = 0; i < inSize; ++i)
+        {
+            points.push_back(w.w[i].v);
+            scalars.push_back(vScalar[i]);
+        }
+
+        // The generator and the commitments are multiplied with their fixed base tables.
+        auto sum = Group::multiScalarMul(points, scalars);
+        sum += mGenTable.mul(gScalar);
+        for (u64 j = 0; j < cSums.size(); ++j)
+            sum += mGSkTables[cParties[j]].mul(cSums[j]);
+
+        return Group::isIdentity(sum);
+    }
+
+    template<typename Group>
+    AsyncEval Npr03AsymDprfT<Group>::asyncEval(span<block> in)
+    {
+        return asyncEval(in, nullptr);
+    }
+
+    template<typename Group>
+    AsyncEval Npr03AsymDprfT<Group>::asyncEval(span<block> in, std::vector<DprfTranscriptT<Group>>& transcripts)
+    {
+        if (mType != Type::PublicVarifiable)
+            throw std::runtime_error("transcripts require the PublicVarifiable type. " LOCATION);
+
+        return asyncEval(in, &transcripts);
+    }
+
+    template<typename Group>
+    AsyncEval Npr03AsymDprfT<Group>::asyncEval(span<block> in, std::vector<DprfTranscriptT<Group>>* transcripts)
+    {
+        typename Group::Context ctx;
 
         // This "Workspace" will hold all of the temporaries
         // until the operation has completed
         auto w = std::make_shared<Workspace>(in.size());
 
         auto pointSize = w->w[0].v.sizeBytes();
-        auto numSize = w->w[0].c.sizeBytes();
 
+        // Contact m-1 parties plus mHedge extra ones in case some 
+        // of them are slow to respond. mSelector orders them by preference.
+        auto numContacted = mM - 1 + mHedge;
+        w->parties = mSelector->select(numContacted);
+        w->buff2.resize(numContacted);
+        w->asyncs.resize(numContacted);
+        w->selector = mSelector;
+        w->settled.reset(new std::atomic<bool>[numContacted]);
+        for (u64 i = 0; i < numContacted; ++i)
+            w->settled[i] = false;
+
+        // The lagrange coefficients of this party and the first m-1 selected parties, 
+        // which are used unless some of them do not respond in time.
+        std::vector<u64> quorum{ u64(mPartyIdx) };
+        quorum.insert(quorum.end(), w->parties.begin(), w->parties.begin() + (mM - 1));
+
+        bool isDefault = true;
+        for (u64 i = 0; i < mM; ++i)
+            isDefault &= quorum[i] == (mPartyIdx + i) % mN;
+
+        if (isDefault)
+            w->lag = std::shared_ptr<const std::vector<Num>>(std::shared_ptr<const std::vector<Num>>(), &mDefaultLag);
+        else
+            w->lag = getLagrange(quorum);
+
+        // create a shared copy of the input which is sent to the 
+        // other parties as the OPRF input. The parties that are asked for 
+        // another proof encoding are sent the input with a trailer requesting it.
+        std::shared_ptr<std::vector<block>> sendBuff;
+        std::array<std::shared_ptr<std::vector<u8>>, 3> trailerBuffs;
+
+        // The parties of the preferred quorum are asked to weight their output shares 
+        // by their lagrange coefficient. Any extra parties are sent the plain request.
+        std::shared_ptr<std::vector<u8>> weightedBuff;
+        w->weighted = mServerWeighting && mType == Type::SemiHonest;
+        if (w->weighted)
+        {
+            oc::BitVector bits(mN);
+            for (auto p : quorum)
+                bits[p] = true;
+
+            RequestTrailer trailer;
+            trailer.setWeighted(bits);
 
-        for (u64 i = 0; i < in.size(); ++i)
+            weightedBuff = std::make_shared<std::vector<u8>>((u8*)in.data(), (u8*)(in.data() + in.size()));
+            trailer.append(*weightedBuff);
+        }
+
+        w->encodings.resize(numContacted);
+        for (u64 i = 0; i < numContacted; ++i)
         {
-            auto& v = w->w[i].v;
-            auto& y = w->w[i].y;
-            auto& c = w->w[i].c;
+            // The shares of a transcript must come with proofs that anyone can check.
+            auto& e = w->encodings[i];
+            if (mType == Type::SemiHonest)
+                e = ProofEncoding::Legacy;
+            else if (mType == Type::PublicVarifiable)
+                e = ProofEncoding::Full;
+            else
+                e = mProofEncodings[w->parties[i]];
+
+            auto& buff = trailerBuffs[u8(e)];
+            if (e == ProofEncoding::Legacy && !sendBuff)
+                sendBuff = std::make_shared<std::vector<block>>(in.begin(), in.end());
+            else if (e != ProofEncoding::Legacy && !buff)
+            {
+                RequestTrailer trailer;
+                trailer.setProofVersion(u8(e));
 
+                buff = std::make_shared<std::vector<u8>>((u8*)in.data(), (u8*)(in.data() + in.size()));
+                trailer.append(*buff);
+            }
+        }
 
-            // Hash each of the inputs to a random point on the ceruve
-            w->w[i].v.randomize(in[i]);
+        block proofSeed = oc::ZeroBlock;
+        {
+            // The sends and receives of concurrent evaluations must
+            // be queued on the channels in the same order.
+            std::lock_guard<std::mutex> lock(mRequestMtx);
 
-            // Perform the interpolcation in the exponent
-            y = v * (mDefaultLag[0] * mSk);
+            if (transcripts)
+            {
+                proofSeed = mClientPrng.get<block>();
+                w->inputs.assign(in.begin(), in.end());
+            }
 
-            if (mType != Type::SemiHonest)
+            for (u64 i = 0; i < numContacted; ++i)
             {
-                // compute the challenge value which we use later
-                oc::RandomOracle ro(sizeof(block));
-                ro.Update(in[i] ^ oc::AllOneBlock);
-                block challenge;
-                ro.Final(challenge);
-                c.randomize(challenge);
+                auto p = w->parties[i];
+                auto& chl = mRequestChls[p - (p > u64(mPartyIdx))];
+                if (w->weighted && i < mM - 1)
+                    chl.asyncSend(weightedBuff);
+                else if (w->encodings[i] == ProofEncoding::Legacy)
+                    chl.asyncSend(sendBuff);
+                else
+                    chl.asyncSend(trailerBuffs[u8(w->encodings[i])]);
+            }
+
+            for (u64 i = 0; i < numContacted; ++i)
+            {
+                auto p = w->parties[i];
+                auto& chl = mRequestChls[p - (p > u64(mPartyIdx))];
+                auto sent = mSelector->onSend(p);
+                ++w->numSent;
+
+                // Schedule the OPRF output to be recieved into w->buff2[i].
+                // The callback reports the round trip time and wakes up get()
+                // which uses the first m-1 valid responses. The workspace is 
+                // kept alive until every response has arrived, including the 
+                // ones that are not used.
+                w->asyncs[i] = chl.asyncRecv(w->buff2[i], [w, p, i, sent]()
+                {
+                    if (w->settle(i))
+                        w->selector->onResponse(p, sent);
+
+                    std::lock_guard<std::mutex> lock(w->mtx);
+                    ++w->arrivals;
+                    w->cv.notify_one();
+                });
             }
         }
 
-        // The size in bytes that we expect to be returned
-        auto isMal = mType != Type::SemiHonest;
-        auto size = (1 + isMal * 2) * pointSize + isMal * numSize;
 
-        // allocate enough space to receive the OPRF output and proofs
-        w->buff2.resize((mM - 1), size * in.size());
-        w->asyncs.resize(mM - 1);
-        for (u64 i = 1, j = mPartyIdx; i < mM; ++i, ++j)
+        clientFor(in.size(), [&](u64 begin, u64 end)
         {
-            auto& chl = mRequestChls[j % mRequestChls.size()];
-
+            for (u64 i = begin; i < end; ++i)
+            {
+                auto& c = w->w[i].c;
 
-            using Container = decltype(w->buff2[i - 1]);
 
-            static_assert(oc::is_container<Container>::value &&
-                !oc::has_resize<Container, void(typename Container::size_type)>::value, "");
+                // Hash each of the inputs to a random point on the ceruve
+                w->w[i].v.randomize(in[i]);
 
-            // Schedule the OPRF output to be recieved and store it
-            // in row i-1 of w->buff2
-            w->asyncs[i - 1] = chl.asyncRecv(w->buff2[i - 1]);
-        }
+                if (mType != Type::SemiHonest)
+                {
+                    // compute the challenge value of the Legacy proofs which we use later
+                    oc::RandomOracle ro(sizeof(block));
+                    ro.Update(in[i] ^ oc::AllOneBlock);
+                    block challenge;
+                    ro.Final(challenge);
+                    c.randomize(challenge);
+                }
+            }
+        });
 
         // Construct the completion event that is executed when the
         // user wants to complete the async eval.
         AsyncEval ae;
-        ae.get = [this, w, pointSize]()->std::vector<block>
+        ae.get = [this, w, pointSize, transcripts, proofSeed]()->std::vector<block>
         {
             auto inSize = w->w.size();
-            oc::REllipticCurve curve;
+            auto numContacted = w->parties.size();
+            auto needed = mM - 1;
+            typename Group::Context ctx;
 
-            Point vk, vz, gz, a1, a2;
-            Num s;
             std::vector<block> ret(inSize);
 
-            // Process the OPRF output shares one at a time
-            for (u64 i = 1, j = mPartyIdx; i < mM; ++i, ++j)
+            // Parses the response of the k'th contacted party into r. Returns
+            // false if the receive failed or the response is malformed.
+            auto readShares = [&](u64 k, Response& r)
             {
-                // block for the data to arrive.
-                w->asyncs[i - 1].get();
+                try { w->asyncs[k].get(); }
+                catch (...)
+                {
+                    if (w->settle(k))
+                        mSelector->onFailure(w->parties[k]);
+                    return false;
+                }
 
-                // pointer into the output share
-                auto iter = w->buff2[i - 1].data();
+                // Responses other than Legacy end with the version byte.
+                auto encoding = w->encodings[k];
+                auto tail = responseTail(encoding);
+                auto& buff = w->buff2[k];
+                if (buff.size() != responseSize(encoding) * inSize + tail ||
+                    (tail && buff.back() != u8(encoding)))
+                    return false;
+
+                auto isLegacy = encoding == ProofEncoding::Legacy || encoding == ProofEncoding::Full;
+                auto isCompact = encoding == ProofEncoding::Compact;
+                auto isBatch = encoding == ProofEncoding::Batch;
+                r.k = k;
+                r.encoding = encoding;
+                r.vk.resize(inSize);
+                if (mType != Type::SemiHonest)
+                {
+                    r.a1.resize(inSize * isLegacy);
+                    r.a2.resize(inSize * isLegacy);
+                    r.c.resize(isBatch ? 1 : inSize * isCompact);
+                    r.z.resize(isBatch ? 1 : inSize);
+                }
 
-                for (u64 inIdx = 0; inIdx < inSize; ++inIdx)
+                // Each input has a fixed size part of the response and so they
+                // can be parsed in parallel.
+                auto sizePer = responseSize(encoding);
+                clientFor(inSize, [&](u64 begin, u64 end)
                 {
-                    Point& v = w->w[inIdx].v;
-                    Point& y = w->w[inIdx].y;
-                    Num& c = w->w[inIdx].c;
+                    for (u64 inIdx = begin; inIdx < end; ++inIdx)
+                    {
+                        // pointer into the output share
+                        auto iter = buff.data() + inIdx * sizePer;
+
+                        // read in the output share = H(x)^k_i
+                        r.vk[inIdx].fromBytes(iter);
+                        iter += pointSize;
+
+                        if (isBatch)
+                            continue;
+
+                        if (mType != Type::SemiHonest && isCompact)
+                        {
+                            // if malicious, then parse the ZK proof
+                            r.c[inIdx].fromBytes(iter);   iter += r.c[inIdx].sizeBytes();
+                            r.z[inIdx].fromBytes(iter);   iter += r.z[inIdx].sizeBytes();
+                        }
+                        else if (mType != Type::SemiHonest)
+                        {
+                            r.a1[inIdx].fromBytes(iter);  iter += pointSize;
+                            r.a2[inIdx].fromBytes(iter);  iter += pointSize;
+                            r.z[inIdx].fromBytes(iter);   iter += r.z[inIdx].sizeBytes();
+                        }
+                    }
+                });
 
-                    // read in the output share = H(x)^k_i
-                    vk.fromBytes(iter);
-                    iter += vk.sizeBytes();
+                // the proof of the whole batch.
+                if (isBatch)
+                {
+                    auto iter = buff.data() + inSize * sizePer;
+                    r.c[0].fromBytes(iter);  iter += r.c[0].sizeBytes();
+                    r.z[0].fromBytes(iter);
+                }
 
-                    // y = SUM_i  H(x)^{\lambda_i * k_i}
-                    y += vk * mDefaultLag[i];
+                return true;
+            };
 
-                    if (mType == Type::Malicious)
-                    {
-                        // if malicious, then parse the ZK proof
+            // The responses that are used, and the ones whose proofs are yet to be checked.
+            std::vector<Response> used, pending;
+            std::vector<u8> done(numContacted, 0);
+            u64 numDone = 0, seen = 0;
 
-                        a1.fromBytes(iter);  iter += a1.sizeBytes();
-                        a2.fromBytes(iter);  iter += a2.sizeBytes();
-                        s.fromBytes(iter);   iter += s.sizeBytes();
+            // Moves the pending responses with valid proofs to used. The proofs of all pending
+            // responses are first checked at once. Only if that fails is each response checked
+            // on its own, so that the faulty parties can be identified and skipped.
+            auto verifyPending = [&]()
+            {
+                if (mType == Type::SemiHonest || verifyProofs(*w, pending))
+                {
+                    for (auto& r : pending)
+                        used.push_back(std::move(r));
+                }
+                else
+                {
+                    for (auto& r : pending)
+                        if (verifyProofs(*w, { &r, 1 }))
+                            used.push_back(std::move(r));
+                }
+                pending.clear();
+            };
 
-                        auto pIdx = (mPartyIdx + i) % mN;
+            // Process the OPRF output shares in the order that they arrive
+            // until m-1 valid ones have been received.
+            while (used.size() < needed)
+            {
+                if (used.size() + pending.size() + (numContacted - numDone) < needed)
+                    throw std::runtime_error("too few parties responded with a valid DPRF output share. " LOCATION);
 
-                        // Compute the check values
-                        gz = mGen * s;
-                        vz = v * s;
+                bool progress = false;
+                for (u64 k = 0; k < numContacted && used.size() + pending.size() < needed; ++k)
+                {
+                    if (done[k] || w->asyncs[k].wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                        continue;
 
-                        a1 += mGSks[pIdx] * c;
-                        a2 += vk * c;
+                    done[k] = 1;
+                    ++numDone;
+                    progress = true;
 
-                        // make sure the proof matches
-                        if (gz != a1 || vz != a2)
-                            throw std::runtime_error(LOCATION);
+                    Response r;
+                    if (readShares(k, r))
+                        pending.push_back(std::move(r));
+                }
 
-                    }
-                    else if (mType == Type::PublicVarifiable)
-                    {
-                        throw std::runtime_error("PublicVarifiable is not implemented. " LOCATION);
+                // check the proofs once there are enough responses, or no more will arrive.
+                if (pending.size() && (used.size() + pending.size() == needed || numDone == numContacted))
+                {
+                    verifyPending();
+                }
+                else if (progress == false)
+                {
+                    // Wait for the next response. The timeout covers a 
+                    // failed receive, which does not call the callback.
+                    std::unique_lock<std::mutex> lock(w->mtx);
+                    w->cv.wait_for(lock, std::chrono::milliseconds(1), [&]() { return w->arrivals != seen; });
+                    seen = w->arrivals;
+                }
+            }
 
-                        //TODO("update this to use real proof. Currently just do dummy work too approximate the efficienty");
-                        //vz = v * s;
-                        //a2 += vk * c;
-                    }
+            // Report the unused parties whose receive has already failed. The 
+            // ones that are still in flight are settled by their callback, or 
+            // once the workspace is released.
+            for (u64 k = 0; k < numContacted; ++k)
+            {
+                if (done[k] || w->asyncs[k].wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                    continue;
+
+                try { w->asyncs[k].get(); }
+                catch (...)
+                {
+                    if (w->settle(k))
+                        mSelector->onFailure(w->parties[k]);
                 }
             }
 
-            // Hash the output value to get a random string
-            std::vector<u8> buff(pointSize);
-            for (u64 inIdx = 0; inIdx < inSize; ++inIdx)
+            // list the used responses in the order the parties were contacted.
+            std::sort(used.begin(), used.end(), [](const Response& a, const Response& b) { return a.k < b.k; });
+
+            // The lagrange coefficients for this party followed by the used parties.
+            bool isPreferred = true;
+            for (u64 i = 0; i < used.size(); ++i)
+                isPreferred &= used[i].k == i;
+
+            auto lag = w->lag;
+            if (isPreferred == false)
+            {
+                std::vector<u64> quorum{ u64(mPartyIdx) };
+                for (auto& r : used)
+                    quorum.push_back(w->parties[r.k]);
+
+                lag = getLagrange(quorum);
+            }
+
+            // Interpolate in the exponent, i.e. 
+            //    y = H(x)^{\lambda_0 * sk} * PROD_i  vk_i^{\lambda_i}
+            // with one multi-scalar multiplication per input over the shares of 
+            // the other parties. Its running time depends on the scalars and so 
+            // the share of this party, which holds sk, is computed on its own 
+            // with the constant time scalar multiplication.
+            auto skScalar = (*lag)[0] * mSk;
+            std::vector<Num> scalars(lag->begin() + 1, lag->end());
+
+            bool isSum = w->weighted && isPreferred;
+            std::vector<Point> points;
+            if (isSum == false)
             {
-                oc::REccPoint& y = w->w[inIdx].y;
-                y.toBytes(buff.data());
+                // A share that was weighted for the preferred quorum is reweighted 
+                // for the quorum that is used.
+                if (w->weighted)
+                    for (u64 i = 0; i < used.size(); ++i)
+                        if (used[i].k < needed)
+                            scalars[i] /= (*w->lag)[used[i].k + 1];
+
+                points.reserve(inSize * needed);
+                for (u64 inIdx = 0; inIdx < inSize; ++inIdx)
+                    for (auto& r : used)
+                        points.push_back(r.vk[inIdx]);
+            }
+
+            // The outputs are combined and hashed in parallel slices of the inputs.
+            std::vector<Point> y(inSize);
+            clientFor(inSize, [&](u64 begin, u64 end)
+            {
+                span<Point> ys(y.data() + begin, end - begin);
+
+                // Shares that are already weighted only need to be added.
+                if (isSum == false)
+                    Group::multiScalarMul(
+                        span<const Point>(points.data() + begin * needed, ys.size() * needed), scalars, ys);
 
-                oc::RandomOracle H(sizeof(block));
+                for (u64 inIdx = begin; inIdx < end; ++inIdx)
+                {
+                    if (isSum)
+                    {
+                        y[inIdx] = w->w[inIdx].v * skScalar;
+                        for (auto& r : used)
+                            y[inIdx] += r.vk[inIdx];
+                    }
+                    else
+                        y[inIdx] += w->w[inIdx].v * skScalar;
+                }
+
+                // The sums are kept in projective coordinates and normalized
+                // with one shared inversion instead of one per output.
+                Group::normalize(ys);
+
+                // Hash the output value to get a random string
+                std::vector<u8> buff(pointSize);
+                for (u64 inIdx = begin; inIdx < end; ++inIdx)
+                {
+                    w->w[inIdx].y = y[inIdx];
+                    y[inIdx].toBytes(buff.data());
+
+                    oc::RandomOracle H(sizeof(block));
+
+                    H.Update(buff.data(), buff.size());
+                    H.Final(ret[inIdx]);
+                }
+            });
 
-                H.Update(buff.data(), buff.size());
-                H.Final(ret[inIdx]);
+            // The evidence for each output is the output share of this party, 
+            // with a proof of its own, and the shares and proofs of the used parties.
+            if (transcripts)
+            {
+                PRNG prng(proofSeed);
+                transcripts->resize(inSize);
+                for (u64 inIdx = 0; inIdx < inSize; ++inIdx)
+                {
+                    auto& t = (*transcripts)[inIdx];
+                    auto& v = w->w[inIdx].v;
+                    t.mInput = w->inputs[inIdx];
+                    t.mOutput = w->w[inIdx].y;
+                    t.mParties.resize(mM);
+                    t.mShares.resize(mM);
+                    t.mA1.resize(mM);
+                    t.mA2.resize(mM);
+                    t.mZ.resize(mM);
+
+                    t.mParties[0] = mPartyIdx;
+                    t.mShares[0] = v * mSk;
+                    proveDleq(v, t.mShares[0], prng, t.mA1[0], t.mA2[0], t.mZ[0]);
+
+                    for (u64 j = 0; j < used.size(); ++j)
+                    {
+                        t.mParties[j + 1] = w->parties[used[j].k];
+                        t.mShares[j + 1] = used[j].vk[inIdx];
+                        t.mA1[j + 1] = used[j].a1[inIdx];
+                        t.mA2[j + 1] = used[j].a2[inIdx];
+                        t.mZ[j + 1] = used[j].z[inIdx];
+                    }
+                }
             }
 
             return ret;
@@ -447,7 +1382,8 @@ namespace dEnc
     }
 
 
-    void Npr03AsymDprf::startListening()
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::startListening()
     {
         mServerDone = (mServerDoneProm.get_future());
         mRecvBuff.resize(mRequestChls.size());
@@ -487,10 +1423,14 @@ namespace dEnc
         }
     }
 
-    void Npr03AsymDprf::close()
+    template<typename Group>
+    void Npr03AsymDprfT<Group>::close()
     {
         if (mIsClosed == false)
         {
+            // send any coalesced evaluations before closing.
+            disableCoalescing();
+
             mIsClosed = true;
 
             u8 close[1];
@@ -501,4 +1441,7 @@ namespace dEnc
                 c.asyncSendCopy(close, 1);
         }
     }
+
+    template class Npr03AsymDprfT<RelicGroup>;
+    template class Npr03AsymDprfT<Rist255Group>;
 }
@@ -1,19 +1,47 @@
 #pragma once
 #include <dEnc/Defines.h>
 #include <cryptoTools/Crypto/RCurve.h>
+#include <cryptoTools/Common/BitVector.h>
 #include "Dprf.h"
+#include "dEnc/tools/LruCache.h"
+#include "dEnc/tools/FixedBase.h"
+#include "dEnc/tools/Group.h"
+#include "dEnc/tools/NoncePool.h"
+#include "dEnc/tools/ObjectPool.h"
+#include "DprfAuditor.h"
 
 namespace dEnc {
 
-    
-
-
-	class Npr03AsymDprf : public Dprf
+    // The asymmetric DPRF of [NPR03] in a prime order group, see Group.h for the
+    // groups that can be used. Npr03AsymDprf is the DPRF in relic's curve.
+    template<typename Group>
+	class Npr03AsymDprfT : public Dprf
 	{
 	public:
-        using Num = oc::REccNumber;
-        using Point = oc::REccPoint;
+        using Num = typename Group::Num;
+        using Point = typename Group::Point;
 
+        // How the proofs of malicious security are encoded in a response. The 
+        // encoding is requested in the RequestTrailer, and parties that do not
+        // request one are sent the Legacy encoding.
+        enum class ProofEncoding : u8
+        {
+            // v^k and the proof (a1, a2, z) for each input, where the challenge
+            // is a hash of the input. Understood by every party.
+            Legacy = 0,
+            // v^k and the Fiat-Shamir proof (c, z) for each input, followed by
+            // the version byte. The verifier recomputes a1 and a2 from c and z.
+            Compact = 1,
+            // v^k for each input followed by one proof (c, z) for the whole batch
+            // and the version byte. The proof is that log_g(g^k) = log_V(Y) where 
+            // V and Y are random linear combinations of the inputs and outputs,
+            // see batchCoefficients(...).
+            Batch = 2,
+            // v^k and the Fiat-Shamir proof (a1, a2, z) for each input, followed by 
+            // the version byte. Larger than Compact but the proofs can be checked 
+            // in batches, also by a third party. Used by the PublicVarifiable type.
+            Full = 3
+        };
 
         struct MasterKey
         {
@@ -28,7 +56,7 @@ namespace dEnc {
         };
 
 
-		virtual ~Npr03AsymDprf();
+		virtual ~Npr03AsymDprfT();
 
         // The index of this party
 		i64 mPartyIdx;
@@ -48,19 +76,233 @@ namespace dEnc {
         // Internal flag that determines if the OPRF is currently closed.
         bool mIsClosed = true;
 
-        oc::REllipticCurve mCurve;
+        typename Group::Context mCurve;
 
         // The local secret key
 		Num mSk;
 
-		std::vector<Num> mTempNums;
-		std::vector<Point> mGSks, mTempPoints;
+		std::vector<Point> mGSks;
         Point mGen;
 		std::vector<Num> mDefaultLag;
 
+        // Fixed base tables for mGen and each commitment in mGSks.
+        typename Group::FixedBase mGenTable;
+        std::vector<typename Group::FixedBase> mGSkTables;
+
+        // Precomputed proof nonces (r, g^r), see setNoncePool(...). Declared
+        // after mGenTable, which the pool's thread uses.
+        NoncePoolT<Group> mNoncePool;
+
+        // The temporaries of serving one input, which are reused so that
+        // the points and numbers are not reallocated for every input.
+        struct ServeScratch
+        {
+            Point v, vk, a1, a2;
+            Num c, r, z;
+            std::vector<u8> buff;
+
+            // The PRNG of a shard of a request, see serveOne(...).
+            PRNG prng;
+
+            // The inputs and outputs of a Batch request and the seeds of its shards.
+            std::vector<Point> batchV, batchVk;
+            std::vector<block> seeds;
+
+            // Grows the storage of a request. Returns true if it allocated.
+            bool reserve(u64 numInputs, u64 numShards);
+        };
+
+        // The temporaries of an evaluation and the parsed response of one 
+        // party to it, see Npr03AsymDprf.cpp.
+        struct Workspace;
+        struct Response;
+
+        // The scratch of each thread that is serving a request. 
+        ObjectPool<ServeScratch> mScratchPool;
+
+        // The minimum number of inputs that serveOne hands to each thread 
+        // of the pool set by setThreadPool(...).
+        u64 mMinShardSize = 4;
 
 
+
+        // The proof encoding requested from each party, see setProofEncoding(...).
+        std::vector<ProofEncoding> mProofEncodings;
+
+        // The number of parties contacted in addition to the m-1 required ones, see setHedge(...).
+        u64 mHedge = 0;
+
+        // If the parties are asked to weight their output shares, see setServerWeighting(...).
+        bool mServerWeighting = false;
+
+        // The threads that the evaluations of this party are split across, see setClientThreadPool(...).
+        std::shared_ptr<ThreadPool> mClientPool;
+
+        // The lagrange coefficients of quorums other than the default one, indexed
+        // by party. The key is the bit vector of the quorum, see getLagrange(...).
+        LruCache<std::string, std::shared_ptr<const std::vector<Num>>> mLagrangeCache;
+
 		static std::function<Num(u64 i)> interpolate(span<Num> fx, span<Num> x);
+
+        /**
+         * Returns the coefficients l_i such that the master key is SUM_i l_i * k_{parties[i]}.
+         * @param[in] parties  - The indices of m distinct parties.
+         */
+        static std::vector<Num> lagrangeCoefficients(span<const u64> parties);
+
+        /**
+         * Returns lagrangeCoefficients(parties) from the cache of the quorum, computing
+         * them if needed. The order of the parties does not matter to the cache.
+         * @param[in] parties  - The indices of m distinct parties.
+         */
+        std::shared_ptr<const std::vector<Num>> getLagrange(span<const u64> parties);
+
+        /**
+         * Returns the lagrange coefficients of the quorum indexed by party, i.e. zero
+         * for the parties that are not in it. They are cached by quorum.
+         * @param[in] quorum  - A bit vector with m bits set, one per party.
+         */
+        std::shared_ptr<const std::vector<Num>> getLagrange(const oc::BitVector& quorum);
+
+        /**
+         * Hedge against slow parties by sending each request to m-1+extra parties. An
+         * evaluation completes with the first m-1 valid responses, and the lagrange 
+         * coefficients of the parties that responded are used. Throws if m-1+extra
+         * is more than n-1. Must be called after init(...).
+         * @param[in] extra  - The number of additional parties to contact.
+         */
+        void setHedge(u64 extra);
+
+        /**
+         * Ask the parties to return their output shares weighted by their lagrange 
+         * coefficient, H(x)^{l_i * k_i} instead of H(x)^{k_i}, so that the client 
+         * only adds them to its own share instead of doing m-1 scalar multiplications.
+         * The request then carries the quorum and the RequestTrailer::Weighted flag. 
+         * Only the first m-1 parties are asked, and the shares are reweighted if a 
+         * hedged party is used instead. Throws unless the type is SemiHonest.
+         * @param[in] enabled  - If the output shares should be weighted.
+         */
+        void setServerWeighting(bool enabled);
+
+        /**
+         * Lets asyncEval split large batches across the threads of pool, both when 
+         * hashing the inputs before the request is sent and when parsing, verifying,
+         * combining and hashing the responses. Slices have at least mMinShardSize 
+         * inputs. The pool may be the one set with setThreadPool(...), but it must
+         * not be used by the thread that calls AsyncEval::get(). Passing nullptr
+         * evaluates on the calling thread.
+         * @param[in] pool  - The worker threads, which may be shared with other instances.
+         */
+        void setClientThreadPool(std::shared_ptr<ThreadPool> pool);
+
+        /**
+         * Calls fn(begin, end) for slices of [0, n) that cover it, on the client
+         * thread pool if it is set and n is large enough. The group is set up on
+         * the threads of the pool.
+         * @param[in] n   - The number of inputs.
+         * @param[in] fn  - Called once per slice.
+         */
+        void clientFor(u64 n, const std::function<void(u64 begin, u64 end)>& fn) const;
+
+        /**
+         * Sets the proof encoding that is requested from every party. Compact 
+         * proofs are smaller but parties that predate them do not understand the
+         * request. Must be called after init(...) and before any evaluation.
+         * @param[in] encoding  - The proof encoding.
+         */
+        void setProofEncoding(ProofEncoding encoding);
+
+        /**
+         * Sets the proof encoding that is requested from one party.
+         * @param[in] partyIdx  - The index of the party.
+         * @param[in] encoding  - The proof encoding.
+         */
+        void setProofEncoding(u64 partyIdx, ProofEncoding encoding);
+
+        /**
+         * Precompute the nonces (r, g^r) of the proofs on a background thread. Once 
+         * the pool holds at most lowWatermark nonces it is refilled to capacity. 
+         * Proofs compute their nonce inline when the pool is empty. A capacity
+         * of zero stops the thread. Must be called after init(...).
+         * @param[in] capacity      - The number of nonces that the pool is filled to.
+         * @param[in] lowWatermark  - The number of nonces at which the pool is refilled.
+         */
+        void setNoncePool(u64 capacity, u64 lowWatermark);
+
+        /**
+         * Returns a proof nonce r and a1 = g^r, from the pool if it is not empty.
+         * @param[in] prng  - The source of r if the pool is empty.
+         * @param[out] r    - The nonce.
+         * @param[out] a1   - g^r.
+         */
+        void nonce(PRNG& prng, Num& r, Point& a1);
+
+        /**
+         * Returns the number of bytes that a response holds per input.
+         * @param[in] encoding  - The proof encoding of the response.
+         */
+        u64 responseSize(ProofEncoding encoding) const;
+
+        /**
+         * Returns the number of bytes that follow the inputs of a response, i.e.
+         * the batch proof and the version byte.
+         * @param[in] encoding  - The proof encoding of the response.
+         */
+        u64 responseTail(ProofEncoding encoding) const;
+
+        /**
+         * Returns the Fiat-Shamir challenge of a compact proof that log_g(gk) = log_v(vk),
+         * where a1 = g^r and a2 = v^r are the commitments of the prover.
+         */
+        static Num dleqChallenge(const Point& gk, const Point& v, const Point& vk, const Point& a1, const Point& a2);
+
+        /**
+         * Sets c to dleqChallenge(gk, v, vk, a1, a2) using buff to serialize the points.
+         */
+        static void dleqChallenge(const Point& gk, const Point& v, const Point& vk, const Point& a1, const Point& a2, Num& c, std::vector<u8>& buff);
+
+        /**
+         * Proves that vk = v * sk with the Fiat-Shamir proof (c, a1, a2, z) and returns c.
+         * @param[in] v     - The base point.
+         * @param[in] vk    - v * sk.
+         * @param[in] prng  - The source of the nonce if the nonce pool is empty.
+         * @param[out] a1   - The commitment g^r.
+         * @param[out] a2   - The commitment v^r.
+         * @param[out] z    - The response r + sk * c.
+         */
+        Num proveDleq(const Point& v, const Point& vk, PRNG& prng, Point& a1, Point& a2, Num& z);
+
+        /**
+         * Like proveDleq(v, vk, prng, a1, a2, z) but the proof (c, a1, a2, z) and 
+         * the nonce are written to the members of s.
+         */
+        void proveDleq(const Point& v, const Point& vk, PRNG& prng, ServeScratch& s);
+
+        /**
+         * Returns the coefficients e_j of the batch proof, which is for V = SUM_j e_j * v[j] 
+         * and Y = SUM_j e_j * vk[j]. They are derived from a hash of g^k, v and vk.
+         * @param[in] gk  - The commitment to the key of the prover.
+         * @param[in] v   - The inputs, hashed to the curve.
+         * @param[in] vk  - The outputs of the prover.
+         */
+        static std::vector<Num> batchCoefficients(const Point& gk, span<const Point> v, span<const Point> vk);
+
+        /**
+         * Writes the batch proof (c, z) that vk[j] = v[j] * sk for every j to dest.
+         * @param[in] v      - The inputs, hashed to the curve.
+         * @param[in] vk     - The outputs, vk[j] = v[j] * sk.
+         * @param[out] dest  - Where the proof is written.
+         * @param[in] prng   - The source of the proof's randomness.
+         */
+        void proveBatch(span<const Point> v, span<const Point> vk, span<u8> dest, PRNG& prng);
+
+        /**
+         * Checks the proofs of every output share in the responses at once. Returns
+         * false if any of them is invalid.
+         * @param[in] w          - The state of the evaluation the responses belong to.
+         * @param[in] responses  - The parsed responses.
+         */
+        bool verifyProofs(const Workspace& w, span<Response> responses) const;
 		static std::function<Num(u64 i)> interpolate(span<Num> fx);
 
 		void init(
@@ -75,11 +317,30 @@ namespace dEnc {
 
 		virtual void serveOne(span<u8>request, u64 outputPartyIdx)override;
 		void serveOne(block in, span<u8> dest, u64 outputPartyIdx);
+		void serveOne(block in, span<u8> dest, u64 outputPartyIdx, PRNG& prng, ProofEncoding encoding = ProofEncoding::Legacy);
+
+        /**
+         * Returns the number of times that serving requests has created or grown 
+         * the scratch for its temporaries. It stops increasing once the scratch of 
+         * every thread that serves requests has been sized for the largest request.
+         * Other allocations, e.g. of the response buffer, are not counted.
+         */
+        u64 scratchGrowths() const { return mScratchPool.growths(); }
 
 		virtual block eval(block input)override;
 		virtual AsyncEval asyncEval(block input)override;
 		virtual AsyncEval asyncEval(span<block> input)override;
 
+        /**
+         * Evaluates the DPRF like asyncEval(input) and also fills transcripts with the 
+         * evidence that the outputs are correct, which a DprfAuditor can check against 
+         * the commitments to the key shares. Requires the PublicVarifiable type. The 
+         * transcripts are filled by AsyncEval::get() and must outlive it.
+         * @param[in] input         - The DPRF inputs.
+         * @param[out] transcripts  - One transcript per input.
+         */
+        AsyncEval asyncEval(span<block> input, std::vector<DprfTranscriptT<Group>>& transcripts);
+
 		virtual void close()override;
 
 
@@ -93,6 +354,21 @@ namespace dEnc {
 
 
 		std::vector<Channel> mRequestChls, mListenChls;
+
+        // Serializes queuing the sends and receives of concurrent evaluations.
+        std::mutex mRequestMtx;
+
+        // The source of the seeds of the client's own proofs. Guarded by mRequestMtx.
+        PRNG mClientPrng;
+
+    private:
+        AsyncEval asyncEval(span<block> input, std::vector<DprfTranscriptT<Group>>* transcripts);
+
+        // Writes the response to the input in to dest. The group context of the 
+        // calling thread must be set up.
+        void serveInput(block in, span<u8> dest, PRNG& prng, ProofEncoding encoding, ServeScratch& s);
 	};
 
+    using Npr03AsymDprf = Npr03AsymDprfT<RelicGroup>;
+    using Npr03AsymRist255Dprf = Npr03AsymDprfT<Rist255Group>;
 }
\ No newline at end of file
@@ -3,6 +3,12 @@
 
 #include <cryptoTools/Common/BitVector.h>
 #include <cryptoTools/Common/MatrixView.h>
+#include "dEnc/tools/Combinatorics.h"
+#include "dEnc/tools/ThreadPool.h"
+#include "DprfRequest.h"
+#include "EvalCoalescer.h"
+#include <algorithm>
+#include <cstring>
 namespace dEnc {
 
 
@@ -18,12 +24,26 @@ namespace dEnc {
 
 
 
-    void Npr03SymDprf::MasterKey::KeyGen(u64 n, u64 m, PRNG & prng)
+    void Npr03SymDprf::MasterKey::KeyGen(u64 n, u64 m, PRNG & prng, KeyMode keyMode)
     {
+        mode = keyMode;
+        this->n = n;
+        this->m = m;
 
         // each subkey i will be distributed to subsetSize-out-of-n of the parties.
         auto subsetSize = n - m + 1;
 
+        if (mode == KeyMode::Derived)
+        {
+            // Only the seed is stored. The sub-keys are computed 
+            // by expandSubkey(...) when the parties are initialized.
+            seed = prng.get<block>();
+            keys.clear();
+            keyStructure.resize(0, 0);
+            subKeys.resize(0, 0);
+            return;
+        }
+
         // the number of sub keys
         i64 d = boost::math::binomial_coefficient<double>(n, subsetSize);
 
@@ -93,6 +113,72 @@ namespace dEnc {
         go(0, subsetSize);
     }
 
+    std::vector<block> Npr03SymDprf::MasterKey::expandSubkey(u64 partyIdx) const
+    {
+        if (mode == KeyMode::Explicit)
+        {
+            auto row = subKeys[partyIdx];
+            return { row.begin(), row.end() };
+        }
+
+        auto subsetSize = n - m + 1;
+        std::vector<block> ret(choose(n - 1, subsetSize - 1));
+
+        // The j'th key is the key of the j'th subset containing partyIdx. Iterate
+        // over the other members of these subsets in lexicographic order. Adding 
+        // partyIdx to each of them does not change the order.
+        std::vector<u64> others(subsetSize - 1), subset(subsetSize);
+        for (u64 i = 0; i < others.size(); ++i)
+            others[i] = i;
+
+        for (u64 j = 0; j < ret.size(); ++j)
+        {
+            // map others from {0,...,n-2} to {0,...,n-1} \ {partyIdx} and insert partyIdx.
+            u64 i = 0, k = 0;
+            for (; k < others.size() && others[k] < partyIdx; ++k)
+                subset[i++] = others[k];
+            subset[i++] = partyIdx;
+            for (; k < others.size(); ++k)
+                subset[i++] = others[k] + 1;
+
+            ret[j] = oc::toBlock(rankSubset(subset, n));
+            nextSubset(others, n - 1);
+        }
+
+        // k_S = AES_seed(rank(S))
+        oc::AES prf(seed);
+        prf.ecbEncBlocks(ret.data(), ret.size(), ret.data());
+
+        return ret;
+    }
+
+    block Npr03SymDprf::MasterKey::getKey(u64 keyIdx) const
+    {
+        if (mode == KeyMode::Explicit)
+            return keys[keyIdx];
+
+        oc::AES prf(seed);
+        return prf.ecbEncBlock(oc::toBlock(keyIdx));
+    }
+
+    u64 Npr03SymDprf::MasterKey::keyIndex(u64 n, u64 m, u64 partyIdx, u64 j)
+    {
+        auto subsetSize = n - m + 1;
+
+        // the other members of the j'th subset containing partyIdx.
+        std::vector<u64> subset(subsetSize);
+        unrankSubset(j, n - 1, span<u64>(subset.data(), subsetSize - 1));
+
+        // insert partyIdx into the sorted subset.
+        for (u64 i = 0; i < subsetSize - 1; ++i)
+            if (subset[i] >= partyIdx)
+                ++subset[i];
+        subset.back() = partyIdx;
+        std::sort(subset.begin(), subset.end());
+
+        return rankSubset(subset, n);
+    }
+
 
 
 	void Npr03SymDprf::init(
@@ -104,7 +190,55 @@ namespace dEnc {
         oc::Matrix<u64>& keyStructure,
         span<block> keys)
 	{
+        setup(partyIdx, m, requestChls, listenChls, seed);
+        mKeyStructure.resize(keyStructure.rows(), keyStructure.stride());
+        std::copy(keyStructure.begin(), keyStructure.end(), mKeyStructure.begin());
+        mMyKeys = { keys.begin(), keys.end() };
+
+		for (u64 i = mPartyIdx, j = 0; j < mM; ++j)
+		{
+			constructDefaultKeys(i);
+
+            // i = i - 1 mod mN
+            // mathematical mod where i can not be negative
+			i = i ? (i - 1) : mN - 1;
+		}
+
+		startListening();
+	}
+
+	void Npr03SymDprf::init(
+		u64 partyIdx,
+		u64 m,
+		span<Channel> requestChls,
+		span<Channel> listenChls,
+		block seed,
+        span<block> keys)
+	{
+        setup(partyIdx, m, requestChls, listenChls, seed);
+
+        if (keys.size() != choose(mN - 1, mN - mM))
+            throw std::runtime_error("wrong number of keys. " LOCATION);
+
+        mKeyStructure.resize(0, 0);
+        mMyKeys = { keys.begin(), keys.end() };
+
+		for (u64 i = mPartyIdx, j = 0; j < mM; ++j)
+		{
+			constructDefaultKeys(i);
+			i = i ? (i - 1) : mN - 1;
+		}
+
+		startListening();
+	}
 
+	void Npr03SymDprf::setup(
+		u64 partyIdx,
+		u64 m,
+		span<Channel> requestChls,
+		span<Channel> listenChls,
+		block seed)
+	{
 		mPartyIdx = partyIdx;
 		mRequestChls = { requestChls.begin(), requestChls.end() };
 		mListenChls = { listenChls.begin(), listenChls.end() };
@@ -121,33 +255,19 @@ namespace dEnc {
         mD = boost::math::binomial_coefficient<double>(mN, subsetSize);
 
 		mDefaultKeys.resize(mN);
-		for (u64 i = mPartyIdx, j = 0; j < mM; ++j)
-		{
-			constructDefaultKeys(i, keyStructure, keys);
-
-            // i = i - 1 mod mN
-            // mathematical mod where i can not be negative
-			i = i ? (i - 1) : mN - 1;
-		}
 
-
-		startListening();
+        mSelector = std::make_shared<PartySelector>(mN, mPartyIdx, mSelectionPolicy, mPrng.get<block>());
 	}
 
 	void Npr03SymDprf::serveOne(span<u8> rr, u64 chlIdx)
 	{
-        TODO("Add support for allowing the request to specify which parties are involved in this evaluation. "
-            "This can be done by sending a bit vector of the parties that contribute keys and then have this "
-            "party figure out which keys to use in a similar way that constructDefaultKeys(...) does it.");
-
-        // Right now we only support allowing 16 bytes to be the OPRF input.
-        // When a multiple is sent, this its interpreted as requesting 
+        // The request is a list of 16 byte OPRF inputs, optionally followed
+        // by a trailer which names the parties taking part in the evaluation.
+        // When several inputs are sent, this is interpreted as requesting 
         // several OPRF evaluations.
-		if(rr.size() % sizeof(block))
-			throw std::runtime_error(LOCATION);
-
-        // Get a view of the data as blocks.
-		span<block> request( (block*)rr.data(), rr.size() / sizeof(block) );
+		span<block> request;
+        RequestTrailer trailer;
+        RequestTrailer::parse(rr, mN, request, trailer);
 
         // a vector to hold the OPRF output shares.
 		std::vector<oc::block> fx(request.size());
@@ -155,39 +275,65 @@ namespace dEnc {
         // compute the partyIdx based on the channel idx.
 		auto pIdx = chlIdx + (chlIdx >= mPartyIdx ? 1 : 0);
 
-		if (request.size() == 1)
-		{
-            // If only one OPRF input is used, we vectorize the AES evaluation
-            // so that several keys are evaluated in parallel.
-
-			fx.resize(mDefaultKeys[pIdx].mAESs.size());
-			mDefaultKeys[pIdx].ecbEncBlock(request[0], fx.data());
+        // Each output share is the XOR of the encryptions under all of the
+        // keys in mDefaultKeys[pIdx], or the keys for the requested quorum. 
+        // The multi-key AES interleaves several keys and/or inputs and 
+        // accumulates the XOR in registers. This handles both a single 
+        // input and a batch of inputs.
+        if (trailer.mFlags & RequestTrailer::HasQuorum)
+            encSum(*getQuorumKeys(pIdx, trailer.mQuorum), request, fx);
+        else
+            encSum(mDefaultKeys[pIdx], request, fx);
+
+        // send back the OPRF output share once every shard is done.
+		mListenChls[chlIdx].asyncSend(std::move(fx));
+	}
 
-			for (u64 j = 1; j < fx.size(); ++j)
-				fx[0] = fx[0] ^ fx[j];
+    void Npr03SymDprf::encSum(const MultiKeyAES& keys, span<block> in, span<block> out)
+    {
+        auto work = in.size() * keys.size();
+        auto numShards = mThreadPool ? std::min<u64>(mThreadPool->numThreads(), work / mMinShardWork) : 1;
 
-			fx.resize(1);
-		}
-		else
-		{
-            // If several OPRF values are evaluated in parallel, then we apply a single key to several
-            // OPRF inputs at a time. 
+        if (numShards < 2)
+        {
+            keys.ecbEncBlocksSum(in.data(), in.size(), out.data());
+            return;
+        }
 
-			auto numKeys = mDefaultKeys[pIdx].mAESs.size();
-			std::vector<block> buff2(request.size());
-			for (u64 i = 0; i < numKeys; ++i)
-			{
-				mDefaultKeys[pIdx].mAESs[i].ecbEncBlocks(request.data(), request.size(), buff2.data());
-				for (u64 j = 0; j < request.size(); ++j)
-				{
-					fx[j] = fx[j] ^ buff2[j];
-				}
-			}
-		}
+        if (in.size() >= numShards * 8)
+        {
+            // Each shard gets at least one full tile of inputs and 
+            // writes the output shares of its slice of the inputs.
+            mThreadPool->parallelFor(in.size(), numShards, [&](u64 begin, u64 end)
+            {
+                keys.ecbEncBlocksSum(in.data() + begin, end - begin, out.data() + begin);
+            });
+        }
+        else
+        {
+            // A few inputs with many keys. Each shard sums over its own
+            // range of key groups and the partial sums are then XORed.
+            const u64 G = RoundKeyStore::GroupSize;
+            auto numGroups = (keys.size() + G - 1) / G;
+            numShards = std::min(numShards, numGroups);
+
+            oc::Matrix<block> partial(numShards, in.size());
+            mThreadPool->parallelFor(numShards, numShards, [&](u64 begin, u64 end)
+            {
+                for (auto s = begin; s < end; ++s)
+                {
+                    auto keyBegin = numGroups * s / numShards * G;
+                    auto keyEnd = std::min(numGroups * (s + 1) / numShards * G, keys.size());
+                    keys.ecbEncBlocksSum(in.data(), in.size(), partial[s].data(), keyBegin, keyEnd);
+                }
+            });
 
-        // send back the OPRF output share.
-		mListenChls[chlIdx].asyncSend(std::move(fx));
-	}
+            std::memcpy(out.data(), partial[0].data(), out.size() * sizeof(block));
+            for (u64 s = 1; s < numShards; ++s)
+                for (u64 i = 0; i < out.size(); ++i)
+                    out[i] = out[i] ^ partial[s][i];
+        }
+    }
 
 	block Npr03SymDprf::eval(block input)
 	{
@@ -199,23 +345,16 @@ namespace dEnc {
 	{
         TODO("Add support for sending the party identity for allowing encryption to be distinguished from decryption. ");
 
-        // Send the OPRF input to the next m-1 parties
-		auto end = mPartyIdx + mM;
-		for (u64 i = mPartyIdx + 1; i < end; ++i)
-		{
-			auto c = i % mN;
-			if (c > mPartyIdx) --c;
+        // Gather concurrent single evaluations into one request.
+        auto coalescer = std::atomic_load(&mCoalescer);
+        if (coalescer)
+            return coalescer->add(input);
 
-			mRequestChls[c].asyncSendCopy(&input, 1);
-		}
-
-
-        // Set up the completion callback "AsyncEval".
-        // This object holds a function that is called when 
-        // the user wants to async eval to complete. This involves
-        // receiving the OPRF output shares from the other parties
-        // and combining them with the local share.
-		AsyncEval ae;
+        // Only the next m-1 parties are contacted by this code path. Other 
+        // selection policies go through the general one, which also reports
+        // the round trip times to mSelector.
+        if (mSelector->policy() != PartySelector::Policy::Cyclic)
+            return asyncEval(span<block>(&input, 1));
 
         struct State
         {
@@ -230,31 +369,42 @@ namespace dEnc {
         // allocate space to store the OPRF output shares
         auto w = std::make_shared<State>(mM);
 
-        // Futures which allow us to block until the repsonces have 
-        // been received
-
-
-        // Evaluate the local OPRF output share.
-        std::vector<block> buff(mDefaultKeys[mPartyIdx].mAESs.size());
-        mDefaultKeys[mPartyIdx].ecbEncBlock(input, buff.data());
-
-        // store this share at the end of fx
-		auto& b = w->fx.back();
-        b = oc::ZeroBlock;
-		for (u64 i = 0; i < buff.size(); ++i)
-			b = b ^ buff[i];
-
-        // queue up the receive operations to receive the OPRF output shares
-		for (u64 i = mPartyIdx + 1, j = 0; j < w->async.size(); ++i, ++j)
-		{
-			auto c = i % mN;
-			if (c > mPartyIdx) --c;
+        {
+            // The sends and receives of concurrent evaluations must
+            // be queued on the channels in the same order.
+            std::lock_guard<std::mutex> lock(mRequestMtx);
+
+            // Send the OPRF input to the next m-1 parties
+		    auto end = mPartyIdx + mM;
+		    for (u64 i = mPartyIdx + 1; i < end; ++i)
+		    {
+			    auto c = i % mN;
+			    if (c > mPartyIdx) --c;
+
+			    mRequestChls[c].asyncSendCopy(&input, 1);
+		    }
+
+            // queue up the receive operations to receive the OPRF output shares.
+            // Futures allow us to block until the repsonces have been received.
+		    for (u64 i = mPartyIdx + 1, j = 0; j < w->async.size(); ++i, ++j)
+		    {
+			    auto c = i % mN;
+			    if (c > mPartyIdx) --c;
+
+			    w->async[j] = mRequestChls[c].asyncRecv(&w->fx[j], 1);
+		    }
+        }
 
-			w->async[j] = mRequestChls[c].asyncRecv(&w->fx[j], 1);
-		}
+        // Evaluate the local OPRF output share and store 
+        // this share at the end of fx
+        w->fx.back() = mDefaultKeys[mPartyIdx].ecbEncBlockSum(input);
 
-        // This function is called when the user wants the actual 
-        // OPRF output. It must combine the OPRF output shares
+        // Set up the completion callback "AsyncEval".
+        // This object holds a function that is called when 
+        // the user wants to async eval to complete. This involves
+        // receiving the OPRF output shares from the other parties
+        // and combining them with the local share.
+		AsyncEval ae;
         ae.get = [this, w = std::move(w)]() mutable ->std::vector<block> 
         {
             // block until all of the OPRF output shares have arrived.
@@ -273,80 +423,177 @@ namespace dEnc {
 
 	AsyncEval Npr03SymDprf::asyncEval(span<block> in)
 	{
+        // send this input to the m-1 parties chosen by the selection policy.
+        auto parties = mSelector->select(mM - 1);
+
+        // The servers assume the next m-1 parties unless the request names the quorum.
+        bool isDefault = true;
+        for (u64 i = 0; i < parties.size(); ++i)
+            isDefault &= parties[i] == (mPartyIdx + i + 1) % mN;
+
+        if (isDefault == false)
+        {
+            oc::BitVector quorum(mN);
+            quorum[mPartyIdx] = true;
+            for (auto p : parties)
+                quorum[p] = true;
+
+            return asyncEval(in, quorum);
+        }
+
+        std::vector<u8> request((u8*)in.data(), (u8*)(in.data() + in.size()));
+        return asyncEval(in, std::move(parties), std::move(request));
+	}
+
+	AsyncEval Npr03SymDprf::asyncEval(block input, const oc::BitVector& quorum)
+	{
+        return asyncEval(span<block>(&input, 1), quorum);
+	}
+
+	AsyncEval Npr03SymDprf::asyncEval(span<block> in, const oc::BitVector& quorum)
+	{
+        if (quorum.size() != mN || quorum[mPartyIdx] == 0 || quorum.hammingWeight() != mM)
+            throw std::runtime_error("the quorum must contain this party and m parties in total. " LOCATION);
+
+        // send this input to the other parties in the quorum.
+        std::vector<u64> parties; parties.reserve(mM - 1);
+        for (u64 i = 1; i < mN; ++i)
+        {
+            auto p = (mPartyIdx + i) % mN;
+            if (quorum[p])
+                parties.push_back(p);
+        }
+
+        RequestTrailer trailer;
+        trailer.setQuorum(quorum);
+
+        std::vector<u8> request((u8*)in.data(), (u8*)(in.data() + in.size()));
+        trailer.append(request);
+
+        return asyncEval(in, std::move(parties), std::move(request));
+	}
+
+	AsyncEval Npr03SymDprf::asyncEval(span<block> in, std::vector<u64> parties, std::vector<u8> request)
+	{
         struct State
         {
-            std::vector<block> out, in, fxx;
+            std::vector<block> out;
+            std::vector<u8> request;
+
+            // Each row holds the OPRF output shares from one party.
+            std::vector<std::vector<block>> fx;
             std::unique_ptr<std::future<void>[]> async;
+
+            // The selector that the contacted parties are reported to, the number 
+            // of parties it was told the request was sent to, and which of them 
+            // have since been reported as responded or failed.
+            std::shared_ptr<PartySelector> selector;
+            std::vector<u64> parties;
+            u64 numSent = 0;
+            std::unique_ptr<std::atomic<bool>[]> settled;
+
+            // A receive that fails does not call its callback, and get() stops at
+            // the first failure or may not be called at all. Any contacted party 
+            // that has not been settled by the time the state is released, i.e. 
+            // once every receive has completed or failed, is reported as failed.
+            ~State()
+            {
+                for (u64 k = 0; k < numSent; ++k)
+                    if (settle(k))
+                        selector->onFailure(parties[k]);
+            }
+
+            // Returns true the first time it is called for the k'th contacted party, 
+            // which is then reported to the selector exactly once.
+            bool settle(u64 k)
+            {
+                return settled[k].exchange(true) == false;
+            }
         };
         auto state = std::make_shared<State>();
 
         // allocate space to store the OPRF outputs.
         state->out.resize(in.size());
 
-
-        // Copy the inputs into a shared vector so that it 
+        // Move the request into a shared vector so that it 
         // can be sent to all parties using one allocation.
-        state->in.insert(state->in.end(), in.begin(), in.end());
-
-        // send this input to all parties
-		auto end = mPartyIdx + mM;
-		for (u64 i = mPartyIdx + 1; i < end; ++i)
-		{
-			auto c = i % mN;
-			if (c > mPartyIdx) --c;
-
-            // This send is smart and will increment the ref count of
-            // the shared pointer
-			mRequestChls[c].asyncSend(state->in);
-		}
-
-		auto numKeys = mDefaultKeys[mPartyIdx].mAESs.size();
-
-        // evaluate the local OPRF output shares
-		std::vector<block> buff2(in.size());
-		for (u64 i = 0; i < numKeys; ++i)
-		{
-			mDefaultKeys[mPartyIdx].mAESs[i].ecbEncBlocks(in.data(), in.size(), buff2.data());
-            auto& out = state->out;
-			for (u64 j = 0; j < out.size(); ++j)
-			{
-				out[j] = out[j] ^ buff2[j];
-			}
-		}
+        state->request = std::move(request);
 
         // allocate space to store the other OPRF output shares
-		auto numRecv = (mM - 1);
-        state->fxx.resize(numRecv* in.size());
-		//auto fxx(new block[numRecv * in.size()]);
-
-        // Each row of fx will hold a the OPRF output shares from one party
-		oc::MatrixView<block> fx(state->fxx.begin(), state->fxx.end(), in.size());
+		auto numRecv = parties.size();
+        state->fx.resize(numRecv);
 
         // allocate space to store the futures which allow us to block until the
         // other OPRF output shares have arrived.
         state->async.reset(new std::future<void>[numRecv]);
 
-        // schedule the receive operations for the other OPRF output shares.
-		for (u64 i = mPartyIdx + 1, j = 0; j < numRecv; ++i, ++j)
-		{
-			auto c = i % mN;
-			if (c > mPartyIdx) --c;
+        state->selector = mSelector;
+        state->parties = parties;
+        state->settled.reset(new std::atomic<bool>[numRecv]);
+        for (u64 j = 0; j < numRecv; ++j)
+            state->settled[j] = false;
 
-			state->async[j] = mRequestChls[c].asyncRecv(fx[j]);
-		}
+        {
+            // The sends and receives of concurrent evaluations must
+            // be queued on the channels in the same order.
+            std::lock_guard<std::mutex> lock(mRequestMtx);
+
+            // send this request to all parties
+		    for (auto p : parties)
+		    {
+			    auto c = p;
+			    if (c > mPartyIdx) --c;
+
+                // This send is smart and will increment the ref count of
+                // the shared pointer
+			    mRequestChls[c].asyncSend(state->request);
+		    }
+
+            // schedule the receive operations for the other OPRF output shares.
+            // The callback reports the round trip time to the selector.
+		    for (u64 j = 0; j < numRecv; ++j)
+		    {
+			    auto p = parties[j];
+			    auto c = p;
+			    if (c > mPartyIdx) --c;
+
+                auto sent = mSelector->onSend(p);
+                ++state->numSent;
+			    state->async[j] = mRequestChls[c].asyncRecv(state->fx[j], [state, p, j, sent]()
+                {
+                    if (state->settle(j))
+                        state->selector->onResponse(p, sent);
+                });
+		    }
+        }
+
+        // evaluate the local OPRF output shares. This party contributes first
+        // and therefore uses all of its keys.
+        mDefaultKeys[mPartyIdx].ecbEncBlocksSum(in.data(), in.size(), state->out.data());
 
         // construct the completion handler that is called when the user wants to 
         // actual OPRF output. This requires blocking to receive the OPRF output
         // and then combining it.
 		AsyncEval ae;
-		ae.get = [state, numRecv, fx]() mutable -> std::vector<block>
+		ae.get = [state, numRecv]() mutable -> std::vector<block>
 		{
             auto& o = state->out;
 			for (u64 i = 0; i < numRecv; ++i)
 			{
-                state->async[i].get();
+                // The parties after a failed one are settled by their 
+                // callback, or once the state is released.
+                try { state->async[i].get(); }
+                catch (...)
+                {
+                    if (state->settle(i))
+                        state->selector->onFailure(state->parties[i]);
+                    throw;
+                }
+
+				auto& buff2 = state->fx[i];
+                if (buff2.size() != o.size())
+                    throw std::runtime_error("bad DPRF response size. " LOCATION);
 
-				auto buff2 = fx[i];
 				for (u64 j = 0; j < o.size(); ++j)
 				{
 					o[j] = o[j] ^ buff2[j];
@@ -399,41 +646,106 @@ namespace dEnc {
 		}
 	}
 
-	void Npr03SymDprf::constructDefaultKeys(u64 pIdx, oc::Matrix<u64>& mKeyIdxs, span<block> myKeys)
+	void Npr03SymDprf::constructDefaultKeys(u64 pIdx)
     {
         // Default keys are computed taking all the keys that party pIdx has
         // followed by all the missing keys party pIdx+1 has and so on.
+		std::vector<u8> before(mN, 0);
+		for (auto p = pIdx; p != mPartyIdx; p = (p + 1) % mN)
+			before[p] = 1;
 
-        // A list indicating which keys have already been accounted for.
-		std::vector<u8> keyList(mD, 0);
-		auto p = pIdx;
+        // initialize the "multi-key" AES instance with these keys.
+		auto keys = selectKeys(before);
+		mDefaultKeys[pIdx].setKeys(keys);
+	}
 
-        // First lets figure out what keys are been provided 
-        // by parties {pIdx, pIdx+1, ..., mPartyIdx-1} 
-		while (p != mPartyIdx)
-		{
-			for (u64 i = 0; i < myKeys.size(); ++i)
-				keyList[mKeyIdxs(p, i)] = 1;
+	std::vector<block> Npr03SymDprf::selectKeys(const std::vector<u8>& before) const
+    {
+		std::vector<block> keys; keys.reserve(mMyKeys.size());
 
-			p = (p + 1) % mN;
-		}
+        if (mKeyStructure.rows())
+        {
+            // A list indicating which keys have already been accounted for.
+		    std::vector<u8> keyList(mD, 0);
+            for (u64 p = 0; p < mN; ++p)
+            {
+                if (before[p])
+                {
+			        for (u64 i = 0; i < mKeyStructure.stride(); ++i)
+				        keyList[mKeyStructure(p, i)] = 1;
+                }
+            }
 
-        // Now lets see if any remaining keys that this party can contribute.
-		std::vector<block> keys; keys.reserve(myKeys.size());
-		for (u64 j = 0; j < myKeys.size(); ++j)
-		{
-			if (keyList[mKeyIdxs(mPartyIdx, j)] == 0)
-				keys.push_back(myKeys[j]);
-		}
+            // Now lets see if any remaining keys that this party can contribute.
+		    for (u64 j = 0; j < mMyKeys.size(); ++j)
+		    {
+			    if (keyList[mKeyStructure(mPartyIdx, j)] == 0)
+				    keys.push_back(mMyKeys[j]);
+		    }
+        }
+        else
+        {
+            // The j'th key of this party belongs to the j'th subset containing 
+            // this party. Iterate over the other members of these subsets in 
+            // lexicographic order, mapped to {0,...,mN-2}.
+		    std::vector<u64> others(mN - mM);
+		    for (u64 i = 0; i < others.size(); ++i)
+			    others[i] = i;
+
+		    for (u64 j = 0; j < mMyKeys.size(); ++j)
+		    {
+			    bool covered = false;
+			    for (auto o : others)
+				    covered |= before[o + (o >= u64(mPartyIdx))] != 0;
+
+			    if (covered == false)
+				    keys.push_back(mMyKeys[j]);
+
+			    nextSubset(others, mN - 1);
+		    }
+        }
 
-        // initialize the "multi-key" AES instance with these keys.
-		mDefaultKeys[pIdx].setKeys(keys);
+        return keys;
+	}
+
+	std::shared_ptr<MultiKeyAES> Npr03SymDprf::getQuorumKeys(u64 pIdx, const oc::BitVector& quorum)
+    {
+        if (quorum.size() != mN || quorum[pIdx] == 0 || quorum[mPartyIdx] == 0 || quorum.hammingWeight() != mM)
+            throw std::runtime_error("invalid quorum. " LOCATION);
+
+        // The requester contributes first, followed by the rest of the 
+        // quorum in cyclic order. 
+		std::vector<u8> before(mN, 0);
+        bool isDefault = true;
+		for (u64 p = pIdx; p != mPartyIdx; p = (p + 1) % mN)
+        {
+            before[p] = quorum[p];
+            isDefault &= quorum[p] != 0;
+        }
+
+        // The parties pIdx, ..., mPartyIdx are all in the quorum. Only the set of 
+        // parties before this one matter, and so the default keys can be used.
+        if (isDefault)
+            return std::shared_ptr<MultiKeyAES>(std::shared_ptr<MultiKeyAES>(), &mDefaultKeys[pIdx]);
+
+        std::string key(sizeof(u64) + quorum.sizeBytes(), 0);
+        memcpy(&key[0], &pIdx, sizeof(u64));
+        memcpy(&key[sizeof(u64)], quorum.data(), quorum.sizeBytes());
+
+        return mQuorumKeys.getOrInsert(key, [&]()
+        {
+            auto keys = selectKeys(before);
+            return std::make_shared<MultiKeyAES>(keys);
+        });
 	}
 
 	void Npr03SymDprf::close()
 	{
         if (mIsClosed == false)
         {
+            // send any coalesced evaluations before closing.
+            disableCoalescing();
+
             mIsClosed = true;
 
 		    u8 close[1];
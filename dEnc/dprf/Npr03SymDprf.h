@@ -8,6 +8,8 @@
 
 #include "Dprf.h"
 #include "dEnc/tools/MultiKeyAES.h"
+#include "dEnc/tools/LruCache.h"
+#include <cryptoTools/Common/BitVector.h>
 
 namespace dEnc {
 
@@ -23,6 +25,25 @@ namespace dEnc {
         // This struct can be used to inititialize the parties.
         struct MasterKey
         {
+            // How the sub-keys are stored.
+            enum class KeyMode
+            {
+                // Every sub-key is sampled and stored in keys, keyStructure and subKeys.
+                Explicit,
+                // Only seed is stored. The sub-key of the subset with lexicographic
+                // index i is AES_seed(i) and is computed when it is needed.
+                Derived
+            };
+
+            // The mode that the keys were generated with.
+            KeyMode mode = KeyMode::Explicit;
+
+            // The number of parties and the threshold.
+            u64 n = 0, m = 0;
+
+            // The key of the PRF that the sub-keys are derived from in KeyMode::Derived.
+            block seed;
+
             // A list of the individual KeyShare Shares
             std::vector<block> keys;
 
@@ -39,15 +60,45 @@ namespace dEnc {
              * @param[in] n         - The number of parties in the OPRF protocol
              * @param[in] m         - The threshold of the OPRF protocol
              * @param[in] prng      - The randomness source used to generate the keys
+             * @param[in] mode      - Whether the sub-keys are stored or derived from a seed.
              */
-            void KeyGen(u64 n, u64 m, PRNG& prng);
+            void KeyGen(u64 n, u64 m, PRNG& prng, KeyMode mode = KeyMode::Explicit);
 
             /**
              * Returns the keys that party partyIdx should use. The index of these keys
-             * can be obtained by looking at subKeys.
+             * can be obtained by looking at subKeys. Only available in KeyMode::Explicit.
+             * @param[in] partyIdx  - The index of the party 
+             */
+            oc::span<block> getSubkey(u64 partyIdx) 
+            {
+                if (mode != KeyMode::Explicit)
+                    throw std::runtime_error("the sub-keys are not stored, use expandSubkey(...). " LOCATION);
+                return subKeys[partyIdx]; 
+            }
+
+            /**
+             * Returns the keys that party partyIdx should use in either mode. The j'th 
+             * key is the key of the j'th subset, in lexicographic order, that contains partyIdx.
              * @param[in] partyIdx  - The index of the party 
              */
-            oc::span<block> getSubkey(u64 partyIdx) { return subKeys[partyIdx]; }
+            std::vector<block> expandSubkey(u64 partyIdx) const;
+
+            /**
+             * Returns the key with the given index, i.e. the key of the keyIdx'th
+             * subset of the parties in lexicographic order.
+             * @param[in] keyIdx  - The index of the key.
+             */
+            block getKey(u64 keyIdx) const;
+
+            /**
+             * Computes keyStructure(partyIdx, j) without storing the key structure, 
+             * i.e. the index of the j'th key of party partyIdx.
+             * @param[in] n         - The number of parties in the OPRF protocol
+             * @param[in] m         - The threshold of the OPRF protocol
+             * @param[in] partyIdx  - The index of the party 
+             * @param[in] j         - The index of the key within the party's keys.
+             */
+            static u64 keyIndex(u64 n, u64 m, u64 partyIdx, u64 j);
         };
 
 
@@ -85,6 +136,15 @@ namespace dEnc {
         // use then party i requrests an evaluation, i.e. mDefaultKeys[i].
         std::vector<MultiKeyAES> mDefaultKeys;
 
+        // The keys that this party uses when a request names a quorum other than 
+        // the default one. The key is the requester's index followed by the quorum.
+        LruCache<std::string, std::shared_ptr<MultiKeyAES>> mQuorumKeys;
+
+        // The minimum number of AES evaluations, i.e. inputs times keys, that
+        // serveOne hands to each thread of the pool set by setThreadPool(...).
+        // Smaller requests are not worth the hand off to other threads.
+        u64 mMinShardWork = 1 << 15;
+
         /**
          * Initializes the DPRF with an existing key. 
          * @param[in] partyIdx     - The index of this party
@@ -104,6 +164,25 @@ namespace dEnc {
             oc::Matrix<u64>& keyStructure,
             span<block> keys);
 
+        /**
+         * Initializes the DPRF with an existing key where the key structure is the 
+         * one generated by MasterKey::KeyGen. The key structure is not stored but
+         * computed when it is needed.
+         * @param[in] partyIdx     - The index of this party
+         * @param[in] m            - The threshold of the scheme
+         * @param[in] requestChls  - N Channels that eval requests should be sent over
+         * @param[in] listenChls   - N Channels that should be listened to for eval requests
+         * @param[in] seed         - A random seed
+         * @param[in] keys         - The keys that this party has, see MasterKey::expandSubkey.
+         */
+        void init(
+            u64 partyIdx,
+            u64 m,
+            span<Channel> requestChls,
+            span<Channel> listenChls,
+            block seed,
+            span<block> keys);
+
         /**
          * The server routine which takes a request string (OPRF input)
          * and sends back the corresponding OPRF output share to the
@@ -133,6 +212,27 @@ namespace dEnc {
          */
         virtual AsyncEval asyncEval(span<block> input) override;
 
+        /**
+         * A non blocking call to evaluate the OPRF with a specific set of parties. 
+         * This allows routing around a party that is slow or unavailable.
+         * To complete the OPRF evaluation call AsyncEval::get();
+         * @param[in] input        - The OPRF input.
+         * @param[in] quorum       - A bit vector of size n where the i'th bit is set if party i
+         *                           should be contacted. Exactly m bits must be set, including
+         *                           the bit of this party.
+         */
+        AsyncEval asyncEval(block input, const oc::BitVector& quorum);
+
+        /**
+         * A non blocking call to evaluate several independent OPRF values with a 
+         * specific set of parties. To complete the OPRF evaluation call AsyncEval::get();
+         * @param[in] input        - The list of OPRF inputs.
+         * @param[in] quorum       - A bit vector of size n where the i'th bit is set if party i
+         *                           should be contacted. Exactly m bits must be set, including
+         *                           the bit of this party.
+         */
+        AsyncEval asyncEval(span<block> input, const oc::BitVector& quorum);
+
         /**
          * Shuts down the servers that are listening for more OPRF requrests
          */
@@ -148,11 +248,53 @@ namespace dEnc {
 
         /**
          * Precomputes the default keys that should be used when party pIdx contacts this party 
-         * with an OPRF evaluation request. In the case that some of these parties are not
-         * available a different set of keys may be requires. Implementing such a fucntionality
-         * is future work.
+         * with an OPRF evaluation request, i.e. when the parties {pIdx, pIdx+1, ..., pIdx+m-1}
+         * take part. Other quorums are handled by getQuorumKeys(...).
+         */
+        void constructDefaultKeys(u64 pIdx);
+
+        /**
+         * Returns the keys of this party that none of the parties in "before" hold. 
+         * The parties of an evaluation contribute their keys in order, and each 
+         * party contributes the keys that have not been contributed already.
+         * @param[in] before  - before[i] is set if party i contributes before this party.
          */
-        void constructDefaultKeys(u64 pIdx, oc::Matrix<u64>& keyStructure, span<block> myKeys);
+        std::vector<block> selectKeys(const std::vector<u8>& before) const;
+
+        /**
+         * Returns the keys that should be used when party pIdx requests an evaluation with 
+         * the given quorum. The requester contributes first, followed by the other parties 
+         * in the quorum in cyclic order. For the default quorum this points to (but does
+         * not own) mDefaultKeys[pIdx]. Throws if the quorum is not valid.
+         * @param[in] pIdx     - The index of the requesting party.
+         * @param[in] quorum   - The parties taking part in the evaluation.
+         */
+        std::shared_ptr<MultiKeyAES> getQuorumKeys(u64 pIdx, const oc::BitVector& quorum);
+
+        /**
+         * Sends the request to the parties, evaluates the local output shares and
+         * returns the handle that combines them.
+         * @param[in] in       - The inputs.
+         * @param[in] parties  - The other parties that should be contacted.
+         * @param[in] request  - The serialized request, i.e. the inputs followed by an optional trailer.
+         */
+        AsyncEval asyncEval(span<block> in, std::vector<u64> parties, std::vector<u8> request);
+
+        /**
+         * Computes out[i] = XOR_k AES_k(in[i]) over every key in keys. A large request
+         * is split across mThreadPool, by inputs if there are enough of them and by 
+         * key groups otherwise. Each shard writes to its own slice of out, or XORs
+         * its partial sums into it.
+         * @param[in] keys  - The keys that are summed over.
+         * @param[in] in    - The inputs.
+         * @param[out] out  - The output shares, of the same size as in.
+         */
+        void encSum(const MultiKeyAES& keys, span<block> in, span<block> out);
+
+        /**
+         * Sets the members that are common to both init(...) overloads.
+         */
+        void setup(u64 partyIdx, u64 m, span<Channel> requestChls, span<Channel> listenChls, block seed);
 
         // Buffers that are used to receive the client DPRF evaluation requests
         std::vector<std::vector<u8>> mRecvBuff;
@@ -171,8 +313,18 @@ namespace dEnc {
         // Channels that the client should send their DPRF requests over.
         std::vector<Channel> mRequestChls;
 
+        // Serializes queuing the sends and receives of concurrent evaluations.
+        std::mutex mRequestMtx;
+
         // Channels that the servers should listen to for DPRF requests.
         std::vector<Channel> mListenChls;
+
+        // The keys that this party holds.
+        std::vector<block> mMyKeys;
+
+        // A copy of the key structure, if this party was initialized with one. 
+        // Otherwise the key structure of MasterKey::KeyGen is computed.
+        oc::Matrix<u64> mKeyStructure;
     };
 
 }
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "PartySelector.h"
+#include <algorithm>
+
+namespace dEnc {
+
+    namespace
+    {
+        // The smallest and largest round trip time that a failure results in.
+        const u64 MinFailurePenaltyNs = 1000000;
+        const u64 MaxEwmaNs = 60000000000ull;
+    }
+
+    PartySelector::PartySelector(u64 n, u64 partyIdx, Policy policy, block seed)
+        : mN(n)
+        , mPartyIdx(partyIdx)
+        , mPolicy(policy)
+        , mStats(new Stats[n])
+        , mPrng(seed)
+    {}
+
+    std::vector<u64> PartySelector::select(u64 count)
+    {
+        if (count > mN - 1)
+            throw std::runtime_error("can not select more parties than there are. " LOCATION);
+
+        std::vector<u64> ret; ret.reserve(count);
+
+        switch (mPolicy.load())
+        {
+        case Policy::Cyclic:
+            for (u64 i = 1; i <= count; ++i)
+                ret.push_back((mPartyIdx + i) % mN);
+            break;
+        case Policy::RoundRobin:
+        {
+            auto offset = mNext++ % (mN - 1);
+            for (u64 i = 0; i < count; ++i)
+                ret.push_back((mPartyIdx + 1 + (offset + i) % (mN - 1)) % mN);
+            break;
+        }
+        case Policy::LeastOutstanding:
+            ret = cheapest(count, [&](u64 p) { return double(mStats[p].mOutstanding); });
+            break;
+        case Policy::EwmaLatency:
+        {
+            // unmeasured parties are assumed to be as fast as the average measured 
+            // one, so that they are tried without being preferred over parties that
+            // are known to be fast, and more so the more requests they have in flight.
+            auto prior = std::max<u64>(1, meanEwma());
+            ret = cheapest(count, [&](u64 p) {
+                auto ewma = mStats[p].mEwmaNs.load();
+                return double(ewma ? ewma : prior) * (mStats[p].mOutstanding + 1); });
+            break;
+        }
+        case Policy::PowerOfTwoChoices:
+        {
+            std::vector<u64> candidates; candidates.reserve(mN - 1);
+            for (u64 i = 1; i < mN; ++i)
+                candidates.push_back((mPartyIdx + i) % mN);
+
+            std::lock_guard<std::mutex> lock(mPrngMtx);
+            for (u64 i = 0; i < count; ++i)
+            {
+                // move the chosen candidate to position i.
+                auto remaining = candidates.size() - i;
+                auto a = i + mPrng.get<u64>() % remaining;
+                auto b = i + mPrng.get<u64>() % remaining;
+                if (mStats[candidates[b]].mOutstanding < mStats[candidates[a]].mOutstanding)
+                    a = b;
+
+                std::swap(candidates[i], candidates[a]);
+                ret.push_back(candidates[i]);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("unknown party selection policy. " LOCATION);
+        }
+
+        return ret;
+    }
+
+    template<typename Cost>
+    std::vector<u64> PartySelector::cheapest(u64 count, Cost&& cost) const
+    {
+        std::vector<std::pair<double, u64>> c; c.reserve(mN - 1);
+        for (u64 i = 1; i < mN; ++i)
+        {
+            auto p = (mPartyIdx + i) % mN;
+            c.emplace_back(cost(p), i);
+        }
+
+        std::partial_sort(c.begin(), c.begin() + count, c.end());
+
+        std::vector<u64> ret(count);
+        for (u64 i = 0; i < count; ++i)
+            ret[i] = (mPartyIdx + c[i].second) % mN;
+        return ret;
+    }
+
+    PartySelector::Clock::time_point PartySelector::onSend(u64 party)
+    {
+        ++mStats[party].mOutstanding;
+        return Clock::now();
+    }
+
+    void PartySelector::onResponse(u64 party, Clock::time_point sent)
+    {
+        auto& s = mStats[party];
+        --s.mOutstanding;
+
+        auto rtt = (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count();
+
+        // ewma = 7/8 * ewma + 1/8 * rtt, where the first sample is taken as is.
+        auto old = s.mEwmaNs.load();
+        u64 next;
+        do {
+            next = old ? old - old / 8 + rtt / 8 : rtt;
+        } while (!s.mEwmaNs.compare_exchange_weak(old, next));
+    }
+
+    void PartySelector::onFailure(u64 party)
+    {
+        auto& s = mStats[party];
+        --s.mOutstanding;
+
+        // A failure doubles the average round trip time, starting from the average 
+        // of the other parties if there is no measurement yet. A party that keeps 
+        // failing is then avoided by EwmaLatency, and recovers as it responds again.
+        auto prior = std::max<u64>(MinFailurePenaltyNs, meanEwma());
+        auto old = s.mEwmaNs.load();
+        u64 next;
+        do {
+            next = std::min<u64>(MaxEwmaNs, 2 * (old ? old : prior));
+        } while (!s.mEwmaNs.compare_exchange_weak(old, next));
+    }
+
+    u64 PartySelector::meanEwma() const
+    {
+        u64 sum = 0, count = 0;
+        for (u64 i = 1; i < mN; ++i)
+        {
+            auto ewma = mStats[(mPartyIdx + i) % mN].mEwmaNs.load();
+            sum += ewma;
+            count += ewma != 0;
+        }
+        return count ? sum / count : 0;
+    }
+}
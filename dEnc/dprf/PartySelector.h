@@ -0,0 +1,105 @@
+#pragma once
+
+#include <dEnc/Defines.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+namespace dEnc {
+
+    // Chooses which of the other parties a DPRF request is sent to. The
+    // selection is based on per-party statistics: the number of requests
+    // that are in flight, and an exponentially weighted moving average of
+    // the round trip time. The DPRFs report every request to the selector
+    // via onSend(...) and onResponse(...).
+    class PartySelector
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class Policy
+        {
+            // The next parties in cyclic order, i.e. mPartyIdx + 1, mPartyIdx + 2, ...
+            Cyclic,
+            // The next parties in cyclic order, starting one party further on each request.
+            RoundRobin,
+            // The parties with the fewest requests in flight.
+            LeastOutstanding,
+            // The parties with the lowest average round trip time, weighted by
+            // the number of requests in flight. Parties that have not responded 
+            // yet are assumed to have the average of the others.
+            EwmaLatency,
+            // For each slot, the less loaded of two random parties.
+            PowerOfTwoChoices
+        };
+
+        /**
+         * @param[in] n         - The number of parties.
+         * @param[in] partyIdx  - The index of this party, which is never selected.
+         * @param[in] policy    - How parties are selected.
+         * @param[in] seed      - The seed for the random choices of PowerOfTwoChoices.
+         */
+        PartySelector(u64 n, u64 partyIdx, Policy policy, block seed);
+
+        void setPolicy(Policy policy) { mPolicy = policy; }
+        Policy policy() const { return mPolicy; }
+
+        /**
+         * Returns count distinct parties other than this one, in order of preference.
+         * @param[in] count  - The number of parties, at most n-1.
+         */
+        std::vector<u64> select(u64 count);
+
+        /**
+         * Records that a request was sent to party and returns the time it was sent.
+         * @param[in] party  - The index of the party.
+         */
+        Clock::time_point onSend(u64 party);
+
+        /**
+         * Records that the response of party to the request sent at time sent has arrived.
+         * @param[in] party  - The index of the party.
+         * @param[in] sent   - The value returned by onSend(...).
+         */
+        void onResponse(u64 party, Clock::time_point sent);
+
+        /**
+         * Records that the request to party failed, which doubles its average round trip time.
+         * @param[in] party  - The index of the party.
+         */
+        void onFailure(u64 party);
+
+        // The number of requests to party that are in flight.
+        u64 outstanding(u64 party) const { return mStats[party].mOutstanding; }
+
+        // The average round trip time of party, or zero if it has not responded yet.
+        std::chrono::nanoseconds latency(u64 party) const { return std::chrono::nanoseconds(mStats[party].mEwmaNs); }
+
+    private:
+        struct Stats
+        {
+            std::atomic<u64> mOutstanding{ 0 };
+            std::atomic<u64> mEwmaNs{ 0 };
+        };
+
+        // The average round trip time of the parties that have a measurement, or zero.
+        u64 meanEwma() const;
+
+        // Returns the other parties sorted by cost, ties broken by cyclic order.
+        template<typename Cost>
+        std::vector<u64> cheapest(u64 count, Cost&& cost) const;
+
+        u64 mN, mPartyIdx;
+        std::atomic<Policy> mPolicy;
+        std::unique_ptr<Stats[]> mStats;
+
+        // The offset of the first party for RoundRobin.
+        std::atomic<u64> mNext{ 0 };
+
+        std::mutex mPrngMtx;
+        PRNG mPrng;
+    };
+
+}
@@ -0,0 +1,88 @@
+#include "Combinatorics.h"
+#include <algorithm>
+#include <limits>
+
+namespace dEnc
+{
+    u64 choose(u64 n, u64 k)
+    {
+        if (k > n)
+            return 0;
+
+        k = std::min(k, n - k);
+
+        // after step i, r = (n-k+i) choose i, which is always an integer.
+        u64 r = 1;
+        for (u64 i = 1; i <= k; ++i)
+        {
+            auto f = n - k + i;
+            if (r > std::numeric_limits<u64>::max() / f)
+                throw std::runtime_error("binomial coefficient overflows. " LOCATION);
+
+            r = r * f / i;
+        }
+        return r;
+    }
+
+    u64 rankSubset(span<const u64> subset, u64 n)
+    {
+        u64 k = subset.size();
+        u64 rank = 0;
+        u64 x = 0;
+
+        // count the subsets that agree with subset on the first i elements
+        // and have a smaller (i+1)'th element.
+        for (u64 i = 0; i < k; ++i)
+        {
+            if (subset[i] >= n || subset[i] < x)
+                throw std::runtime_error("subset is not sorted or out of range. " LOCATION);
+
+            for (; x < subset[i]; ++x)
+                rank += choose(n - 1 - x, k - 1 - i);
+
+            ++x;
+        }
+        return rank;
+    }
+
+    void unrankSubset(u64 rank, u64 n, span<u64> subset)
+    {
+        u64 k = subset.size();
+        if (rank >= choose(n, k))
+            throw std::runtime_error("rank is out of range. " LOCATION);
+
+        u64 x = 0;
+        for (u64 i = 0; i < k; ++i)
+        {
+            // skip all the subsets whose i'th element is smaller than x.
+            for (;; ++x)
+            {
+                auto c = choose(n - 1 - x, k - 1 - i);
+                if (rank < c)
+                    break;
+                rank -= c;
+            }
+
+            subset[i] = x++;
+        }
+    }
+
+    bool nextSubset(span<u64> subset, u64 n)
+    {
+        u64 k = subset.size();
+
+        // find the last element that can be incremented, i.e.
+        // subset[i] < n - k + i, and reset the ones after it.
+        for (u64 i = k; i-- > 0;)
+        {
+            if (subset[i] < n - k + i)
+            {
+                ++subset[i];
+                for (u64 j = i + 1; j < k; ++j)
+                    subset[j] = subset[j - 1] + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+}
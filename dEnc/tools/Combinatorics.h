@@ -0,0 +1,42 @@
+#pragma once
+#include "dEnc/Defines.h"
+
+namespace dEnc
+{
+    // Helpers for enumerating the k-subsets of {0, 1, ..., n-1}. A subset is
+    // represented as a sorted list of its elements, and subsets are ordered
+    // lexicographically, i.e. {0,1,2} < {0,1,3} < ... < {n-3,n-2,n-1}. This is the
+    // order in which Npr03SymDprf assigns the sub-keys to subsets of the parties.
+
+    /**
+     * Returns the binomial coefficient "n choose k". Throws if it does not fit in a u64.
+     * @param[in] n  - The size of the set.
+     * @param[in] k  - The size of the subsets.
+     */
+    u64 choose(u64 n, u64 k);
+
+    /**
+     * Returns the index of the subset in the lexicographic order of all
+     * subset.size()-subsets of {0, 1, ..., n-1}.
+     * @param[in] subset  - A sorted list of distinct elements less than n.
+     * @param[in] n       - The size of the set.
+     */
+    u64 rankSubset(span<const u64> subset, u64 n);
+
+    /**
+     * Writes the subset with the given lexicographic index to subset. The size
+     * of the subset is subset.size().
+     * @param[in] rank     - The index of the subset, less than choose(n, subset.size()).
+     * @param[in] n        - The size of the set.
+     * @param[out] subset  - The location that the sorted subset is written to.
+     */
+    void unrankSubset(u64 rank, u64 n, span<u64> subset);
+
+    /**
+     * Replaces the subset with the next subset in lexicographic order.
+     * Returns false if subset was the last one, in which case subset is unchanged.
+     * @param[in,out] subset  - A sorted list of distinct elements less than n.
+     * @param[in] n           - The size of the set.
+     */
+    bool nextSubset(span<u64> subset, u64 n);
+}
@@ -0,0 +1,72 @@
+#include "FixedBase.h"
+
+namespace dEnc
+{
+    FixedBaseTable::~FixedBaseTable()
+    {
+        clear();
+    }
+
+    FixedBaseTable& FixedBaseTable::operator=(const FixedBaseTable& o)
+    {
+        if (this != &o)
+        {
+            clear();
+            if (o.initialized())
+                init(o.mBase);
+        }
+        return *this;
+    }
+
+    FixedBaseTable& FixedBaseTable::operator=(FixedBaseTable&& o)
+    {
+        if (this != &o)
+        {
+            clear();
+            mBase = o.mBase;
+            mTable = std::move(o.mTable);
+        }
+        return *this;
+    }
+
+    void FixedBaseTable::init(const oc::REccPoint& base)
+    {
+        oc::REllipticCurve curve;
+        clear();
+
+        mBase = base;
+        mTable.reset(new ep_t[RLC_EP_TABLE]);
+        for (u64 i = 0; i < RLC_EP_TABLE; ++i)
+        {
+            ep_null(mTable[i]);
+            ep_new(mTable[i]);
+        }
+
+        ep_mul_pre(mTable.get(), mBase.mVal);
+    }
+
+    oc::REccPoint FixedBaseTable::mul(const oc::REccNumber& k) const
+    {
+        oc::REccPoint ret;
+        mul(k, ret);
+        return ret;
+    }
+
+    void FixedBaseTable::mul(const oc::REccNumber& k, oc::REccPoint& dest) const
+    {
+        if (initialized() == false)
+            throw std::runtime_error("the fixed base table is not initialized. " LOCATION);
+
+        ep_mul_fix(dest.mVal, mTable.get(), k.mVal);
+    }
+
+    void FixedBaseTable::clear()
+    {
+        if (mTable)
+        {
+            for (u64 i = 0; i < RLC_EP_TABLE; ++i)
+                ep_free(mTable[i]);
+            mTable.reset();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include <cryptoTools/Crypto/RCurve.h>
+#include <memory>
+
+namespace dEnc
+{
+    // Precomputed multiples of a fixed point which make multiplying that point 
+    // by a scalar several times faster than a variable base multiplication. 
+    // The table is built with relic's ep_mul_pre and used with ep_mul_fix, so its
+    // layout (comb, windowed, ...) follows the EP_FIX method relic was built with.
+    class FixedBaseTable
+    {
+    public:
+        FixedBaseTable() = default;
+        FixedBaseTable(const oc::REccPoint& base) { init(base); }
+        FixedBaseTable(const FixedBaseTable& o) { if (o.initialized()) init(o.mBase); }
+        FixedBaseTable(FixedBaseTable&&) = default;
+        ~FixedBaseTable();
+
+        FixedBaseTable& operator=(const FixedBaseTable& o);
+        FixedBaseTable& operator=(FixedBaseTable&& o);
+
+        /**
+         * Precomputes the table of base.
+         * @param[in] base  - The fixed point.
+         */
+        void init(const oc::REccPoint& base);
+
+        bool initialized() const { return mTable != nullptr; }
+
+        // The fixed point.
+        const oc::REccPoint& base() const { return mBase; }
+
+        /**
+         * Returns base() * k. The relic context of the calling thread must be set up,
+         * e.g. by an oc::REllipticCurve.
+         * @param[in] k  - The scalar.
+         */
+        oc::REccPoint mul(const oc::REccNumber& k) const;
+
+        /**
+         * Sets dest = base() * k without constructing a new point.
+         * @param[in] k      - The scalar.
+         * @param[out] dest  - The product.
+         */
+        void mul(const oc::REccNumber& k, oc::REccPoint& dest) const;
+
+    private:
+        void clear();
+
+        oc::REccPoint mBase;
+        std::unique_ptr<ep_t[]> mTable;
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include "FixedBase.h"
+#include "Msm.h"
+#include "Ristretto255.h"
+#include <cryptoTools/Crypto/RCurve.h>
+
+namespace dEnc
+{
+    // The prime order group backends of Npr03AsymDprfT. A backend provides
+    //   Num, Point   - The scalars and elements, with the interface of oc::REccNumber and oc::REccPoint.
+    //   Context      - Constructed on a thread before it uses the group, e.g. to set up thread local state.
+    //   FixedBase    - Precomputed multiples of a fixed point, with the interface of FixedBaseTable.
+    //   name()       - The name of the backend.
+    //   generator()  - The generator of the group.
+    //   isIdentity(p), multiScalarMul(points, scalars) and multiScalarMul(points, scalars, out).
+    //   normalize(points) - Prepares the points to be serialized, sharing the work between them.
+
+    // relic's default curve through cryptoTools.
+    struct RelicGroup
+    {
+        using Num = oc::REccNumber;
+        using Point = oc::REccPoint;
+        using Context = oc::REllipticCurve;
+        using FixedBase = FixedBaseTable;
+
+        static const char* name() { return "relic"; }
+
+        static Point generator()
+        {
+            Context curve;
+            return curve.getGenerator();
+        }
+
+        static bool isIdentity(const Point& p) { return ep_is_infty(p.mVal) != 0; }
+
+        static Point multiScalarMul(span<const Point> points, span<const Num> scalars)
+        {
+            return dEnc::multiScalarMul(points, scalars);
+        }
+
+        static void multiScalarMul(span<const Point> points, span<const Num> scalars, span<Point> out)
+        {
+            dEnc::multiScalarMul(points, scalars, out);
+        }
+
+        static void normalize(span<Point> points) { dEnc::normalize(points); }
+    };
+
+    // The in-tree ristretto255 group over the Edwards form of curve25519, see
+    // Ristretto255.h. Its encode to group is the elligator map, which takes no
+    // rejection sampling, and its arithmetic is specialized to the curve.
+    struct Rist255Group
+    {
+        using Num = Rist255Number;
+        using Point = Rist255Point;
+        using FixedBase = Rist255FixedBase;
+
+        // The group does not have any thread local state.
+        struct Context { Context() {} };
+
+        static const char* name() { return "ristretto255"; }
+
+        static Point generator() { return Point::generator(); }
+
+        static bool isIdentity(const Point& p) { return p.isIdentity(); }
+
+        static Point multiScalarMul(span<const Point> points, span<const Num> scalars)
+        {
+            return dEnc::multiScalarMul(points, scalars);
+        }
+
+        static void multiScalarMul(span<const Point> points, span<const Num> scalars, span<Point> out)
+        {
+            dEnc::multiScalarMul(points, scalars, out);
+        }
+
+        // The encoding takes an inverse square root of every point even if it is
+        // affine, and so a shared inversion would not save anything.
+        static void normalize(span<Point>) {}
+    };
+}
@@ -0,0 +1,103 @@
+#include "Lagrange.h"
+
+namespace dEnc
+{
+    template<typename Group>
+    void batchInvert(span<typename Group::Num> vals)
+    {
+        using Num = typename Group::Num;
+        typename Group::Context ctx;
+        auto n = vals.size();
+        if (n == 0)
+            return;
+
+        // prefix[i] = vals[0] * ... * vals[i].
+        std::vector<Num> prefix(n);
+        prefix[0] = vals[0];
+        for (u64 i = 1; i < n; ++i)
+            prefix[i] = prefix[i - 1] * vals[i];
+
+        if (prefix[n - 1] == 0)
+            throw std::runtime_error("can not invert zero. " LOCATION);
+
+        // inv = 1 / (vals[0] * ... * vals[i]), walking i down to zero.
+        Num inv = Num(1) / prefix[n - 1];
+        for (u64 i = n - 1; i > 0; --i)
+        {
+            auto v = vals[i];
+            vals[i] = inv * prefix[i - 1];
+            inv *= v;
+        }
+        vals[0] = inv;
+    }
+
+    template<typename Group>
+    std::vector<typename Group::Num> lagrangeAtZero(span<const typename Group::Num> x)
+    {
+        using Num = typename Group::Num;
+        typename Group::Context ctx;
+
+        //    l_i = PROD_{j != i} x_j / (x_j - x_i)
+        //        = (PROD_j x_j) / (x_i * PROD_{j != i} (x_j - x_i))
+        // where only the denominators need to be inverted.
+        auto m = x.size();
+        Num prod(1);
+        std::vector<Num> lag(m);
+        for (u64 i = 0; i < m; ++i)
+        {
+            prod *= x[i];
+
+            lag[i] = x[i];
+            for (u64 j = 0; j < m; ++j)
+                if (j != i) lag[i] *= x[j] - x[i];
+        }
+
+        batchInvert<Group>(lag);
+        for (auto& l : lag)
+            l *= prod;
+
+        return lag;
+    }
+
+    template<typename Group>
+    std::vector<typename Group::Num> barycentricWeights(span<const typename Group::Num> x)
+    {
+        using Num = typename Group::Num;
+        typename Group::Context ctx;
+
+        auto m = x.size();
+        std::vector<Num> w(m);
+        for (u64 i = 0; i < m; ++i)
+        {
+            w[i] = 1;
+            for (u64 j = 0; j < m; ++j)
+                if (j != i) w[i] *= x[i] - x[j];
+        }
+
+        batchInvert<Group>(w);
+        return w;
+    }
+
+    template<typename Group>
+    typename Group::Num hornerEval(span<const typename Group::Num> coeffs, const typename Group::Num& x)
+    {
+        using Num = typename Group::Num;
+        typename Group::Context ctx;
+
+        Num ret(0);
+        for (u64 j = coeffs.size(); j-- > 0;)
+            ret = ret * x + coeffs[j];
+
+        return ret;
+    }
+
+    template void batchInvert<RelicGroup>(span<RelicGroup::Num>);
+    template std::vector<RelicGroup::Num> lagrangeAtZero<RelicGroup>(span<const RelicGroup::Num>);
+    template std::vector<RelicGroup::Num> barycentricWeights<RelicGroup>(span<const RelicGroup::Num>);
+    template RelicGroup::Num hornerEval<RelicGroup>(span<const RelicGroup::Num>, const RelicGroup::Num&);
+
+    template void batchInvert<Rist255Group>(span<Rist255Group::Num>);
+    template std::vector<Rist255Group::Num> lagrangeAtZero<Rist255Group>(span<const Rist255Group::Num>);
+    template std::vector<Rist255Group::Num> barycentricWeights<Rist255Group>(span<const Rist255Group::Num>);
+    template Rist255Group::Num hornerEval<Rist255Group>(span<const Rist255Group::Num>, const Rist255Group::Num&);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include "Group.h"
+
+namespace dEnc
+{
+    /**
+     * Replaces each value by its inverse modulo the group order using Montgomery's
+     * trick, i.e. one inversion and 3(n-1) multiplications instead of n inversions.
+     * Throws if any of the values is zero.
+     * @param[in,out] vals  - The values to invert.
+     */
+    template<typename Group = RelicGroup>
+    void batchInvert(span<typename Group::Num> vals);
+
+    /**
+     * Returns the coefficients l_i such that f(0) = SUM_i l_i * f(x[i]) for every
+     * polynomial f of degree less than x.size(). Takes one inversion.
+     * @param[in] x  - The distinct, non-zero interpolation points.
+     */
+    template<typename Group = RelicGroup>
+    std::vector<typename Group::Num> lagrangeAtZero(span<const typename Group::Num> x);
+
+    /**
+     * Returns the coefficients w_i = 1 / PROD_{j != i} (x[i] - x[j]) of the barycentric 
+     * form of the polynomial through the points x. Takes one inversion.
+     * @param[in] x  - The distinct interpolation points.
+     */
+    template<typename Group = RelicGroup>
+    std::vector<typename Group::Num> barycentricWeights(span<const typename Group::Num> x);
+
+    /**
+     * Returns SUM_j coeffs[j] * x^j with Horner's method.
+     * @param[in] coeffs  - The coefficients of the polynomial, lowest degree first.
+     * @param[in] x       - The point to evaluate the polynomial at.
+     */
+    template<typename Group = RelicGroup>
+    typename Group::Num hornerEval(span<const typename Group::Num> coeffs, const typename Group::Num& x);
+}
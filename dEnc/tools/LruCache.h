@@ -0,0 +1,107 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace dEnc
+{
+    // A thread safe cache which holds up to capacity() values and evicts the
+    // least recently used one when it is full. Values are returned by copy,
+    // so Value is typically a std::shared_ptr to the cached object.
+    template<typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache
+    {
+    public:
+        LruCache(u64 capacity = 64)
+            : mCapacity(capacity)
+        {}
+
+        /**
+         * Returns the value cached under key. If there is none, then make() is
+         * called without holding the lock and its result is inserted.
+         * @param[in] key   - The key of the value.
+         * @param[in] make  - A function returning the value if it is not cached.
+         */
+        template<typename Make>
+        Value getOrInsert(const Key& key, Make&& make)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                auto iter = mMap.find(key);
+                if (iter != mMap.end())
+                {
+                    // move the entry to the front of the recently used list.
+                    mList.splice(mList.begin(), mList, iter->second);
+                    return iter->second->second;
+                }
+            }
+
+            Value value = make();
+
+            std::lock_guard<std::mutex> lock(mMtx);
+
+            // another thread might have inserted the key in the meantime.
+            auto iter = mMap.find(key);
+            if (iter != mMap.end())
+            {
+                mList.splice(mList.begin(), mList, iter->second);
+                return iter->second->second;
+            }
+
+            if (mCapacity)
+            {
+                if (mList.size() == mCapacity)
+                {
+                    mMap.erase(mList.back().first);
+                    mList.pop_back();
+                }
+
+                mList.emplace_front(key, value);
+                mMap.emplace(key, mList.begin());
+            }
+
+            return value;
+        }
+
+        // Sets the maximum number of cached values and evicts any excess ones.
+        void setCapacity(u64 capacity)
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            mCapacity = capacity;
+            while (mList.size() > mCapacity)
+            {
+                mMap.erase(mList.back().first);
+                mList.pop_back();
+            }
+        }
+
+        u64 capacity() const
+        {
+            return mCapacity;
+        }
+
+        u64 size() const
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            return mList.size();
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            mMap.clear();
+            mList.clear();
+        }
+
+    private:
+        mutable std::mutex mMtx;
+        u64 mCapacity;
+
+        // The entries, most recently used first.
+        std::list<std::pair<Key, Value>> mList;
+
+        // Maps each key to its entry in mList.
+        std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> mMap;
+    };
+}
@@ -0,0 +1,197 @@
+#include "Msm.h"
+#include <algorithm>
+
+namespace dEnc
+{
+    namespace
+    {
+        // The window size in bits of Straus' method. Each point has a
+        // table of 2^StrausWindow - 1 multiples.
+        const u64 StrausWindow = 4;
+
+        // Returns bits [pos, pos + w) of k.
+        u64 window(const bn_t k, u64 pos, u64 w)
+        {
+            u64 d = 0;
+            for (u64 j = 0; j < w; ++j)
+                d |= u64(bn_get_bit(k, int(pos + j))) << j;
+            return d;
+        }
+
+        u64 maxBits(span<const oc::REccNumber> scalars)
+        {
+            u64 bits = 0;
+            for (auto& s : scalars)
+                bits = std::max<u64>(bits, bn_bits(s.mVal));
+            return bits;
+        }
+
+        // Returns the window digits of every scalar, digits[j * numWindows + w]
+        // being window w of scalars[j].
+        std::vector<u8> windows(span<const oc::REccNumber> scalars, u64 numWindows, u64 w)
+        {
+            std::vector<u8> digits(scalars.size() * numWindows);
+            for (u64 j = 0; j < scalars.size(); ++j)
+                for (u64 i = 0; i < numWindows; ++i)
+                    digits[j * numWindows + i] = u8(window(scalars[j].mVal, i * w, w));
+            return digits;
+        }
+
+        // Straus' interleaved window method. The doublings are shared by
+        // every point and each point adds one precomputed multiple per window.
+        // acc is left in projective coordinates if norm is false.
+        void straus(const oc::REccPoint* points, const std::vector<u8>& digits, u64 numPoints, u64 numWindows, oc::REccPoint& acc, bool norm = true)
+        {
+            const u64 T = (1ull << StrausWindow) - 1;
+
+            // table[i * T + d - 1] = d * points[i] for d in {1, ..., 2^StrausWindow - 1}.
+            std::vector<oc::REccPoint> table(numPoints * T);
+            for (u64 i = 0; i < numPoints; ++i)
+            {
+                auto t = table.data() + i * T;
+                ep_copy(t[0].mVal, points[i].mVal);
+                ep_dbl(t[1].mVal, points[i].mVal);
+                for (u64 d = 2; d < T; ++d)
+                    ep_add(t[d].mVal, t[d - 1].mVal, points[i].mVal);
+            }
+
+            ep_set_infty(acc.mVal);
+            for (u64 w = numWindows; w-- > 0;)
+            {
+                for (u64 j = 0; j < StrausWindow && w + 1 != numWindows; ++j)
+                    ep_dbl(acc.mVal, acc.mVal);
+
+                for (u64 i = 0; i < numPoints; ++i)
+                {
+                    auto d = digits[i * numWindows + w];
+                    if (d)
+                        ep_add(acc.mVal, acc.mVal, table[i * T + d - 1].mVal);
+                }
+            }
+
+            if (norm)
+                ep_norm(acc.mVal, acc.mVal);
+        }
+
+        // Pippenger's bucket method. In each window the points are added to
+        // the bucket of their digit, and the buckets are then summed with
+        // weights 1, 2, ..., 2^w - 1 using a running sum. This needs about
+        // n + 2^(w+1) additions per window instead of a table per point.
+        oc::REccPoint pippenger(span<const oc::REccPoint> points, span<const oc::REccNumber> scalars)
+        {
+            auto n = points.size();
+
+            // about log2(n) - 2 bits per window balances the bucket and point additions.
+            u64 w = 2;
+            while ((4ull << w) < n && w < 8)
+                ++w;
+
+            auto numWindows = (maxBits(scalars) + w - 1) / w;
+            auto digits = windows(scalars, numWindows, w);
+
+            std::vector<oc::REccPoint> buckets((1ull << w) - 1);
+            std::vector<u8> used(buckets.size());
+            oc::REccPoint acc, running, sum;
+            ep_set_infty(acc.mVal);
+
+            for (u64 i = numWindows; i-- > 0;)
+            {
+                for (u64 j = 0; j < w && i + 1 != numWindows; ++j)
+                    ep_dbl(acc.mVal, acc.mVal);
+
+                std::fill(used.begin(), used.end(), 0);
+                for (u64 j = 0; j < n; ++j)
+                {
+                    auto d = digits[j * numWindows + i];
+                    if (d == 0)
+                        continue;
+
+                    auto& b = buckets[d - 1];
+                    if (used[d - 1])
+                        ep_add(b.mVal, b.mVal, points[j].mVal);
+                    else
+                        ep_copy(b.mVal, points[j].mVal);
+                    used[d - 1] = 1;
+                }
+
+                // sum = SUM_d d * bucket[d], computed as the sum of the
+                // running sums bucket[top] + ... + bucket[d] for each d.
+                ep_set_infty(running.mVal);
+                ep_set_infty(sum.mVal);
+                for (u64 d = buckets.size(); d-- > 0;)
+                {
+                    if (used[d])
+                        ep_add(running.mVal, running.mVal, buckets[d].mVal);
+                    ep_add(sum.mVal, sum.mVal, running.mVal);
+                }
+
+                ep_add(acc.mVal, acc.mVal, sum.mVal);
+            }
+
+            ep_norm(acc.mVal, acc.mVal);
+            return acc;
+        }
+    }
+
+    oc::REccPoint multiScalarMul(span<const oc::REccPoint> points, span<const oc::REccNumber> scalars)
+    {
+        if (points.size() != scalars.size())
+            throw std::runtime_error("the number of points and scalars must match. " LOCATION);
+
+        oc::REllipticCurve curve;
+        if (points.size() >= PippengerThreshold)
+            return pippenger(points, scalars);
+
+        auto numWindows = (maxBits(scalars) + StrausWindow - 1) / StrausWindow;
+        auto digits = windows(scalars, numWindows, StrausWindow);
+
+        oc::REccPoint acc;
+        straus(points.data(), digits, points.size(), numWindows, acc);
+        return acc;
+    }
+
+    void multiScalarMul(span<const oc::REccPoint> points, span<const oc::REccNumber> scalars, span<oc::REccPoint> out)
+    {
+        if (points.size() != scalars.size() * out.size())
+            throw std::runtime_error("the number of points must be the number of scalars times the number of outputs. " LOCATION);
+
+        oc::REllipticCurve curve;
+
+        // The scalars are shared by every row and so their digits are computed once.
+        auto numWindows = (maxBits(scalars) + StrausWindow - 1) / StrausWindow;
+        auto digits = windows(scalars, numWindows, StrausWindow);
+
+        for (u64 i = 0; i < out.size(); ++i)
+            straus(points.data() + i * scalars.size(), digits, scalars.size(), numWindows, out[i], false);
+    }
+
+    void normalize(span<oc::REccPoint> points)
+    {
+        // ep_norm_sim takes an array of ep_t.
+        static_assert(sizeof(oc::REccPoint) == sizeof(ep_t), "REccPoint must only hold an ep_t.");
+
+        // The identity has no affine coordinates and would zero the shared inversion.
+        std::vector<u64> idx; idx.reserve(points.size());
+        for (u64 i = 0; i < u64(points.size()); ++i)
+            if (ep_is_infty(points[i].mVal) == 0)
+                idx.push_back(i);
+
+        if (idx.size() == u64(points.size()))
+        {
+            auto t = reinterpret_cast<ep_t*>(points.data());
+            ep_norm_sim(t, t, int(points.size()));
+        }
+        else if (idx.size())
+        {
+            std::vector<oc::REccPoint> tmp(idx.size());
+            for (u64 i = 0; i < idx.size(); ++i)
+                tmp[i] = points[idx[i]];
+
+            auto t = reinterpret_cast<ep_t*>(tmp.data());
+            ep_norm_sim(t, t, int(tmp.size()));
+
+            for (u64 i = 0; i < idx.size(); ++i)
+                points[idx[i]] = tmp[i];
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include <cryptoTools/Crypto/RCurve.h>
+
+namespace dEnc
+{
+    // The number of points from which multiScalarMul uses Pippenger's bucket
+    // method instead of Straus' interleaved window method.
+    const u64 PippengerThreshold = 64;
+
+    /**
+     * Computes the multi-scalar multiplication SUM_i scalars[i] * points[i]. The
+     * doublings are shared by every point, which makes this considerably cheaper
+     * than points.size() separate scalar multiplications. Straus' method is used
+     * for few points and Pippenger's method for many. The scalars must be reduced
+     * modulo the group order. The running time and memory accesses depend on the
+     * scalars, which must therefore not be secret.
+     * @param[in] points   - The points.
+     * @param[in] scalars  - The scalars, one per point.
+     */
+    oc::REccPoint multiScalarMul(span<const oc::REccPoint> points, span<const oc::REccNumber> scalars);
+
+    /**
+     * Computes several multi-scalar multiplications with the same scalars, i.e.
+     *   out[i] = SUM_j scalars[j] * points[i * scalars.size() + j].
+     * The scalars are only decomposed once. The outputs are left in projective
+     * coordinates so that the caller can add to them before normalizing them all
+     * with one normalize(out). This is how shares are interpolated in the exponent
+     * for every input of a batch.
+     * @param[in] points   - The points, scalars.size() per output in row-major order.
+     * @param[in] scalars  - The scalars, shared by every output.
+     * @param[out] out     - The results.
+     */
+    void multiScalarMul(span<const oc::REccPoint> points, span<const oc::REccNumber> scalars, span<oc::REccPoint> out);
+
+    /**
+     * Converts the points to affine coordinates with one shared field inversion,
+     * i.e. Montgomery's trick, instead of one inversion per point. Serializing
+     * or adding a normalized point then takes no inversion. 
+     * @param[in,out] points  - The points to normalize.
+     */
+    void normalize(span<oc::REccPoint> points);
+}
@@ -0,0 +1,103 @@
+#include "MultiKeyAES.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace dEnc
+{
+    namespace
+    {
+        // Executes the cpuid instruction for the given leaf and sub-leaf,
+        // regs = {eax, ebx, ecx, edx}.
+        void cpuid(u32 leaf, u32 subLeaf, u32 regs[4])
+        {
+#ifdef _MSC_VER
+            int r[4];
+            __cpuidex(r, leaf, subLeaf);
+            for (u64 i = 0; i < 4; ++i)
+                regs[i] = r[i];
+#else
+            if (!__get_cpuid_count(leaf, subLeaf, &regs[0], &regs[1], &regs[2], &regs[3]))
+                regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+        }
+
+        // Returns the register state that the OS saves on a context switch (XCR0).
+        u64 xgetbv0()
+        {
+#ifdef _MSC_VER
+            return _xgetbv(0);
+#else
+            u32 eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (u64(edx) << 32) | eax;
+#endif
+        }
+
+        MultiKeyAES::Backend detectBackend()
+        {
+#ifdef DENC_ENABLE_VAES
+            u32 leaf0[4], leaf1[4], leaf7[4];
+            cpuid(0, 0, leaf0);
+            if (leaf0[0] < 7)
+                return MultiKeyAES::Backend::SSE;
+
+            cpuid(1, 0, leaf1);
+            cpuid(7, 0, leaf7);
+
+            bool osxsave = (leaf1[2] >> 27) & 1;
+            bool avx = (leaf1[2] >> 28) & 1;
+            if (!osxsave || !avx)
+                return MultiKeyAES::Backend::SSE;
+
+            // The OS must save the YMM (and for AVX-512, the opmask and ZMM) state.
+            auto xcr0 = xgetbv0();
+            bool ymmState = (xcr0 & 0x06) == 0x06;
+            bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+            bool avx2 = (leaf7[1] >> 5) & 1;
+            bool avx512f = (leaf7[1] >> 16) & 1;
+            bool vaes = (leaf7[2] >> 9) & 1;
+
+            if (vaes && avx512f && zmmState)
+                return MultiKeyAES::Backend::VAES512;
+            if (vaes && avx2 && ymmState)
+                return MultiKeyAES::Backend::VAES256;
+#endif
+            return MultiKeyAES::Backend::SSE;
+        }
+    }
+
+    MultiKeyAES::Backend MultiKeyAES::bestBackend()
+    {
+        static const Backend best = detectBackend();
+        return best;
+    }
+
+    bool MultiKeyAES::isSupported(Backend backend)
+    {
+        return static_cast<int>(backend) <= static_cast<int>(bestBackend());
+    }
+
+    void MultiKeyAES::ecbEncBlocksSumWide(const block* roundKeys, u64 numKeys, const block* plaintexts, u64 blockLength, block* sums) const
+    {
+        static_assert(vaes::GroupSize == RoundKeyStore::GroupSize &&
+            vaes::Rounds == RoundKeyStore::Rounds, "the key layouts must agree");
+
+        vaes::KeyView keys;
+        keys.roundKeys = roundKeys;
+        keys.numKeys = numKeys;
+
+#ifdef DENC_ENABLE_VAES
+        if (mBackend == Backend::VAES512)
+            vaes::ecbEncBlocksSum512(keys, plaintexts, blockLength, sums);
+        else
+            vaes::ecbEncBlocksSum256(keys, plaintexts, blockLength, sums);
+#else
+        throw std::runtime_error("dEnc was built without VAES support. " LOCATION);
+#endif
+    }
+}
@@ -2,6 +2,8 @@
 #include <vector>
 #include <cryptoTools/Crypto/AES.h>
 #include "dEnc/Defines.h"
+#include "dEnc/tools/MultiKeyAESVaes.h"
+#include "dEnc/tools/RoundKeyStore.h"
 
 namespace dEnc
 {
@@ -10,91 +12,279 @@ namespace dEnc
 	class MultiKeyAES
 	{
 	public:
-		std::vector<oc::AES> mAESs;
+		// The instruction sets that the XOR-sum kernels can be evaluated with.
+		enum class Backend
+		{
+			// 128 bit AES-NI, one block per instruction.
+			SSE,
+			// 256 bit VAES, two blocks per instruction. Requires AVX2.
+			VAES256,
+			// 512 bit VAES, four blocks per instruction. Requires AVX-512F.
+			VAES512
+		};
+
+		// The round keys of every key in a round-major layout. Used by all kernels.
+		RoundKeyStore mKeys;
+
+		// The instruction set used by ecbEncBlockSum and ecbEncBlocksSum.
+		Backend mBackend = bestBackend();
 
 		MultiKeyAES() {};
-		MultiKeyAES(span<block> keys)
+		MultiKeyAES(span<block> keys, RoundKeyStore::Pages pages = RoundKeyStore::Pages::Default)
 		{
-			setKeys(keys);
+			setKeys(keys, pages);
 		}
 
-		void setKeys(span<block> keys)
+		/**
+		 * Expands the keys into the round-major key store.
+		 * @param[in] keys   - The AES keys.
+		 * @param[in] pages  - Whether the round keys should be placed on huge pages.
+		 */
+		void setKeys(span<block> keys, RoundKeyStore::Pages pages = RoundKeyStore::Pages::Default)
 		{
-			mAESs.resize(keys.size());
-			for (u64 i = 0; i < mAESs.size(); ++i)
-			{
-				mAESs[i].setKey(keys[i]);
-			}
+			mKeys.setKeys(keys, pages);
 		}
 
-		void ecbEncBlock(const block& plaintext, block* cyphertexts) const
+		// The number of keys.
+		u64 size() const { return mKeys.size(); }
+
+		/**
+		 * Returns the widest backend that this CPU supports. The CPU is 
+		 * queried once, the first time this is called.
+		 */
+		static Backend bestBackend();
+
+		/**
+		 * Returns true if this binary was built with and the CPU supports the backend.
+		 * @param[in] backend  - The backend in question.
+		 */
+		static bool isSupported(Backend backend);
+
+		/**
+		 * Selects the instruction set used by ecbEncBlockSum and ecbEncBlocksSum.
+		 * Throws if the backend is not supported.
+		 * @param[in] backend  - The backend that should be used.
+		 */
+		void setBackend(Backend backend)
 		{
+			if (isSupported(backend) == false)
+				throw std::runtime_error("MultiKeyAES backend is not supported on this CPU. " LOCATION);
+			mBackend = backend;
+		}
 
-			auto mainLoop = mAESs.size() / 8;
-			auto finalLoop = mAESs.size() % 8;
+		void ecbEncBlock(const block& plaintext, block* cyphertexts) const
+		{
+			const u64 G = RoundKeyStore::GroupSize;
+			auto mainLoop = mKeys.size() / 8;
+			auto finalLoop = mKeys.size() % 8;
 
 			auto dest = cyphertexts;
-			auto key = mAESs.data();
-			for (int i = 0; i < mainLoop; ++i)
+			for (u64 i = 0; i < mainLoop; ++i)
 			{
-				dest[0] = _mm_xor_si128(plaintext, key[0].mRoundKey[0]);
-				dest[1] = _mm_xor_si128(plaintext, key[1].mRoundKey[0]);
-				dest[2] = _mm_xor_si128(plaintext, key[2].mRoundKey[0]);
-				dest[3] = _mm_xor_si128(plaintext, key[3].mRoundKey[0]);
-				dest[4] = _mm_xor_si128(plaintext, key[4].mRoundKey[0]);
-				dest[5] = _mm_xor_si128(plaintext, key[5].mRoundKey[0]);
-				dest[6] = _mm_xor_si128(plaintext, key[6].mRoundKey[0]);
-				dest[7] = _mm_xor_si128(plaintext, key[7].mRoundKey[0]);
+				// round j of these eight keys is at key[j * G], ..., key[j * G + 7].
+				auto key = mKeys.keyPtr(i * 8);
+
+				dest[0] = _mm_xor_si128(plaintext, key[0]);
+				dest[1] = _mm_xor_si128(plaintext, key[1]);
+				dest[2] = _mm_xor_si128(plaintext, key[2]);
+				dest[3] = _mm_xor_si128(plaintext, key[3]);
+				dest[4] = _mm_xor_si128(plaintext, key[4]);
+				dest[5] = _mm_xor_si128(plaintext, key[5]);
+				dest[6] = _mm_xor_si128(plaintext, key[6]);
+				dest[7] = _mm_xor_si128(plaintext, key[7]);
 
 				for (u64 j = 1; j < 10; ++j)
 				{
-					dest[0] = _mm_aesenc_si128(dest[0], key[0].mRoundKey[j]);
-					dest[1] = _mm_aesenc_si128(dest[1], key[1].mRoundKey[j]);
-					dest[2] = _mm_aesenc_si128(dest[2], key[2].mRoundKey[j]);
-					dest[3] = _mm_aesenc_si128(dest[3], key[3].mRoundKey[j]);
-					dest[4] = _mm_aesenc_si128(dest[4], key[4].mRoundKey[j]);
-					dest[5] = _mm_aesenc_si128(dest[5], key[5].mRoundKey[j]);
-					dest[6] = _mm_aesenc_si128(dest[6], key[6].mRoundKey[j]);
-					dest[7] = _mm_aesenc_si128(dest[7], key[7].mRoundKey[j]);
+					key += G;
+					dest[0] = _mm_aesenc_si128(dest[0], key[0]);
+					dest[1] = _mm_aesenc_si128(dest[1], key[1]);
+					dest[2] = _mm_aesenc_si128(dest[2], key[2]);
+					dest[3] = _mm_aesenc_si128(dest[3], key[3]);
+					dest[4] = _mm_aesenc_si128(dest[4], key[4]);
+					dest[5] = _mm_aesenc_si128(dest[5], key[5]);
+					dest[6] = _mm_aesenc_si128(dest[6], key[6]);
+					dest[7] = _mm_aesenc_si128(dest[7], key[7]);
 				}
-				dest[0] = _mm_aesenclast_si128(dest[0], key[0].mRoundKey[10]);
-				dest[1] = _mm_aesenclast_si128(dest[1], key[1].mRoundKey[10]);
-				dest[2] = _mm_aesenclast_si128(dest[2], key[2].mRoundKey[10]);
-				dest[3] = _mm_aesenclast_si128(dest[3], key[3].mRoundKey[10]);
-				dest[4] = _mm_aesenclast_si128(dest[4], key[4].mRoundKey[10]);
-				dest[5] = _mm_aesenclast_si128(dest[5], key[5].mRoundKey[10]);
-				dest[6] = _mm_aesenclast_si128(dest[6], key[6].mRoundKey[10]);
-				dest[7] = _mm_aesenclast_si128(dest[7], key[7].mRoundKey[10]);
+				key += G;
+				dest[0] = _mm_aesenclast_si128(dest[0], key[0]);
+				dest[1] = _mm_aesenclast_si128(dest[1], key[1]);
+				dest[2] = _mm_aesenclast_si128(dest[2], key[2]);
+				dest[3] = _mm_aesenclast_si128(dest[3], key[3]);
+				dest[4] = _mm_aesenclast_si128(dest[4], key[4]);
+				dest[5] = _mm_aesenclast_si128(dest[5], key[5]);
+				dest[6] = _mm_aesenclast_si128(dest[6], key[6]);
+				dest[7] = _mm_aesenclast_si128(dest[7], key[7]);
 
 				dest += 8;
-				key += 8;
 			}
 
-			for (int i = 0; i < finalLoop; ++i)
+			for (u64 i = 0; i < finalLoop; ++i)
 			{
-				dest[0] = _mm_xor_si128(plaintext, key[0].mRoundKey[0]);
+				auto key = mKeys.keyPtr(mainLoop * 8 + i);
+				dest[0] = _mm_xor_si128(plaintext, key[0]);
 
 				for (u64 j = 1; j < 10; ++j)
 				{
-					dest[0] = _mm_aesenc_si128(dest[0], key[0].mRoundKey[j]);
+					dest[0] = _mm_aesenc_si128(dest[0], key[j * G]);
 				}
-				dest[0] = _mm_aesenclast_si128(dest[0], key[0].mRoundKey[10]);
+				dest[0] = _mm_aesenclast_si128(dest[0], key[10 * G]);
 
 				++dest;
-				++key;
 			}
 		}
 
 
-		const MultiKeyAES& operator=(const MultiKeyAES& rhs)
+		/**
+		 * Computes the XOR of the encryptions of plaintext under every key, i.e.
+		 *   return = AES_0(plaintext) ^ AES_1(plaintext) ^ ... ^ AES_{k-1}(plaintext).
+		 * Eight keys are processed in parallel and the results are accumulated
+		 * directly in registers, so no temporary buffer is required.
+		 * @param[in] plaintext  - The block that should be encrypted under every key.
+		 */
+		block ecbEncBlockSum(const block& plaintext) const
+		{
+			block ret;
+			if (mBackend != Backend::SSE)
+				ecbEncBlocksSumWide(mKeys.data(), mKeys.size(), &plaintext, 1, &ret);
+			else
+				ecbEncSumTile<1>(mKeys.data(), mKeys.size(), &plaintext, &ret);
+			return ret;
+		}
+
+		/**
+		 * Computes the XOR of the encryptions of each plaintext under every key, i.e.
+		 *   sums[i] = AES_0(plaintexts[i]) ^ AES_1(plaintexts[i]) ^ ... ^ AES_{k-1}(plaintexts[i]).
+		 * The plaintexts are processed eight at a time with one key applied to all
+		 * eight. The final 1 to 7 plaintexts are processed with several keys at once
+		 * so that eight independent AES pipelines are still in flight.
+		 * @param[in] plaintexts  - The blocks that should be encrypted.
+		 * @param[in] blockLength - The number of blocks in plaintexts and sums.
+		 * @param[out] sums       - The location that the XOR of the encryptions is written to.
+		 */
+		void ecbEncBlocksSum(const block* plaintexts, u64 blockLength, block* sums) const
+		{
+			ecbEncBlocksSum(plaintexts, blockLength, sums, 0, mKeys.size());
+		}
+
+		/**
+		 * Same as ecbEncBlocksSum(plaintexts, blockLength, sums) but only the keys
+		 * in [keyBegin, keyEnd) are summed over. This allows a large key set to be
+		 * split between threads whose partial sums are then XORed together.
+		 * @param[in] plaintexts  - The blocks that should be encrypted.
+		 * @param[in] blockLength - The number of blocks in plaintexts and sums.
+		 * @param[out] sums       - The location that the XOR of the encryptions is written to.
+		 * @param[in] keyBegin    - The first key, a multiple of RoundKeyStore::GroupSize.
+		 * @param[in] keyEnd      - One past the last key.
+		 */
+		void ecbEncBlocksSum(const block* plaintexts, u64 blockLength, block* sums, u64 keyBegin, u64 keyEnd) const
+		{
+			if (keyBegin % RoundKeyStore::GroupSize || keyBegin > keyEnd || keyEnd > mKeys.size())
+				throw std::runtime_error("invalid key range. " LOCATION);
+
+			// keyBegin starts a group, so the range has the same layout as a key store of its own.
+			auto keys = mKeys.keyPtr(keyBegin);
+			auto numKeys = keyEnd - keyBegin;
+
+			if (mBackend != Backend::SSE)
+			{
+				ecbEncBlocksSumWide(keys, numKeys, plaintexts, blockLength, sums);
+				return;
+			}
+
+			auto mainLoop = blockLength / 8;
+			auto finalLoop = blockLength % 8;
+
+			for (u64 i = 0; i < mainLoop; ++i)
+			{
+				ecbEncSumTile<8>(keys, numKeys, plaintexts, sums);
+				plaintexts += 8;
+				sums += 8;
+			}
+
+			switch (finalLoop)
+			{
+			case 1: ecbEncSumTile<1>(keys, numKeys, plaintexts, sums); break;
+			case 2: ecbEncSumTile<2>(keys, numKeys, plaintexts, sums); break;
+			case 3: ecbEncSumTile<3>(keys, numKeys, plaintexts, sums); break;
+			case 4: ecbEncSumTile<4>(keys, numKeys, plaintexts, sums); break;
+			case 5: ecbEncSumTile<5>(keys, numKeys, plaintexts, sums); break;
+			case 6: ecbEncSumTile<6>(keys, numKeys, plaintexts, sums); break;
+			case 7: ecbEncSumTile<7>(keys, numKeys, plaintexts, sums); break;
+			default: break;
+			}
+		}
+
+	private:
+
+		/**
+		 * Dispatches to the VAES kernel selected by mBackend. The numKeys keys
+		 * start at the round-major layout pointed to by keys.
+		 */
+		void ecbEncBlocksSumWide(const block* keys, u64 numKeys, const block* plaintexts, u64 blockLength, block* sums) const;
+
+		/**
+		 * Computes sums[i] = XOR_k AES_k(plaintexts[i]) for i in {0, ..., N-1}. The
+		 * keys are consumed 8/N at a time so that (8/N)*N independent AES pipelines
+		 * are interleaved. The sums are accumulated in registers. keys points to
+		 * the round-major layout of numKeys keys.
+		 */
+		template<u64 N>
+		void ecbEncSumTile(const block* keys, u64 numKeys, const block* plaintexts, block* sums) const
 		{
-			for (u64 i = 0; i < mAESs.size(); ++i)
+			static_assert(N > 0 && N <= 8, "at most 8 pipelines are interleaved");
+			static_assert(RoundKeyStore::GroupSize % (8 / N) == 0, "a step must not cross a key group");
+
+			// the number of keys processed at once.
+			constexpr u64 K = 8 / N;
+
+			block acc[N], in[N], c[K][N];
+			for (u64 i = 0; i < N; ++i)
+			{
+				acc[i] = oc::ZeroBlock;
+				in[i] = plaintexts[i];
+			}
+
+			const u64 G = RoundKeyStore::GroupSize;
+			auto mainLoop = numKeys / K;
+			auto finalLoop = numKeys % K;
+
+			for (u64 l = 0; l < mainLoop; ++l)
 			{
-				for(u64 j =0; j < sizeof(mAESs[i].mRoundKey) / sizeof(block); ++j)
-					mAESs[i].mRoundKey[j] = rhs.mAESs[i].mRoundKey[j];
+				// K divides the group size, so these K keys are in the same
+				// group and round j of key k is at key[j * G + k].
+				auto key = RoundKeyStore::keyPtr(keys, l * K);
+
+				for (u64 k = 0; k < K; ++k)
+					for (u64 i = 0; i < N; ++i)
+						c[k][i] = _mm_xor_si128(in[i], key[k]);
+
+				for (u64 j = 1; j < 10; ++j)
+					for (u64 k = 0; k < K; ++k)
+						for (u64 i = 0; i < N; ++i)
+							c[k][i] = _mm_aesenc_si128(c[k][i], key[j * G + k]);
+
+				for (u64 k = 0; k < K; ++k)
+					for (u64 i = 0; i < N; ++i)
+						acc[i] = _mm_xor_si128(acc[i], _mm_aesenclast_si128(c[k][i], key[10 * G + k]));
+			}
+
+			for (u64 l = 0; l < finalLoop; ++l)
+			{
+				auto key = RoundKeyStore::keyPtr(keys, mainLoop * K + l);
+
+				for (u64 i = 0; i < N; ++i)
+					c[0][i] = _mm_xor_si128(in[i], key[0]);
+
+				for (u64 j = 1; j < 10; ++j)
+					for (u64 i = 0; i < N; ++i)
+						c[0][i] = _mm_aesenc_si128(c[0][i], key[j * G]);
+
+				for (u64 i = 0; i < N; ++i)
+					acc[i] = _mm_xor_si128(acc[i], _mm_aesenclast_si128(c[0][i], key[10 * G]));
 			}
 
-			return rhs;
+			for (u64 i = 0; i < N; ++i)
+				sums[i] = acc[i];
 		}
 	};
 
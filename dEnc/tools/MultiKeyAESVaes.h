@@ -0,0 +1,37 @@
+#pragma once
+
+// Internal header for MultiKeyAES. Declares the VAES kernels, which are defined in
+// MultiKeyAESVaes256.cpp and MultiKeyAESVaes512.cpp. These are compiled with the
+// corresponding instruction set enabled and share their implementation through
+// MultiKeyAESVaesKernels.h.
+#include <immintrin.h>
+#include <cstdint>
+
+namespace dEnc
+{
+    namespace vaes
+    {
+        // The number of keys whose round keys are interleaved, see RoundKeyStore.
+        const std::uint64_t GroupSize = 8;
+
+        // The number of round keys in an AES-128 key schedule.
+        const std::uint64_t Rounds = 11;
+
+        // A view of the RoundKeyStore held by a MultiKeyAES.
+        struct KeyView
+        {
+            // The round keys interleaved in groups of GroupSize keys, i.e. round j
+            // of key g * GroupSize + l is at roundKeys[(g * Rounds + j) * GroupSize + l].
+            const __m128i* roundKeys;
+
+            // The number of keys.
+            std::uint64_t numKeys;
+        };
+
+        // out[i] = XOR_k AES_k(in[i]) using 256 bit VAES instructions. Requires AVX2 and VAES.
+        void ecbEncBlocksSum256(const KeyView& keys, const __m128i* in, std::uint64_t n, __m128i* out);
+
+        // out[i] = XOR_k AES_k(in[i]) using 512 bit VAES instructions. Requires AVX-512F and VAES.
+        void ecbEncBlocksSum512(const KeyView& keys, const __m128i* in, std::uint64_t n, __m128i* out);
+    }
+}
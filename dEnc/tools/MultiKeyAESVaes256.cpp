@@ -0,0 +1,47 @@
+// Compiled with AVX2 and VAES enabled, see dEnc/CMakeLists.txt. Only
+// called when MultiKeyAES has detected that the CPU supports them.
+#include "MultiKeyAESVaesKernels.h"
+
+#ifdef DENC_ENABLE_VAES
+namespace dEnc
+{
+    namespace vaes
+    {
+        namespace
+        {
+            // two AES blocks per register.
+            struct W256
+            {
+                using V = __m256i;
+                static const std::uint64_t Lanes = 2;
+
+                static V zero() { return _mm256_setzero_si256(); }
+                static V load(const __m128i* p) { return _mm256_loadu_si256((const __m256i*)p); }
+                static void store(__m128i* p, V v) { _mm256_storeu_si256((__m256i*)p, v); }
+                static V broadcast(const __m128i* p) { return _mm256_broadcastsi128_si256(_mm_loadu_si128(p)); }
+                static V xor_(V a, V b) { return _mm256_xor_si256(a, b); }
+                static V and_(V a, V b) { return _mm256_and_si256(a, b); }
+                static V enc(V a, V k) { return _mm256_aesenc_epi128(a, k); }
+                static V encLast(V a, V k) { return _mm256_aesenclast_epi128(a, k); }
+
+                // all ones in the first n lanes.
+                static V laneMask(std::uint64_t n)
+                {
+                    return n == 2 ? _mm256_set1_epi64x(-1) : _mm256_set_epi64x(0, 0, -1, -1);
+                }
+
+                // the XOR of the two lanes.
+                static __m128i reduce(V v)
+                {
+                    return _mm_xor_si128(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+                }
+            };
+        }
+
+        void ecbEncBlocksSum256(const KeyView& keys, const __m128i* in, std::uint64_t n, __m128i* out)
+        {
+            ecbEncBlocksSum<W256>(keys, in, n, out);
+        }
+    }
+}
+#endif
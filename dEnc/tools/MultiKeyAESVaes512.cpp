@@ -0,0 +1,49 @@
+// Compiled with AVX-512F and VAES enabled, see dEnc/CMakeLists.txt. Only
+// called when MultiKeyAES has detected that the CPU supports them.
+#include "MultiKeyAESVaesKernels.h"
+
+#ifdef DENC_ENABLE_VAES
+namespace dEnc
+{
+    namespace vaes
+    {
+        namespace
+        {
+            // four AES blocks per register.
+            struct W512
+            {
+                using V = __m512i;
+                static const std::uint64_t Lanes = 4;
+
+                static V zero() { return _mm512_setzero_si512(); }
+                static V load(const __m128i* p) { return _mm512_loadu_si512((const void*)p); }
+                static void store(__m128i* p, V v) { _mm512_storeu_si512((void*)p, v); }
+                static V broadcast(const __m128i* p) { return _mm512_broadcast_i32x4(_mm_loadu_si128(p)); }
+                static V xor_(V a, V b) { return _mm512_xor_si512(a, b); }
+                static V and_(V a, V b) { return _mm512_and_si512(a, b); }
+                static V enc(V a, V k) { return _mm512_aesenc_epi128(a, k); }
+                static V encLast(V a, V k) { return _mm512_aesenclast_epi128(a, k); }
+
+                // all ones in the first n lanes.
+                static V laneMask(std::uint64_t n)
+                {
+                    return _mm512_maskz_mov_epi64((__mmask8)((1 << (2 * n)) - 1), _mm512_set1_epi64(-1));
+                }
+
+                // the XOR of the four lanes.
+                static __m128i reduce(V v)
+                {
+                    auto x = _mm_xor_si128(_mm512_extracti32x4_epi32(v, 0), _mm512_extracti32x4_epi32(v, 1));
+                    auto y = _mm_xor_si128(_mm512_extracti32x4_epi32(v, 2), _mm512_extracti32x4_epi32(v, 3));
+                    return _mm_xor_si128(x, y);
+                }
+            };
+        }
+
+        void ecbEncBlocksSum512(const KeyView& keys, const __m128i* in, std::uint64_t n, __m128i* out)
+        {
+            ecbEncBlocksSum<W512>(keys, in, n, out);
+        }
+    }
+}
+#endif
@@ -0,0 +1,221 @@
+#pragma once
+
+// The VAES kernels of MultiKeyAES, generic over the vector width. Only included by
+// MultiKeyAESVaes256.cpp and MultiKeyAESVaes512.cpp, which are compiled with the
+// corresponding instruction set enabled. Everything is defined in an anonymous
+// namespace so that each of them gets its own copy. Otherwise the linker could
+// pick the copy compiled for the wider instruction set for both, and run it on a
+// CPU that does not support it. The width traits are defined in an anonymous 
+// namespace in each of these translation units for the same reason.
+#include "MultiKeyAESVaes.h"
+
+namespace dEnc
+{
+    namespace vaes
+    {
+        namespace
+        {
+            // Returns a pointer to round 0 of key k. Round j of key k + i is at
+            // keyPtr(keys, k)[j * GroupSize + i] for every key k + i in the group of k.
+            inline const __m128i* keyPtr(const KeyView& keys, std::uint64_t k)
+            {
+                return keys.roundKeys + (k / GroupSize) * Rounds * GroupSize + k % GroupSize;
+            }
+
+            // Returns a pointer to round j of the W::Lanes keys in (W::Lanes wide) group g.
+            template<typename W>
+            inline const __m128i* laneKey(const KeyView& keys, std::uint64_t g, std::uint64_t j)
+            {
+                return keyPtr(keys, g * W::Lanes) + j * GroupSize;
+            }
+
+            // Broadcasts one key to every lane and encrypts R registers of W::Lanes
+            // inputs each, i.e. R * W::Lanes inputs. 8/R keys are consumed at a time
+            // so that eight independent pipelines are in flight.
+            template<typename W, std::uint64_t R>
+            inline void sumTileBroadcastKey(const KeyView& keys, const __m128i* in, __m128i* out)
+            {
+                using V = typename W::V;
+                const std::uint64_t K = 8 / R;
+
+                V acc[R], p[R], c[K][R];
+                for (std::uint64_t r = 0; r < R; ++r)
+                {
+                    acc[r] = W::zero();
+                    p[r] = W::load(in + r * W::Lanes);
+                }
+
+                auto mainLoop = keys.numKeys / K;
+                auto finalLoop = keys.numKeys % K;
+
+                for (std::uint64_t l = 0; l < mainLoop; ++l)
+                {
+                    // K divides GroupSize, so round j of key k is at key[j * GroupSize + k].
+                    auto key = keyPtr(keys, l * K);
+
+                    for (std::uint64_t k = 0; k < K; ++k)
+                    {
+                        auto rk = W::broadcast(key + k);
+                        for (std::uint64_t r = 0; r < R; ++r)
+                            c[k][r] = W::xor_(p[r], rk);
+                    }
+
+                    for (std::uint64_t j = 1; j < Rounds - 1; ++j)
+                    {
+                        for (std::uint64_t k = 0; k < K; ++k)
+                        {
+                            auto rk = W::broadcast(key + j * GroupSize + k);
+                            for (std::uint64_t r = 0; r < R; ++r)
+                                c[k][r] = W::enc(c[k][r], rk);
+                        }
+                    }
+
+                    for (std::uint64_t k = 0; k < K; ++k)
+                    {
+                        auto rk = W::broadcast(key + (Rounds - 1) * GroupSize + k);
+                        for (std::uint64_t r = 0; r < R; ++r)
+                            acc[r] = W::xor_(acc[r], W::encLast(c[k][r], rk));
+                    }
+                }
+
+                for (std::uint64_t l = 0; l < finalLoop; ++l)
+                {
+                    auto key = keyPtr(keys, mainLoop * K + l);
+                    auto rk = W::broadcast(key);
+                    for (std::uint64_t r = 0; r < R; ++r)
+                        c[0][r] = W::xor_(p[r], rk);
+
+                    for (std::uint64_t j = 1; j < Rounds - 1; ++j)
+                    {
+                        rk = W::broadcast(key + j * GroupSize);
+                        for (std::uint64_t r = 0; r < R; ++r)
+                            c[0][r] = W::enc(c[0][r], rk);
+                    }
+
+                    rk = W::broadcast(key + (Rounds - 1) * GroupSize);
+                    for (std::uint64_t r = 0; r < R; ++r)
+                        acc[r] = W::xor_(acc[r], W::encLast(c[0][r], rk));
+                }
+
+                for (std::uint64_t r = 0; r < R; ++r)
+                    W::store(out + r * W::Lanes, acc[r]);
+            }
+
+            // Broadcasts each of the I inputs to every lane and applies W::Lanes
+            // different keys to it at once. 8/I key groups are consumed at a time
+            // so that up to eight independent pipelines are in flight.
+            template<typename W, std::uint64_t I>
+            inline void sumTileBroadcastInput(const KeyView& keys, const __m128i* in, __m128i* out)
+            {
+                using V = typename W::V;
+                const std::uint64_t G = 8 / I;
+
+                V acc[I], p[I], c[G][I];
+                for (std::uint64_t i = 0; i < I; ++i)
+                {
+                    acc[i] = W::zero();
+                    p[i] = W::broadcast(in + i);
+                }
+
+                auto numGroups = keys.numKeys / W::Lanes;
+                auto mainLoop = numGroups / G;
+                auto finalLoop = numGroups % G;
+                std::uint64_t g = 0;
+
+                for (std::uint64_t l = 0; l < mainLoop; ++l, g += G)
+                {
+                    for (std::uint64_t k = 0; k < G; ++k)
+                    {
+                        auto rk = W::load(laneKey<W>(keys, g + k, 0));
+                        for (std::uint64_t i = 0; i < I; ++i)
+                            c[k][i] = W::xor_(p[i], rk);
+                    }
+
+                    for (std::uint64_t j = 1; j < Rounds - 1; ++j)
+                    {
+                        for (std::uint64_t k = 0; k < G; ++k)
+                        {
+                            auto rk = W::load(laneKey<W>(keys, g + k, j));
+                            for (std::uint64_t i = 0; i < I; ++i)
+                                c[k][i] = W::enc(c[k][i], rk);
+                        }
+                    }
+
+                    for (std::uint64_t k = 0; k < G; ++k)
+                    {
+                        auto rk = W::load(laneKey<W>(keys, g + k, Rounds - 1));
+                        for (std::uint64_t i = 0; i < I; ++i)
+                            acc[i] = W::xor_(acc[i], W::encLast(c[k][i], rk));
+                    }
+                }
+
+                // the remaining full groups followed by the partial group, if any.
+                auto partial = keys.numKeys % W::Lanes;
+                for (std::uint64_t l = 0; l < finalLoop + (partial != 0); ++l, ++g)
+                {
+                    auto rk = W::load(laneKey<W>(keys, g, 0));
+                    for (std::uint64_t i = 0; i < I; ++i)
+                        c[0][i] = W::xor_(p[i], rk);
+
+                    for (std::uint64_t j = 1; j < Rounds - 1; ++j)
+                    {
+                        rk = W::load(laneKey<W>(keys, g, j));
+                        for (std::uint64_t i = 0; i < I; ++i)
+                            c[0][i] = W::enc(c[0][i], rk);
+                    }
+
+                    rk = W::load(laneKey<W>(keys, g, Rounds - 1));
+
+                    // the lanes past the last key hold padding and are masked out.
+                    auto mask = W::laneMask(l < finalLoop ? W::Lanes : partial);
+                    for (std::uint64_t i = 0; i < I; ++i)
+                        acc[i] = W::xor_(acc[i], W::and_(W::encLast(c[0][i], rk), mask));
+                }
+
+                for (std::uint64_t i = 0; i < I; ++i)
+                    out[i] = W::reduce(acc[i]);
+            }
+
+            // out[i] = XOR_k AES_k(in[i]). Inputs are processed 8 * W::Lanes at a time with
+            // one key broadcast to every lane. The remaining multiple of W::Lanes inputs
+            // are processed with several keys at once, and the final 1 to W::Lanes-1
+            // inputs are processed with W::Lanes keys per register.
+            template<typename W>
+            inline void ecbEncBlocksSum(const KeyView& keys, const __m128i* in, std::uint64_t n, __m128i* out)
+            {
+                const std::uint64_t step = 8 * W::Lanes;
+                auto mainLoop = n / step;
+                for (std::uint64_t l = 0; l < mainLoop; ++l)
+                {
+                    sumTileBroadcastKey<W, 8>(keys, in, out);
+                    in += step;
+                    out += step;
+                }
+
+                n %= step;
+                auto regs = n / W::Lanes;
+                switch (regs)
+                {
+                case 1: sumTileBroadcastKey<W, 1>(keys, in, out); break;
+                case 2: sumTileBroadcastKey<W, 2>(keys, in, out); break;
+                case 3: sumTileBroadcastKey<W, 3>(keys, in, out); break;
+                case 4: sumTileBroadcastKey<W, 4>(keys, in, out); break;
+                case 5: sumTileBroadcastKey<W, 5>(keys, in, out); break;
+                case 6: sumTileBroadcastKey<W, 6>(keys, in, out); break;
+                case 7: sumTileBroadcastKey<W, 7>(keys, in, out); break;
+                default: break;
+                }
+                in += regs * W::Lanes;
+                out += regs * W::Lanes;
+
+                switch (n % W::Lanes)
+                {
+                case 1: sumTileBroadcastInput<W, 1>(keys, in, out); break;
+                case 2: sumTileBroadcastInput<W, 2>(keys, in, out); break;
+                case 3: sumTileBroadcastInput<W, 3>(keys, in, out); break;
+                default: break;
+                }
+            }
+        }
+    }
+}
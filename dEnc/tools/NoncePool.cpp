@@ -0,0 +1,95 @@
+#include "NoncePool.h"
+
+namespace dEnc
+{
+    template<typename Group>
+    void NoncePoolT<Group>::start(const FixedBase& gen, u64 capacity, u64 lowWatermark, block seed)
+    {
+        if (lowWatermark >= capacity)
+            throw std::runtime_error("the low watermark must be less than the capacity. " LOCATION);
+        if (gen.initialized() == false)
+            throw std::runtime_error("the table of the generator is not initialized. " LOCATION);
+
+        stop();
+
+        mCapacity = capacity;
+        mLowWatermark = lowWatermark;
+        mStopped = false;
+        mNonces.reserve(capacity);
+        mThread = std::thread([this, &gen, seed]() { fillLoop(gen, seed); });
+    }
+
+    template<typename Group>
+    void NoncePoolT<Group>::stop()
+    {
+        if (mThread.joinable() == false)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            mStopped = true;
+        }
+        mCv.notify_one();
+        mThread.join();
+
+        mNonces.clear();
+    }
+
+    template<typename Group>
+    bool NoncePoolT<Group>::tryTake(Num& r, Point& gr)
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        if (mNonces.empty())
+            return false;
+
+        auto& n = mNonces.back();
+        r = n.r;
+        gr = n.gr;
+        mNonces.pop_back();
+
+        if (mNonces.size() == mLowWatermark)
+            mCv.notify_one();
+
+        return true;
+    }
+
+    template<typename Group>
+    u64 NoncePoolT<Group>::size() const
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        return mNonces.size();
+    }
+
+    template<typename Group>
+    void NoncePoolT<Group>::fillLoop(const FixedBase& gen, block seed)
+    {
+        // sets up the context of the group on this thread.
+        typename Group::Context ctx;
+        PRNG prng(seed);
+        Nonce n;
+
+        std::unique_lock<std::mutex> lock(mMtx);
+        while (true)
+        {
+            mCv.wait(lock, [&]() { return mStopped || mNonces.size() <= mLowWatermark; });
+
+            // The nonces are computed without holding the lock so
+            // that tryTake(...) is not blocked in the meantime.
+            while (mStopped == false && mNonces.size() < mCapacity)
+            {
+                lock.unlock();
+                n.r.randomize(prng);
+                n.gr = gen.mul(n.r);
+                lock.lock();
+
+                mNonces.push_back(n);
+            }
+
+            if (mStopped)
+                return;
+        }
+    }
+
+    template class NoncePoolT<RelicGroup>;
+    template class NoncePoolT<Rist255Group>;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include "Group.h"
+#include <cryptoTools/Crypto/PRNG.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace dEnc
+{
+    // A pool of proof nonces (r, g^r) that a background thread precomputes
+    // while the server is idle. The nonces do not depend on the input and so
+    // the fixed base multiplication g^r can be moved off the critical path of
+    // a request. Once the pool holds at most the low watermark of nonces, the
+    // thread refills it to its capacity.
+    template<typename Group>
+    class NoncePoolT
+    {
+    public:
+        using Num = typename Group::Num;
+        using Point = typename Group::Point;
+        using FixedBase = typename Group::FixedBase;
+
+        NoncePoolT() = default;
+        NoncePoolT(const NoncePoolT&) = delete;
+        ~NoncePoolT() { stop(); }
+
+        /**
+         * Starts the background thread. Any previous thread is stopped first.
+         * @param[in] gen           - The table of g, which must outlive the pool or a call to stop().
+         * @param[in] capacity      - The number of nonces that the pool is filled to.
+         * @param[in] lowWatermark  - The pool is refilled once it holds at most this many nonces.
+         * @param[in] seed          - The seed of the nonces.
+         */
+        void start(const FixedBase& gen, u64 capacity, u64 lowWatermark, block seed);
+
+        // Stops the background thread and discards the nonces.
+        void stop();
+
+        /**
+         * Takes a nonce from the pool. Returns false if the pool is empty, in
+         * which case the caller should compute the nonce itself.
+         * @param[out] r   - The random scalar.
+         * @param[out] gr  - g^r.
+         */
+        bool tryTake(Num& r, Point& gr);
+
+        // The number of nonces in the pool.
+        u64 size() const;
+
+        bool running() const { return mThread.joinable(); }
+
+    private:
+        void fillLoop(const FixedBase& gen, block seed);
+
+        struct Nonce
+        {
+            Num r;
+            Point gr;
+        };
+
+        u64 mCapacity = 0, mLowWatermark = 0;
+        bool mStopped = false;
+        std::vector<Nonce> mNonces;
+        mutable std::mutex mMtx;
+        std::condition_variable mCv;
+        std::thread mThread;
+    };
+
+    using NoncePool = NoncePoolT<RelicGroup>;
+}
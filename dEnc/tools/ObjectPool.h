@@ -0,0 +1,88 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace dEnc
+{
+    // A thread safe pool of reusable objects. acquire() hands out an idle object and
+    // only constructs a new one if none is idle. The object returns to the pool when
+    // its handle is destroyed and keeps its state, e.g. the storage of its members,
+    // for the next user. Once the pool holds as many objects as are used at the same
+    // time, acquiring one no longer constructs an object, which growths() can be used
+    // to check. It only counts the growth that the pool and its users report, not
+    // every heap allocation that is made while an object is in use.
+    template<typename T>
+    class ObjectPool
+    {
+    public:
+        class Handle
+        {
+        public:
+            Handle() = default;
+            Handle(const Handle&) = delete;
+            Handle(Handle&& o) : mPool(o.mPool), mObj(std::move(o.mObj)) { o.mPool = nullptr; }
+            ~Handle() { if (mObj) mPool->release(std::move(mObj)); }
+
+            T& operator*() const { return *mObj; }
+            T* operator->() const { return mObj.get(); }
+
+        private:
+            friend class ObjectPool;
+            Handle(ObjectPool* pool, std::unique_ptr<T> obj) : mPool(pool), mObj(std::move(obj)) {}
+
+            ObjectPool* mPool = nullptr;
+            std::unique_ptr<T> mObj;
+        };
+
+        ObjectPool() = default;
+        ObjectPool(const ObjectPool&) = delete;
+
+        // Returns an idle object, or a default constructed one if there is none.
+        Handle acquire()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMtx);
+                if (mIdle.size())
+                {
+                    auto obj = std::move(mIdle.back());
+                    mIdle.pop_back();
+                    return Handle(this, std::move(obj));
+                }
+            }
+
+            countGrowth();
+            return Handle(this, std::unique_ptr<T>(new T));
+        }
+
+        // Records that a user grew the storage of an object, so that growths() 
+        // also covers the objects' members.
+        void countGrowth() { ++mGrowths; }
+
+        // The number of times that the pool constructed an object or grew its idle
+        // list, plus the number of times that users reported growing an object.
+        u64 growths() const { return mGrowths; }
+
+        // The number of idle objects.
+        u64 size() const
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            return mIdle.size();
+        }
+
+    private:
+        void release(std::unique_ptr<T> obj)
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            if (mIdle.size() == mIdle.capacity())
+                countGrowth();
+            mIdle.push_back(std::move(obj));
+        }
+
+        mutable std::mutex mMtx;
+        std::vector<std::unique_ptr<T>> mIdle;
+        std::atomic<u64> mGrowths{ 0 };
+    };
+}
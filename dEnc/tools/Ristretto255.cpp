@@ -0,0 +1,851 @@
+#include "Ristretto255.h"
+#include <cryptoTools/Crypto/AES.h>
+#include <cryptoTools/Crypto/RandomOracle.h>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The field and point arithmetic follows the ed25519 reference implementation,
+// and the ristretto encoding, decoding and one-way map follow RFC 9496.
+
+namespace dEnc
+{
+    namespace
+    {
+#ifdef _MSC_VER
+        struct u128 { u64 lo, hi; };
+        inline u128 mul64(u64 a, u64 b) { u128 r; r.lo = _umul128(a, b, &r.hi); return r; }
+        inline void add64(u128& a, u64 b) { a.lo += b; a.hi += (a.lo < b); }
+        inline void add128(u128& a, const u128& b) { a.lo += b.lo; a.hi += b.hi + (a.lo < b.lo); }
+        inline u64 lo64(const u128& a) { return a.lo; }
+        inline u64 hi64(const u128& a) { return a.hi; }
+        inline u64 shr51(const u128& a) { return (a.lo >> 51) | (a.hi << 13); }
+#else
+        typedef unsigned __int128 u128;
+        inline u128 mul64(u64 a, u64 b) { return u128(a) * b; }
+        inline void add64(u128& a, u64 b) { a += b; }
+        inline void add128(u128& a, const u128& b) { a += b; }
+        inline u64 lo64(const u128& a) { return u64(a); }
+        inline u64 hi64(const u128& a) { return u64(a >> 64); }
+        inline u64 shr51(const u128& a) { return u64(a >> 51); }
+#endif
+
+        using Fe = Rist255Fe;
+        using Cached = Rist255FixedBase::Cached;
+
+        const u64 mask51 = (u64(1) << 51) - 1;
+
+        const Fe feZero{ { 0, 0, 0, 0, 0 } };
+        const Fe feOne{ { 1, 0, 0, 0, 0 } };
+
+        // The curve constant d = -121665/121666 and 2d.
+        const Fe feD{ { 0x34dca135978a3ull, 0x1a8283b156ebdull, 0x5e7a26001c029ull, 0x739c663a03cbbull, 0x52036cee2b6ffull } };
+        const Fe feD2{ { 0x69b9426b2f159ull, 0x35050762add7aull, 0x3cf44c0038052ull, 0x6738cc7407977ull, 0x2406d9dc56dffull } };
+
+        // The constants of RFC 9496.
+        const Fe feSqrtM1{ { 0x61b274a0ea0b0ull, 0x0d5a5fc8f189dull, 0x7ef5e9cbd0c60ull, 0x78595a6804c9eull, 0x2b8324804fc1dull } };
+        const Fe feInvSqrtAMinusD{ { 0x0fdaa805d40eaull, 0x2eb482e57d339ull, 0x007610274bc58ull, 0x6510b613dc8ffull, 0x786c8905cfaffull } };
+        const Fe feSqrtAdMinusOne{ { 0x7f6a0497b2e1bull, 0x1836f0a97afd2ull, 0x7d747f6be7638ull, 0x456079e7e6498ull, 0x376931bf2b834ull } };
+        const Fe feOneMinusDSq{ { 0x409c1945fc176ull, 0x719abc6a1fc4full, 0x1c37f90b20684ull, 0x06bccca55eedfull, 0x029072a8b2b3eull } };
+        const Fe feDMinusOneSq{ { 0x55aaa44ed4d20ull, 0x59603c3332635ull, 0x26d3baf4a7928ull, 0x120a66e6997a9ull, 0x5968b37af66c2ull } };
+
+        // The ed25519 base point, which is the generator of ristretto255.
+        const Fe feBx{ { 0x62d608f25d51aull, 0x412a4b4f6592aull, 0x75b7171a4b31dull, 0x1ff60527118feull, 0x216936d3cd6e5ull } };
+        const Fe feBy{ { 0x6666666666658ull, 0x4ccccccccccccull, 0x1999999999999ull, 0x3333333333333ull, 0x6666666666666ull } };
+        const Fe feBt{ { 0x68ab3a5b7dda3ull, 0x00eea2a5eadbbull, 0x2af8df483c27eull, 0x332b375274732ull, 0x67875f0fd78b7ull } };
+
+        // Propagates the carries so that every limb is less than 2^51 + 2^13.
+        inline void feCarry(Fe& h)
+        {
+            u64 c;
+            c = h.v[0] >> 51; h.v[0] &= mask51; h.v[1] += c;
+            c = h.v[1] >> 51; h.v[1] &= mask51; h.v[2] += c;
+            c = h.v[2] >> 51; h.v[2] &= mask51; h.v[3] += c;
+            c = h.v[3] >> 51; h.v[3] &= mask51; h.v[4] += c;
+            c = h.v[4] >> 51; h.v[4] &= mask51; h.v[0] += c * 19;
+        }
+
+        // The sum is not carried. Its limbs are less than 2^53 which is small enough
+        // for feMul and, as the sum of two carried values, to be subtracted by feSub.
+        inline Fe feAdd(const Fe& a, const Fe& b)
+        {
+            Fe h;
+            for (u64 i = 0; i < 5; ++i)
+                h.v[i] = a.v[i] + b.v[i];
+            return h;
+        }
+
+        inline Fe feSub(const Fe& a, const Fe& b)
+        {
+            // a + 4p - b, which does not underflow if the limbs of b are less than 2^53 - 76.
+            Fe h;
+            h.v[0] = a.v[0] + 0x1fffffffffffb4ull - b.v[0];
+            for (u64 i = 1; i < 5; ++i)
+                h.v[i] = a.v[i] + 0x1ffffffffffffcull - b.v[i];
+            feCarry(h);
+            return h;
+        }
+
+        inline Fe feNeg(const Fe& a)
+        {
+            return feSub(feZero, a);
+        }
+
+        inline Fe feMul(const Fe& a, const Fe& b)
+        {
+            u64 b1 = 19 * b.v[1], b2 = 19 * b.v[2], b3 = 19 * b.v[3], b4 = 19 * b.v[4];
+            auto& f = a.v;
+            auto& g = b.v;
+
+            u128 r0 = mul64(f[0], g[0]); add128(r0, mul64(f[1], b4)); add128(r0, mul64(f[2], b3)); add128(r0, mul64(f[3], b2)); add128(r0, mul64(f[4], b1));
+            u128 r1 = mul64(f[0], g[1]); add128(r1, mul64(f[1], g[0])); add128(r1, mul64(f[2], b4)); add128(r1, mul64(f[3], b3)); add128(r1, mul64(f[4], b2));
+            u128 r2 = mul64(f[0], g[2]); add128(r2, mul64(f[1], g[1])); add128(r2, mul64(f[2], g[0])); add128(r2, mul64(f[3], b4)); add128(r2, mul64(f[4], b3));
+            u128 r3 = mul64(f[0], g[3]); add128(r3, mul64(f[1], g[2])); add128(r3, mul64(f[2], g[1])); add128(r3, mul64(f[3], g[0])); add128(r3, mul64(f[4], b4));
+            u128 r4 = mul64(f[0], g[4]); add128(r4, mul64(f[1], g[3])); add128(r4, mul64(f[2], g[2])); add128(r4, mul64(f[3], g[1])); add128(r4, mul64(f[4], g[0]));
+
+            Fe h;
+            u64 c;
+            h.v[0] = lo64(r0) & mask51; c = shr51(r0); add64(r1, c);
+            h.v[1] = lo64(r1) & mask51; c = shr51(r1); add64(r2, c);
+            h.v[2] = lo64(r2) & mask51; c = shr51(r2); add64(r3, c);
+            h.v[3] = lo64(r3) & mask51; c = shr51(r3); add64(r4, c);
+            h.v[4] = lo64(r4) & mask51; c = shr51(r4);
+            h.v[0] += c * 19;
+            c = h.v[0] >> 51; h.v[0] &= mask51; h.v[1] += c;
+            return h;
+        }
+
+        inline Fe feSq(const Fe& a)
+        {
+            auto& f = a.v;
+            u64 d0 = 2 * f[0], d1 = 2 * f[1];
+            u64 f3_19 = 19 * f[3], f4_19 = 19 * f[4];
+            u64 f3_38 = 2 * f3_19, f4_38 = 2 * f4_19;
+
+            u128 r0 = mul64(f[0], f[0]); add128(r0, mul64(f[1], f4_38)); add128(r0, mul64(f[2], f3_38));
+            u128 r1 = mul64(d0, f[1]); add128(r1, mul64(f[2], f4_38)); add128(r1, mul64(f[3], f3_19));
+            u128 r2 = mul64(d0, f[2]); add128(r2, mul64(f[1], f[1])); add128(r2, mul64(f[3], f4_38));
+            u128 r3 = mul64(d0, f[3]); add128(r3, mul64(d1, f[2])); add128(r3, mul64(f[4], f4_19));
+            u128 r4 = mul64(d0, f[4]); add128(r4, mul64(d1, f[3])); add128(r4, mul64(f[2], f[2]));
+
+            Fe h;
+            u64 c;
+            h.v[0] = lo64(r0) & mask51; c = shr51(r0); add64(r1, c);
+            h.v[1] = lo64(r1) & mask51; c = shr51(r1); add64(r2, c);
+            h.v[2] = lo64(r2) & mask51; c = shr51(r2); add64(r3, c);
+            h.v[3] = lo64(r3) & mask51; c = shr51(r3); add64(r4, c);
+            h.v[4] = lo64(r4) & mask51; c = shr51(r4);
+            h.v[0] += c * 19;
+            c = h.v[0] >> 51; h.v[0] &= mask51; h.v[1] += c;
+            return h;
+        }
+
+        inline Fe feSqN(Fe a, u64 n)
+        {
+            for (u64 i = 0; i < n; ++i)
+                a = feSq(a);
+            return a;
+        }
+
+        // Returns the canonical little endian encoding of a.
+        void feToBytes(const Fe& a, u8* dest)
+        {
+            Fe h = a;
+            feCarry(h);
+            feCarry(h);
+
+            // q = 1 iff h >= p, in which case p is subtracted by adding 19 and dropping 2^255.
+            u64 q = (h.v[0] + 19) >> 51;
+            q = (h.v[1] + q) >> 51;
+            q = (h.v[2] + q) >> 51;
+            q = (h.v[3] + q) >> 51;
+            q = (h.v[4] + q) >> 51;
+
+            h.v[0] += 19 * q;
+            u64 c;
+            c = h.v[0] >> 51; h.v[0] &= mask51; h.v[1] += c;
+            c = h.v[1] >> 51; h.v[1] &= mask51; h.v[2] += c;
+            c = h.v[2] >> 51; h.v[2] &= mask51; h.v[3] += c;
+            c = h.v[3] >> 51; h.v[3] &= mask51; h.v[4] += c;
+            h.v[4] &= mask51;
+
+            u64 w[4];
+            w[0] = h.v[0] | (h.v[1] << 51);
+            w[1] = (h.v[1] >> 13) | (h.v[2] << 38);
+            w[2] = (h.v[2] >> 26) | (h.v[3] << 25);
+            w[3] = (h.v[3] >> 39) | (h.v[4] << 12);
+            for (u64 i = 0; i < 4; ++i)
+                for (u64 j = 0; j < 8; ++j)
+                    dest[8 * i + j] = u8(w[i] >> (8 * j));
+        }
+
+        // Reads 32 little endian bytes, ignoring the top bit.
+        Fe feFromBytes(const u8* src)
+        {
+            u64 w[4] = { 0,0,0,0 };
+            for (u64 i = 0; i < 4; ++i)
+                for (u64 j = 0; j < 8; ++j)
+                    w[i] |= u64(src[8 * i + j]) << (8 * j);
+
+            Fe h;
+            h.v[0] = w[0] & mask51;
+            h.v[1] = ((w[0] >> 51) | (w[1] << 13)) & mask51;
+            h.v[2] = ((w[1] >> 38) | (w[2] << 26)) & mask51;
+            h.v[3] = ((w[2] >> 25) | (w[3] << 39)) & mask51;
+            h.v[4] = (w[3] >> 12) & mask51;
+            return h;
+        }
+
+        bool feIsZero(const Fe& a)
+        {
+            u8 b[32];
+            feToBytes(a, b);
+            u8 acc = 0;
+            for (u64 i = 0; i < 32; ++i)
+                acc |= b[i];
+            return acc == 0;
+        }
+
+        bool feEq(const Fe& a, const Fe& b)
+        {
+            return feIsZero(feSub(a, b));
+        }
+
+        // The parity of the canonical value, i.e. whether a is "negative".
+        bool feIsNeg(const Fe& a)
+        {
+            u8 b[32];
+            feToBytes(a, b);
+            return b[0] & 1;
+        }
+
+        // a = b if flag, without branching on flag.
+        inline void feCmov(Fe& a, const Fe& b, bool flag)
+        {
+            u64 mask = 0 - u64(flag);
+            for (u64 i = 0; i < 5; ++i)
+                a.v[i] ^= mask & (a.v[i] ^ b.v[i]);
+        }
+
+        inline Fe feAbs(const Fe& a)
+        {
+            Fe r = a;
+            feCmov(r, feNeg(a), feIsNeg(a));
+            return r;
+        }
+
+        // Returns z^(2^250 - 1) and z^11, the common part of inversion and square roots.
+        void fePow2250(const Fe& z, Fe& z2_250_0, Fe& z11)
+        {
+            Fe z2 = feSq(z);
+            Fe z9 = feMul(feSqN(z2, 2), z);
+            z11 = feMul(z9, z2);
+            Fe z2_5_0 = feMul(feSq(z11), z9);
+            Fe z2_10_0 = feMul(feSqN(z2_5_0, 5), z2_5_0);
+            Fe z2_20_0 = feMul(feSqN(z2_10_0, 10), z2_10_0);
+            Fe z2_40_0 = feMul(feSqN(z2_20_0, 20), z2_20_0);
+            Fe z2_50_0 = feMul(feSqN(z2_40_0, 10), z2_10_0);
+            Fe z2_100_0 = feMul(feSqN(z2_50_0, 50), z2_50_0);
+            Fe z2_200_0 = feMul(feSqN(z2_100_0, 100), z2_100_0);
+            z2_250_0 = feMul(feSqN(z2_200_0, 50), z2_50_0);
+        }
+
+        // z^(p-2) = z^-1.
+        Fe feInvert(const Fe& z)
+        {
+            Fe t, z11;
+            fePow2250(z, t, z11);
+            return feMul(feSqN(t, 5), z11);
+        }
+
+        // z^((p-5)/8).
+        Fe fePow22523(const Fe& z)
+        {
+            Fe t, z11;
+            fePow2250(z, t, z11);
+            return feMul(feSqN(t, 2), z);
+        }
+
+        // Sets r to the non-negative sqrt(u/v) if it exists, or to sqrt(i * u/v)
+        // otherwise. Returns whether u/v is a square.
+        bool feSqrtRatioM1(const Fe& u, const Fe& v, Fe& r)
+        {
+            Fe v3 = feMul(feSq(v), v);
+            Fe v7 = feMul(feSq(v3), v);
+            r = feMul(feMul(u, v3), fePow22523(feMul(u, v7)));
+            Fe check = feMul(v, feSq(r));
+
+            Fe negU = feNeg(u);
+            bool correct = feEq(check, u);
+            bool flipped = feEq(check, negU);
+            bool flippedI = feEq(check, feMul(negU, feSqrtM1));
+
+            feCmov(r, feMul(r, feSqrtM1), flipped | flippedI);
+            r = feAbs(r);
+            return correct | flipped;
+        }
+
+        inline Cached toCached(const Rist255Point& p)
+        {
+            Cached c;
+            c.mYpX = feAdd(p.mY, p.mX);
+            c.mYmX = feSub(p.mY, p.mX);
+            c.mZ2 = feAdd(p.mZ, p.mZ);
+            c.mT2d = feMul(p.mT, feD2);
+            return c;
+        }
+
+        const Cached cachedIdentity{ feOne, feOne, { { 2, 0, 0, 0, 0 } }, feZero };
+
+        inline Cached negCached(const Cached& c)
+        {
+            return Cached{ c.mYmX, c.mYpX, c.mZ2, feNeg(c.mT2d) };
+        }
+
+        // p += q with the unified addition of extended coordinates.
+        inline void addCached(Rist255Point& p, const Cached& q)
+        {
+            Fe a = feMul(feSub(p.mY, p.mX), q.mYmX);
+            Fe b = feMul(feAdd(p.mY, p.mX), q.mYpX);
+            Fe c = feMul(p.mT, q.mT2d);
+            Fe d = feMul(p.mZ, q.mZ2);
+            Fe e = feSub(b, a), f = feSub(d, c), g = feAdd(d, c), h = feAdd(b, a);
+            p.mX = feMul(e, f);
+            p.mY = feMul(g, h);
+            p.mT = feMul(e, h);
+            p.mZ = feMul(f, g);
+        }
+
+        // Returns table[|digit| - 1], negated if digit < 0, or the identity if digit = 0,
+        // without branching on digit.
+        inline Cached select(const Cached* table, i8 digit)
+        {
+            u8 neg = u8(digit) >> 7;
+            u8 abs = u8(digit) - ((0 - neg) & (u8(digit) << 1));
+
+            Cached r = cachedIdentity;
+            for (u8 j = 1; j <= 8; ++j)
+            {
+                bool eq = abs == j;
+                feCmov(r.mYpX, table[j - 1].mYpX, eq);
+                feCmov(r.mYmX, table[j - 1].mYmX, eq);
+                feCmov(r.mZ2, table[j - 1].mZ2, eq);
+                feCmov(r.mT2d, table[j - 1].mT2d, eq);
+            }
+
+            auto n = negCached(r);
+            feCmov(r.mYpX, n.mYpX, neg);
+            feCmov(r.mYmX, n.mYmX, neg);
+            feCmov(r.mT2d, n.mT2d, neg);
+            return r;
+        }
+
+        // The digits of k in signed radix 16, each in [-8, 8].
+        void recode(const Rist255Number& k, i8* e)
+        {
+            u8 b[32];
+            k.toBytes(b);
+            for (u64 i = 0; i < 32; ++i)
+            {
+                e[2 * i] = b[i] & 15;
+                e[2 * i + 1] = b[i] >> 4;
+            }
+
+            // k < 2^253 and so the last digit is at most 2.
+            i8 carry = 0;
+            for (u64 i = 0; i < 63; ++i)
+            {
+                e[i] += carry;
+                carry = (e[i] + 8) >> 4;
+                e[i] -= carry << 4;
+            }
+            e[63] += carry;
+        }
+
+        // table[j] = (j + 1) * p for j = 0, ..., 7.
+        void multiples(const Rist255Point& p, Cached* table)
+        {
+            auto q = p;
+            table[0] = toCached(p);
+            for (u64 j = 1; j < 8; ++j)
+            {
+                addCached(q, table[0]);
+                table[j] = toCached(q);
+            }
+        }
+
+        // The order l and the constants of Montgomery multiplication with R = 2^256.
+        const u64 scL[4] = { 0x5812631a5cf5d3edull, 0x14def9dea2f79cd6ull, 0x0000000000000000ull, 0x1000000000000000ull };
+        const u64 scLInv = 0xd2b51da312547e1bull;  // -l^-1 mod 2^64
+        const u64 scR2[4] = { 0xa40611e3449c0f01ull, 0xd00e1ba768859347ull, 0xceec73d217f5be65ull, 0x0399411b7c309a3dull };
+        const u64 scOne[4] = { 1, 0, 0, 0 };
+
+        // r = r - l if r >= l.
+        void scReduceOnce(u64* r, u64 top = 0)
+        {
+            u64 t[4], borrow = 0;
+            for (u64 i = 0; i < 4; ++i)
+            {
+                u64 d = r[i] - scL[i];
+                u64 b1 = r[i] < scL[i];
+                t[i] = d - borrow;
+                borrow = b1 | (d < borrow);
+            }
+
+            // keep r if it was smaller than l.
+            u64 keep = 0 - u64(borrow > top);
+            for (u64 i = 0; i < 4; ++i)
+                r[i] = (r[i] & keep) | (t[i] & ~keep);
+        }
+
+        // r = a * b / 2^256 mod l, for a < 2^256 and b < l.
+        void scMontMul(const u64* a, const u64* b, u64* r)
+        {
+            u64 t[6] = { 0,0,0,0,0,0 };
+            for (u64 i = 0; i < 4; ++i)
+            {
+                u64 c = 0;
+                for (u64 j = 0; j < 4; ++j)
+                {
+                    u128 x = mul64(a[j], b[i]); add64(x, t[j]); add64(x, c);
+                    t[j] = lo64(x); c = hi64(x);
+                }
+                u128 x = u128(); add64(x, t[4]); add64(x, c);
+                t[4] = lo64(x); t[5] = hi64(x);
+
+                u64 m = t[0] * scLInv;
+                x = mul64(m, scL[0]); add64(x, t[0]);
+                c = hi64(x);
+                for (u64 j = 1; j < 4; ++j)
+                {
+                    x = mul64(m, scL[j]); add64(x, t[j]); add64(x, c);
+                    t[j - 1] = lo64(x); c = hi64(x);
+                }
+                x = u128(); add64(x, t[4]); add64(x, c);
+                t[3] = lo64(x);
+                t[4] = t[5] + hi64(x);
+            }
+
+            memcpy(r, t, 4 * sizeof(u64));
+            scReduceOnce(r, t[4]);
+        }
+
+        // r = a mod l for any a < 2^256.
+        void scReduce(const u64* a, u64* r)
+        {
+            u64 t[4];
+            scMontMul(a, scR2, t);
+            scMontMul(t, scOne, r);
+        }
+    }
+
+    Rist255Number::Rist255Number(const i32& val)
+        : mVal{ u64(val < 0 ? -i64(val) : i64(val)), 0, 0, 0 }
+    {
+        if (val < 0)
+            *this = -*this;
+    }
+
+    Rist255Number& Rist255Number::operator+=(const Rist255Number& b)
+    {
+        // both are less than l < 2^253 and so the sum does not overflow.
+        u64 carry = 0;
+        for (u64 i = 0; i < 4; ++i)
+        {
+            u64 s = mVal[i] + carry;
+            carry = s < carry;
+            mVal[i] = s + b.mVal[i];
+            carry |= mVal[i] < s;
+        }
+        scReduceOnce(mVal);
+        return *this;
+    }
+
+    Rist255Number& Rist255Number::operator-=(const Rist255Number& b)
+    {
+        return *this += -b;
+    }
+
+    Rist255Number& Rist255Number::operator*=(const Rist255Number& b)
+    {
+        u64 t[4];
+        scMontMul(mVal, b.mVal, t);
+        scMontMul(t, scR2, mVal);
+        return *this;
+    }
+
+    Rist255Number Rist255Number::operator-() const
+    {
+        Rist255Number r;
+        u64 borrow = 0, nonZero = 0;
+        for (u64 i = 0; i < 4; ++i)
+        {
+            u64 d = scL[i] - mVal[i];
+            u64 b1 = scL[i] < mVal[i];
+            r.mVal[i] = d - borrow;
+            borrow = b1 | (d < borrow);
+            nonZero |= mVal[i];
+        }
+
+        // -0 = 0 rather than l.
+        u64 keep = 0 - u64(nonZero != 0);
+        for (u64 i = 0; i < 4; ++i)
+            r.mVal[i] &= keep;
+        return r;
+    }
+
+    Rist255Number Rist255Number::inverse() const
+    {
+        if (*this == Rist255Number())
+            throw std::runtime_error("zero does not have an inverse. " LOCATION);
+
+        // this^(l-2) in the Montgomery domain.
+        u64 e[4];
+        memcpy(e, scL, sizeof(e));
+        e[0] -= 2;
+
+        u64 base[4], acc[4], t[4];
+        scMontMul(mVal, scR2, base);
+        scMontMul(scOne, scR2, acc);
+        for (i64 i = 252; i >= 0; --i)
+        {
+            scMontMul(acc, acc, t);
+            if ((e[i / 64] >> (i % 64)) & 1)
+                scMontMul(t, base, acc);
+            else
+                memcpy(acc, t, sizeof(t));
+        }
+
+        Rist255Number r;
+        scMontMul(acc, scOne, r.mVal);
+        return r;
+    }
+
+    bool Rist255Number::operator==(const Rist255Number& b) const
+    {
+        return memcmp(mVal, b.mVal, sizeof(mVal)) == 0;
+    }
+
+    void Rist255Number::toBytes(u8* dest) const
+    {
+        for (u64 i = 0; i < 4; ++i)
+            for (u64 j = 0; j < 8; ++j)
+                dest[8 * i + j] = u8(mVal[i] >> (8 * j));
+    }
+
+    void Rist255Number::fromBytes(const u8* src)
+    {
+        u64 w[4] = { 0,0,0,0 };
+        for (u64 i = 0; i < 4; ++i)
+            for (u64 j = 0; j < 8; ++j)
+                w[i] |= u64(src[8 * i + j]) << (8 * j);
+        scReduce(w, mVal);
+    }
+
+    void Rist255Number::fromWideBytes(const u8* src)
+    {
+        // lo + hi * 2^256, where hi * 2^256 = MontMul(hi, 2^512).
+        Rist255Number lo, hi;
+        lo.fromBytes(src);
+
+        u64 w[4] = { 0,0,0,0 };
+        for (u64 i = 0; i < 4; ++i)
+            for (u64 j = 0; j < 8; ++j)
+                w[i] |= u64(src[32 + 8 * i + j]) << (8 * j);
+        scReduce(w, hi.mVal);
+        scMontMul(hi.mVal, scR2, mVal);
+
+        *this += lo;
+    }
+
+    void Rist255Number::randomize(PRNG& prng)
+    {
+        u8 buff[64];
+        prng.get(buff, sizeof(buff));
+        fromWideBytes(buff);
+    }
+
+    void Rist255Number::randomize(const block& seed)
+    {
+        // The blocks of the AES counter mode stream of seed, like a PRNG(seed).
+        oc::AES aes(seed);
+        block buff[4];
+        aes.ecbEncCounterMode(0, 4, buff);
+        fromWideBytes((u8*)buff);
+    }
+
+    Rist255Point::Rist255Point()
+        : mX(feZero)
+        , mY(feOne)
+        , mZ(feOne)
+        , mT(feZero)
+    {}
+
+    Rist255Point& Rist255Point::operator+=(const Rist255Point& b)
+    {
+        addCached(*this, toCached(b));
+        return *this;
+    }
+
+    Rist255Point& Rist255Point::operator-=(const Rist255Point& b)
+    {
+        addCached(*this, negCached(toCached(b)));
+        return *this;
+    }
+
+    Rist255Point Rist255Point::operator-() const
+    {
+        Rist255Point r = *this;
+        r.mX = feNeg(mX);
+        r.mT = feNeg(mT);
+        return r;
+    }
+
+    void Rist255Point::dbl()
+    {
+        Fe a = feSq(mX);
+        Fe b = feSq(mY);
+        Fe c = feSq(mZ); c = feAdd(c, c);
+        Fe e = feSub(feSub(feSq(feAdd(mX, mY)), a), b);
+        Fe g = feSub(b, a);
+        Fe f = feSub(g, c);
+        Fe h = feNeg(feAdd(a, b));
+        mX = feMul(e, f);
+        mY = feMul(g, h);
+        mT = feMul(e, h);
+        mZ = feMul(f, g);
+    }
+
+    Rist255Point& Rist255Point::operator*=(const Rist255Number& k)
+    {
+        i8 e[64];
+        recode(k, e);
+
+        Cached table[8];
+        multiples(*this, table);
+
+        // Constant time in k: the same doublings and additions for every
+        // scalar, and the additions select their point without branching.
+        Rist255Point q;
+        for (i64 i = 63; i >= 0; --i)
+        {
+            q.dbl(); q.dbl(); q.dbl(); q.dbl();
+            addCached(q, select(table, e[i]));
+        }
+
+        *this = q;
+        return *this;
+    }
+
+    bool Rist255Point::operator==(const Rist255Point& b) const
+    {
+        // Points that differ by a point of order 4 are the same group element.
+        return
+            feEq(feMul(mX, b.mY), feMul(mY, b.mX)) ||
+            feEq(feMul(mY, b.mY), feMul(mX, b.mX));
+    }
+
+    bool Rist255Point::isIdentity() const
+    {
+        return feIsZero(mX) || feIsZero(mY);
+    }
+
+    void Rist255Point::toBytes(u8* dest) const
+    {
+        Fe u1 = feMul(feAdd(mZ, mY), feSub(mZ, mY));
+        Fe u2 = feMul(mX, mY);
+
+        Fe invSqrt;
+        feSqrtRatioM1(feOne, feMul(u1, feSq(u2)), invSqrt);
+
+        Fe den1 = feMul(invSqrt, u1);
+        Fe den2 = feMul(invSqrt, u2);
+        Fe zInv = feMul(feMul(den1, den2), mT);
+
+        Fe ix0 = feMul(mX, feSqrtM1);
+        Fe iy0 = feMul(mY, feSqrtM1);
+        Fe enchantedDen = feMul(den1, feInvSqrtAMinusD);
+
+        bool rotate = feIsNeg(feMul(mT, zInv));
+        Fe x = mX, y = mY, denInv = den2;
+        feCmov(x, iy0, rotate);
+        feCmov(y, ix0, rotate);
+        feCmov(denInv, enchantedDen, rotate);
+
+        feCmov(y, feNeg(y), feIsNeg(feMul(x, zInv)));
+
+        auto s = feAbs(feMul(denInv, feSub(mZ, y)));
+        feToBytes(s, dest);
+    }
+
+    void Rist255Point::fromBytes(const u8* src)
+    {
+        // s must be canonical and non-negative.
+        Fe s = feFromBytes(src);
+        u8 canonical[32];
+        feToBytes(s, canonical);
+        if (memcmp(canonical, src, 32) || (canonical[0] & 1))
+            throw std::runtime_error("invalid ristretto255 encoding. " LOCATION);
+
+        Fe ss = feSq(s);
+        Fe u1 = feSub(feOne, ss);
+        Fe u2 = feAdd(feOne, ss);
+        Fe u2Sq = feSq(u2);
+        Fe v = feSub(feNeg(feMul(feD, feSq(u1))), u2Sq);
+
+        Fe invSqrt;
+        bool wasSquare = feSqrtRatioM1(feOne, feMul(v, u2Sq), invSqrt);
+
+        Fe denX = feMul(invSqrt, u2);
+        Fe denY = feMul(feMul(invSqrt, denX), v);
+
+        Fe x = feAbs(feMul(feAdd(s, s), denX));
+        Fe y = feMul(u1, denY);
+        Fe t = feMul(x, y);
+
+        if (!wasSquare || feIsNeg(t) || feIsZero(y))
+            throw std::runtime_error("invalid ristretto255 encoding. " LOCATION);
+
+        mX = x;
+        mY = y;
+        mZ = feOne;
+        mT = t;
+    }
+
+    namespace
+    {
+        // The elligator map of RFC 9496 from a field element to the group.
+        Rist255Point elligator(const Fe& t)
+        {
+            Fe r = feMul(feSqrtM1, feSq(t));
+            Fe u = feMul(feAdd(r, feOne), feOneMinusDSq);
+            Fe v = feMul(feSub(feNeg(feOne), feMul(r, feD)), feAdd(r, feD));
+
+            Fe s;
+            bool wasSquare = feSqrtRatioM1(u, v, s);
+            Fe sPrime = feNeg(feAbs(feMul(s, t)));
+            feCmov(s, sPrime, !wasSquare);
+
+            Fe c = feNeg(feOne);
+            feCmov(c, r, !wasSquare);
+
+            Fe n = feSub(feMul(feMul(c, feSub(r, feOne)), feDMinusOneSq), v);
+            Fe ss = feSq(s);
+
+            Fe w0 = feMul(feAdd(s, s), v);
+            Fe w1 = feMul(n, feSqrtAdMinusOne);
+            Fe w2 = feSub(feOne, ss);
+            Fe w3 = feAdd(feOne, ss);
+
+            Rist255Point p;
+            p.mX = feMul(w0, w3);
+            p.mY = feMul(w2, w1);
+            p.mZ = feMul(w1, w3);
+            p.mT = feMul(w0, w2);
+            return p;
+        }
+    }
+
+    void Rist255Point::fromUniformBytes(const u8* src)
+    {
+        *this = elligator(feFromBytes(src));
+        *this += elligator(feFromBytes(src + 32));
+    }
+
+    void Rist255Point::randomize(const block& seed)
+    {
+        u8 buff[64];
+        oc::RandomOracle ro(sizeof(buff));
+        ro.Update(seed);
+        ro.Final(buff);
+        fromUniformBytes(buff);
+    }
+
+    Rist255Point Rist255Point::generator()
+    {
+        Rist255Point g;
+        g.mX = feBx;
+        g.mY = feBy;
+        g.mZ = feOne;
+        g.mT = feBt;
+        return g;
+    }
+
+    void Rist255FixedBase::init(const Rist255Point& base)
+    {
+        mBase = base;
+        mTable.resize(64 * 8);
+
+        // mTable[8 * i + j] = (j + 1) * 16^i * base.
+        auto p = base;
+        for (u64 i = 0; i < 64; ++i)
+        {
+            multiples(p, &mTable[8 * i]);
+            p.dbl(); p.dbl(); p.dbl(); p.dbl();
+        }
+    }
+
+    Rist255Point Rist255FixedBase::mul(const Rist255Number& k) const
+    {
+        Rist255Point ret;
+        mul(k, ret);
+        return ret;
+    }
+
+    void Rist255FixedBase::mul(const Rist255Number& k, Rist255Point& dest) const
+    {
+        if (initialized() == false)
+            throw std::runtime_error("the fixed base table is not initialized. " LOCATION);
+
+        i8 e[64];
+        recode(k, e);
+
+        dest = Rist255Point();
+        for (u64 i = 0; i < 64; ++i)
+            addCached(dest, select(&mTable[8 * i], e[i]));
+    }
+
+    Rist255Point multiScalarMul(span<const Rist255Point> points, span<const Rist255Number> scalars)
+    {
+        Rist255Point ret;
+        multiScalarMul(points, scalars, { &ret, 1 });
+        return ret;
+    }
+
+    void multiScalarMul(span<const Rist255Point> points, span<const Rist255Number> scalars, span<Rist255Point> out)
+    {
+        auto n = scalars.size();
+        if (points.size() != n * out.size())
+            throw std::runtime_error("the number of points and scalars must match. " LOCATION);
+
+        std::vector<i8> e(64 * n);
+        for (u64 j = 0; j < n; ++j)
+            recode(scalars[j], &e[64 * j]);
+
+        // The additions branch on the digits and index the tables by them. This
+        // is only safe because callers never pass secret scalars, e.g. the key 
+        // share of a party is multiplied separately with operator*=.
+        std::vector<Cached> table(8 * n);
+        for (u64 o = 0; o < out.size(); ++o)
+        {
+            for (u64 j = 0; j < n; ++j)
+                multiples(points[o * n + j], &table[8 * j]);
+
+            Rist255Point q;
+            for (i64 i = 63; i >= 0; --i)
+            {
+                q.dbl(); q.dbl(); q.dbl(); q.dbl();
+                for (u64 j = 0; j < n; ++j)
+                {
+                    auto d = e[64 * j + i];
+                    if (d > 0)
+                        addCached(q, table[8 * j + d - 1]);
+                    else if (d < 0)
+                        addCached(q, negCached(table[8 * j - d - 1]));
+                }
+            }
+            out[o] = q;
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include <cryptoTools/Crypto/PRNG.h>
+
+namespace dEnc
+{
+    // An element of the field GF(2^255 - 19) in radix 2^51. The limbs are
+    // only partially reduced, see Ristretto255.cpp for the arithmetic.
+    struct Rist255Fe
+    {
+        u64 v[5];
+    };
+
+    // A scalar modulo the order l = 2^252 + 27742317777372353535851937790883648493
+    // of the ristretto255 group. Has the interface of oc::REccNumber that the
+    // DPRF uses, so that either can be the Num of a group backend.
+    class Rist255Number
+    {
+    public:
+        Rist255Number() : mVal{ 0,0,0,0 } {}
+        Rist255Number(const Rist255Number&) = default;
+        Rist255Number(PRNG& prng) { randomize(prng); }
+        Rist255Number(const i32& val);
+
+        Rist255Number& operator=(const Rist255Number&) = default;
+        Rist255Number& operator=(int i) { return *this = Rist255Number(i32(i)); }
+
+        Rist255Number& operator+=(const Rist255Number& b);
+        Rist255Number& operator-=(const Rist255Number& b);
+        Rist255Number& operator*=(const Rist255Number& b);
+        Rist255Number& operator/=(const Rist255Number& b) { return *this *= b.inverse(); }
+
+        Rist255Number operator-() const;
+        Rist255Number operator+(const Rist255Number& b) const { auto r = *this; return r += b; }
+        Rist255Number operator-(const Rist255Number& b) const { auto r = *this; return r -= b; }
+        Rist255Number operator*(const Rist255Number& b) const { auto r = *this; return r *= b; }
+        Rist255Number operator/(const Rist255Number& b) const { auto r = *this; return r /= b; }
+
+        // Returns the inverse. Throws if this is zero.
+        Rist255Number inverse() const;
+
+        bool operator==(const Rist255Number& b) const;
+        bool operator!=(const Rist255Number& b) const { return !(*this == b); }
+        bool operator==(const int& b) const { return *this == Rist255Number(i32(b)); }
+        bool operator!=(const int& b) const { return !(*this == b); }
+
+        u64 sizeBytes() const { return 32; }
+        void toBytes(u8* dest) const;
+
+        // Reads 32 little endian bytes, which are reduced modulo l.
+        void fromBytes(const u8* src);
+
+        // Sets this to a uniformly random scalar.
+        void randomize(PRNG& prng);
+
+        // Sets this to a scalar derived from seed.
+        void randomize(const block& seed);
+
+        // Sets this to the 64 little endian bytes of src modulo l, which is
+        // uniform if src is.
+        void fromWideBytes(const u8* src);
+
+        // The canonical value in little endian 64 bit limbs.
+        u64 mVal[4];
+    };
+
+    // An element of the ristretto255 group, the prime order group that is
+    // built on top of the Edwards form of curve25519. The points are kept in
+    // extended coordinates (X : Y : Z : T) of the Edwards curve and encoded
+    // with the 32 byte ristretto encoding. Has the interface of oc::REccPoint
+    // that the DPRF uses.
+    class Rist255Point
+    {
+    public:
+        // The identity.
+        Rist255Point();
+        Rist255Point(const Rist255Point&) = default;
+        Rist255Point& operator=(const Rist255Point&) = default;
+
+        Rist255Point& operator+=(const Rist255Point& b);
+        Rist255Point& operator-=(const Rist255Point& b);
+        Rist255Point& operator*=(const Rist255Number& k);
+
+        Rist255Point operator+(const Rist255Point& b) const { auto r = *this; return r += b; }
+        Rist255Point operator-(const Rist255Point& b) const { auto r = *this; return r -= b; }
+        Rist255Point operator*(const Rist255Number& k) const { auto r = *this; return r *= k; }
+        Rist255Point operator-() const;
+
+        bool operator==(const Rist255Point& b) const;
+        bool operator!=(const Rist255Point& b) const { return !(*this == b); }
+
+        bool isIdentity() const;
+
+        u64 sizeBytes() const { return 32; }
+        void toBytes(u8* dest) const;
+
+        // Decodes a ristretto encoding. Throws if src is not a valid encoding.
+        void fromBytes(const u8* src);
+
+        // Hashes seed to the group with the ristretto255 one-way map, so that
+        // the discrete log of the result is unknown.
+        void randomize(const block& seed);
+
+        // Sets this to the sum of the elligator maps of the two halves of the 64 bytes of src.
+        void fromUniformBytes(const u8* src);
+
+        // this = 2 * this.
+        void dbl();
+
+        static Rist255Point generator();
+
+        Rist255Fe mX, mY, mZ, mT;
+    };
+
+    // Precomputed multiples k * 16^i * base for k = 1, ..., 8 and every position i
+    // of a scalar in signed radix 16. A multiplication is then 64 additions and
+    // no doublings. The interface matches FixedBaseTable.
+    class Rist255FixedBase
+    {
+    public:
+        Rist255FixedBase() = default;
+        Rist255FixedBase(const Rist255Point& base) { init(base); }
+
+        /**
+         * Precomputes the table of base.
+         * @param[in] base  - The fixed point.
+         */
+        void init(const Rist255Point& base);
+
+        bool initialized() const { return mTable.size() != 0; }
+
+        // The fixed point.
+        const Rist255Point& base() const { return mBase; }
+
+        // Returns base() * k.
+        Rist255Point mul(const Rist255Number& k) const;
+
+        // Sets dest = base() * k.
+        void mul(const Rist255Number& k, Rist255Point& dest) const;
+
+        // A point in the form (Y + X, Y - X, 2Z, 2dT) that is added to a point in
+        // extended coordinates with fewer multiplications.
+        struct Cached
+        {
+            Rist255Fe mYpX, mYmX, mZ2, mT2d;
+        };
+
+    private:
+        Rist255Point mBase;
+        std::vector<Cached> mTable;
+    };
+
+    /**
+     * Computes the multi-scalar multiplication SUM_i scalars[i] * points[i] with
+     * Straus' method, where the doublings are shared by every point. Unlike
+     * operator*=, the running time depends on the scalars, which must therefore
+     * not be secret.
+     * @param[in] points   - The points.
+     * @param[in] scalars  - The scalars, one per point.
+     */
+    Rist255Point multiScalarMul(span<const Rist255Point> points, span<const Rist255Number> scalars);
+
+    /**
+     * Computes out[i] = SUM_j scalars[j] * points[i * scalars.size() + j] for every i.
+     * @param[in] points   - The points, scalars.size() per output in row-major order.
+     * @param[in] scalars  - The scalars, shared by every output.
+     * @param[out] out     - The results.
+     */
+    void multiScalarMul(span<const Rist255Point> points, span<const Rist255Number> scalars, span<Rist255Point> out);
+}
@@ -0,0 +1,166 @@
+#include "RoundKeyStore.h"
+#include <cryptoTools/Crypto/AES.h>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace dEnc
+{
+    namespace
+    {
+        // The size of a (2MB) huge page.
+        const u64 HugePageSize = 1 << 21;
+    }
+
+    RoundKeyStore::RoundKeyStore(const RoundKeyStore& copy)
+    {
+        *this = copy;
+    }
+
+    RoundKeyStore::RoundKeyStore(RoundKeyStore&& move)
+    {
+        *this = std::move(move);
+    }
+
+    RoundKeyStore::~RoundKeyStore()
+    {
+        release();
+    }
+
+    RoundKeyStore& RoundKeyStore::operator=(const RoundKeyStore& copy)
+    {
+        if (this != &copy)
+        {
+            allocate(copy.mNumKeys, copy.mPages);
+            if (mBytes)
+                memcpy(mData, copy.mData, copy.numGroups() * Rounds * GroupSize * sizeof(block));
+        }
+        return *this;
+    }
+
+    RoundKeyStore& RoundKeyStore::operator=(RoundKeyStore&& move)
+    {
+        if (this != &move)
+        {
+            release();
+            mData = move.mData;
+            mNumKeys = move.mNumKeys;
+            mBytes = move.mBytes;
+            mPages = move.mPages;
+            mMapped = move.mMapped;
+            mHugeMapped = move.mHugeMapped;
+
+            move.mData = nullptr;
+            move.mNumKeys = 0;
+            move.mBytes = 0;
+            move.mMapped = false;
+            move.mHugeMapped = false;
+        }
+        return *this;
+    }
+
+    void RoundKeyStore::setKeys(span<block> keys, Pages pages)
+    {
+        allocate(keys.size(), pages);
+
+        oc::AES aes;
+        for (u64 k = 0; k < mNumKeys; ++k)
+        {
+            aes.setKey(keys[k]);
+            auto dest = mData + (k / GroupSize) * Rounds * GroupSize + k % GroupSize;
+            for (u64 j = 0; j < Rounds; ++j)
+                dest[j * GroupSize] = aes.mRoundKey[j];
+        }
+    }
+
+    void RoundKeyStore::allocate(u64 numKeys, Pages pages)
+    {
+        release();
+
+        mNumKeys = numKeys;
+        mPages = pages;
+        mBytes = numGroups() * Rounds * GroupSize * sizeof(block);
+        if (mBytes == 0)
+            return;
+
+        void* ptr = nullptr;
+
+#ifndef _MSC_VER
+        if (pages == Pages::Huge)
+        {
+            auto bytes = (mBytes + HugePageSize - 1) / HugePageSize * HugePageSize;
+            auto prot = PROT_READ | PROT_WRITE;
+            auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_HUGETLB
+            // explicitly reserved huge pages, if any are available.
+            ptr = mmap(nullptr, bytes, prot, flags | MAP_HUGETLB, -1, 0);
+            if (ptr == MAP_FAILED)
+                ptr = nullptr;
+            else
+                mHugeMapped = true;
+#endif
+            if (ptr == nullptr)
+            {
+                // otherwise ask for transparent huge pages.
+                ptr = mmap(nullptr, bytes, prot, flags, -1, 0);
+                if (ptr == MAP_FAILED)
+                    ptr = nullptr;
+#ifdef MADV_HUGEPAGE
+                else
+                    madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+            }
+
+            if (ptr)
+            {
+                mBytes = bytes;
+                mMapped = true;
+            }
+        }
+#endif
+
+        if (ptr == nullptr)
+        {
+#ifdef _MSC_VER
+            ptr = _aligned_malloc(mBytes, Alignment);
+#else
+            if (posix_memalign(&ptr, Alignment, mBytes))
+                ptr = nullptr;
+#endif
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+        }
+
+        mData = static_cast<block*>(ptr);
+
+        // the lanes past the last key must be zero.
+        memset(mData, 0, mBytes);
+    }
+
+    void RoundKeyStore::release()
+    {
+        if (mData)
+        {
+#ifdef _MSC_VER
+            _aligned_free(mData);
+#else
+            if (mMapped)
+                munmap(mData, mBytes);
+            else
+                free(mData);
+#endif
+        }
+
+        mData = nullptr;
+        mNumKeys = 0;
+        mBytes = 0;
+        mMapped = false;
+        mHugeMapped = false;
+    }
+}
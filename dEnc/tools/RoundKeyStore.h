@@ -0,0 +1,112 @@
+#pragma once
+#include "dEnc/Defines.h"
+
+namespace dEnc
+{
+    // Holds the AES-128 round keys of many keys in a round-major layout. The keys
+    // are split into groups of GroupSize keys, and within a group round j of every
+    // key is stored contiguously. That is, round j of key k is located at
+    //
+    //    data()[((k / GroupSize) * Rounds + j) * GroupSize + k % GroupSize].
+    //
+    // A kernel that applies round j of eight keys therefore reads two consecutive
+    // cache lines instead of eight lines that are sizeof(oc::AES) bytes apart.
+    // The buffer is 64 byte aligned and can optionally be placed on huge pages.
+    // The lanes of the final group past the last key are zero.
+    class RoundKeyStore
+    {
+    public:
+        // The number of round keys in an AES-128 key schedule.
+        static const u64 Rounds = 11;
+
+        // The number of keys whose round keys are interleaved.
+        static const u64 GroupSize = 8;
+
+        // The alignment of the round keys in bytes.
+        static const u64 Alignment = 64;
+
+        // The kind of memory that the round keys are placed in.
+        enum class Pages
+        {
+            // Regular 64 byte aligned heap memory.
+            Default,
+            // Huge pages if the OS provides them, otherwise regular pages.
+            Huge
+        };
+
+        RoundKeyStore() = default;
+        RoundKeyStore(const RoundKeyStore& copy);
+        RoundKeyStore(RoundKeyStore&& move);
+        ~RoundKeyStore();
+
+        RoundKeyStore& operator=(const RoundKeyStore& copy);
+        RoundKeyStore& operator=(RoundKeyStore&& move);
+
+        /**
+         * Expands the keys and stores the round keys in the round-major layout.
+         * @param[in] keys   - The AES keys.
+         * @param[in] pages  - The kind of memory that the round keys should be placed in.
+         */
+        void setKeys(span<block> keys, Pages pages = Pages::Default);
+
+        // The number of keys.
+        u64 size() const { return mNumKeys; }
+
+        // The number of groups of GroupSize keys, including a partial final group.
+        u64 numGroups() const { return (mNumKeys + GroupSize - 1) / GroupSize; }
+
+        // The memory that was requested in setKeys.
+        Pages pages() const { return mPages; }
+
+        // Returns true if the round keys are known to be backed by huge pages.
+        bool onHugePages() const { return mHugeMapped; }
+
+        // The round keys, see the class description for the layout.
+        const block* data() const { return mData; }
+
+        /**
+         * Returns a pointer to round 0 of key k. Round j of key k + i is located at
+         * keyPtr(k)[j * GroupSize + i] for every key k + i in the same group as k.
+         * @param[in] k  - The index of the key.
+         */
+        const block* keyPtr(u64 k) const
+        {
+            return keyPtr(mData, k);
+        }
+
+        // Returns a pointer to round 0 of key k in the round-major layout starting at data.
+        static const block* keyPtr(const block* data, u64 k)
+        {
+            return data + (k / GroupSize) * Rounds * GroupSize + k % GroupSize;
+        }
+
+        /**
+         * Returns round j of key k.
+         * @param[in] k  - The index of the key.
+         * @param[in] j  - The round.
+         */
+        const block& roundKey(u64 k, u64 j) const
+        {
+            return keyPtr(k)[j * GroupSize];
+        }
+
+    private:
+        block* mData = nullptr;
+        u64 mNumKeys = 0;
+
+        // The size of the allocation in bytes.
+        u64 mBytes = 0;
+
+        Pages mPages = Pages::Default;
+
+        // true if mData was obtained with mmap, in which case
+        // it must be released with munmap.
+        bool mMapped = false;
+
+        // true if mData was mapped with MAP_HUGETLB.
+        bool mHugeMapped = false;
+
+        void allocate(u64 numKeys, Pages pages);
+        void release();
+    };
+}
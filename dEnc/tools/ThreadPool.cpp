@@ -0,0 +1,103 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <exception>
+
+namespace dEnc
+{
+    ThreadPool::ThreadPool(u64 numWorkers)
+    {
+        mWorkers.reserve(numWorkers);
+        for (u64 i = 0; i < numWorkers; ++i)
+            mWorkers.emplace_back([this]() { workerLoop(); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            mStopped = true;
+        }
+        mCv.notify_all();
+
+        for (auto& t : mWorkers)
+            t.join();
+    }
+
+    void ThreadPool::parallelFor(u64 n, u64 numShards, const std::function<void(u64 begin, u64 end)>& fn)
+    {
+        if (n == 0)
+            return;
+
+        numShards = std::max<u64>(1, std::min(numShards, n));
+        if (numShards == 1 || mWorkers.size() == 0)
+        {
+            fn(0, n);
+            return;
+        }
+
+        // The state shared by the shards. It lives on this stack frame
+        // since this function only returns once every shard is done.
+        std::mutex doneMtx;
+        std::condition_variable doneCv;
+        u64 remaining = numShards - 1;
+        std::exception_ptr error;
+
+        auto run = [&](u64 s)
+        {
+            auto begin = n * s / numShards;
+            auto end = n * (s + 1) / numShards;
+
+            try { fn(begin, end); }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(doneMtx);
+                if (!error)
+                    error = std::current_exception();
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            for (u64 s = 1; s < numShards; ++s)
+            {
+                mQueue.emplace_back([&, s]()
+                {
+                    run(s);
+
+                    std::lock_guard<std::mutex> lock(doneMtx);
+                    if (--remaining == 0)
+                        doneCv.notify_one();
+                });
+            }
+        }
+        mCv.notify_all();
+
+        run(0);
+
+        std::unique_lock<std::mutex> lock(doneMtx);
+        doneCv.wait(lock, [&]() { return remaining == 0; });
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMtx);
+                mCv.wait(lock, [&]() { return mStopped || mQueue.size(); });
+
+                if (mQueue.empty())
+                    return;
+
+                task = std::move(mQueue.front());
+                mQueue.pop_front();
+            }
+
+            task();
+        }
+    }
+}
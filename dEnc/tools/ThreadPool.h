@@ -0,0 +1,53 @@
+#pragma once
+#include "dEnc/Defines.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace dEnc
+{
+    // A fixed set of worker threads which large DPRF requests are split across.
+    // The thread that calls parallelFor works on one of the shards itself, so a
+    // pool with zero workers runs everything on the calling thread. One pool
+    // can be shared by several DPRF instances.
+    class ThreadPool
+    {
+    public:
+        /**
+         * Starts the worker threads.
+         * @param[in] numWorkers  - The number of worker threads.
+         */
+        ThreadPool(u64 numWorkers);
+
+        // Waits for the queued shards and joins the workers.
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // The number of threads that a parallelFor runs on, i.e. the workers and the caller.
+        u64 numThreads() const { return mWorkers.size() + 1; }
+
+        /**
+         * Splits [0, n) into numShards contiguous ranges of nearly equal size and
+         * calls fn(begin, end) for each of them. The calling thread processes the
+         * first range and then waits until every range has been processed. If fn
+         * throws, the first exception is rethrown once all ranges have completed.
+         * @param[in] n          - The size of the range that is split.
+         * @param[in] numShards  - The number of ranges, clamped to [1, n].
+         * @param[in] fn         - Called once per range.
+         */
+        void parallelFor(u64 n, u64 numShards, const std::function<void(u64 begin, u64 end)>& fn);
+
+    private:
+        void workerLoop();
+
+        std::mutex mMtx;
+        std::condition_variable mCv;
+        std::deque<std::function<void()>> mQueue;
+        bool mStopped = false;
+        std::vector<std::thread> mWorkers;
+    };
+}
@@ -0,0 +1,94 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace
+{
+    int openCounter(dEnc::u64 cache)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = cache
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // this thread, any cpu.
+        return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+PerfCounters::PerfCounters()
+{
+    mFds[L1DMiss] = openCounter(PERF_COUNT_HW_CACHE_L1D);
+    mFds[LLCMiss] = openCounter(PERF_COUNT_HW_CACHE_LL);
+    mFds[DTLBMiss] = openCounter(PERF_COUNT_HW_CACHE_DTLB);
+    for (auto& v : mValues) v = 0;
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (auto fd : mFds)
+        if (fd != -1)
+            close(fd);
+}
+
+void PerfCounters::start()
+{
+    for (auto fd : mFds)
+    {
+        if (fd != -1)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop()
+{
+    for (int i = 0; i < NumEvents; ++i)
+    {
+        mValues[i] = 0;
+        if (mFds[i] != -1)
+        {
+            ioctl(mFds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(mFds[i], &mValues[i], sizeof(mValues[i])) != sizeof(mValues[i]))
+                mValues[i] = 0;
+        }
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+    for (auto& fd : mFds) fd = -1;
+    for (auto& v : mValues) v = 0;
+}
+
+PerfCounters::~PerfCounters() {}
+void PerfCounters::start() {}
+void PerfCounters::stop() {}
+
+#endif
+
+std::string PerfCounters::name(Event e)
+{
+    switch (e)
+    {
+    case L1DMiss: return "L1D-miss";
+    case LLCMiss: return "LLC-miss";
+    case DTLBMiss: return "dTLB-miss";
+    default: return "unknown";
+    }
+}
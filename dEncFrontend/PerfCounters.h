@@ -0,0 +1,48 @@
+#pragma once
+
+#include <dEnc/Defines.h>
+#include <string>
+#include <vector>
+
+// Reads the hardware cache counters of the calling thread using perf_event_open.
+// On other platforms, or if the kernel does not allow access, available()
+// returns false and every counter reads as zero.
+class PerfCounters
+{
+public:
+    enum Event
+    {
+        // L1 data cache read misses.
+        L1DMiss,
+        // last level cache read misses.
+        LLCMiss,
+        // data TLB read misses.
+        DTLBMiss,
+        NumEvents
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Returns true if the counter for the event could be opened.
+    bool available(Event e) const { return mFds[e] != -1; }
+
+    // Resets and enables every counter.
+    void start();
+
+    // Disables the counters and reads their values.
+    void stop();
+
+    // The value of the counter at the last call to stop().
+    dEnc::u64 get(Event e) const { return mValues[e]; }
+
+    // A short name of the event.
+    static std::string name(Event e);
+
+private:
+    int mFds[NumEvents];
+    dEnc::u64 mValues[NumEvents];
+};
@@ -2,6 +2,7 @@
 #include <dEnc/distEnc/AmmrClient.h>
 #include <dEnc/dprf/Npr03SymDprf.h>
 #include <dEnc/dprf/Npr03AsymDprf.h>
+#include <dEnc/dprf/DprfAuditor.h>
 
 #include <cryptoTools/Network/IOService.h>
 #include <cryptoTools/Network/Endpoint.h>
@@ -10,14 +11,18 @@
 #include <cryptoTools/Common/Log.h>
 #include <cryptoTools/Common/Timer.h>
 #include "util.h"
+#include "PerfCounters.h"
+#include <chrono>
+#include <functional>
 
 #include <dEnc/tools/GroupChannel.h>
+#include <dEnc/tools/ThreadPool.h>
 
 using namespace dEnc;
 
 
 template<typename DPRF>
-void eval(std::vector<AmmrClient<DPRF>>& encs,u64 n, u64 m, u64 blockCount, u64 batch, u64 trials, u64 numAsync, bool lat, std::string tag)
+void eval(std::vector<AmmrClient<DPRF>>& encs,u64 n, u64 m, u64 blockCount, u64 batch, u64 trials, u64 numAsync, bool lat, bool single, std::string tag)
 {
     oc::Timer t;
     auto s = t.setTimePoint("start");
@@ -57,14 +62,22 @@ void eval(std::vector<AmmrClient<DPRF>>& encs,u64 n, u64 m, u64 blockCount, u64
             // check if we have reached the maximum number of 
             // async encryptions. If so, then complete the oldest 
             // one by calling AsyncEncrypt::get();
-            if (asyncs.size() == numAsync)
+            while (asyncs.size() >= numAsync * (single ? batch : 1))
             {
                 asyncs.front().get();
                 asyncs.pop_front();
             }
 
             // initiate another encryption. This will not complete immidiately.
-            asyncs.emplace_back(initiator.asyncEncrypt(data, ciphertext));
+            if (single)
+            {
+                // Each message is encrypted on its own, as a service that handles
+                // one request at a time would. The DPRF coalesces the evaluations.
+                for (u64 k = 0; k < batch; ++k)
+                    asyncs.emplace_back(initiator.asyncEncrypt(data[k], ciphertext[k]));
+            }
+            else
+                asyncs.emplace_back(initiator.asyncEncrypt(data, ciphertext));
         }
 
         // Complete all pending encryptions
@@ -91,7 +104,7 @@ void eval(std::vector<AmmrClient<DPRF>>& encs,u64 n, u64 m, u64 blockCount, u64
 }
 
 
-void AmmrSymClient_tp_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 numAsync, u64 batch, bool lat)
+void AmmrSymClient_tp_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 numAsync, u64 batch, bool lat, u64 coalesceWindow, u64 serverThreads)
 {
 
     // set up the networking
@@ -107,22 +120,37 @@ void AmmrSymClient_tp_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 nu
     // Initialize the parties using a random seed from the OS.
     oc::PRNG prng(oc::sysRandomSeed());
 
-    // Generate the master key for this DPRF.
+    // Generate the master key for this DPRF. The sub-keys are derived
+    // from a seed so that only the keys of one party are expanded at a time.
     Npr03SymDprf::MasterKey mk;
-    mk.KeyGen(n, m, prng);
+    mk.KeyGen(n, m, prng, Npr03SymDprf::MasterKey::KeyMode::Derived);
 
 
     // initialize the DPRF and the encrypters
     for (u64 i = 0; i < n; ++i)
     {
         auto& e = eps[i];
+        auto keys = mk.expandSubkey(i);
 
-        dprfs[i].init(i, m, e.mRequestChls, e.mListenChls, prng.get<block>(),mk.keyStructure, mk.getSubkey(i));
+        dprfs[i].init(i, m, e.mRequestChls, e.mListenChls, prng.get<block>(), keys);
         encs[i].init(i, prng.get<block>(), &dprfs[i]);
     }
 
+    // Optionally gather the single evaluations into batches of up to "batch" inputs.
+    if (coalesceWindow)
+        for (auto& d : dprfs)
+            d.enableCoalescing(batch, std::chrono::microseconds(coalesceWindow));
+
+    // Optionally split large requests across worker threads shared by all of the servers.
+    if (serverThreads)
+    {
+        auto pool = std::make_shared<ThreadPool>(serverThreads);
+        for (auto& d : dprfs)
+            d.setThreadPool(pool);
+    }
+
     // Perform the benchmark.                                          
-    eval(encs, n, m, blockCount, batch, trials, numAsync, lat, "Sym      ");
+    eval(encs, n, m, blockCount, batch, trials, numAsync, lat, coalesceWindow != 0, "Sym      ");
 }
 
 
@@ -130,7 +158,8 @@ void AmmrSymClient_tp_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 nu
 
 
 
-void AmmrAsymSHClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 numAsync, u64 batch, bool lat)
+template<typename Group>
+void AmmrAsymSHClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 numAsync, u64 batch, bool lat, u64 coalesceWindow, u64 serverThreads, u64 clientThreads, bool serverWeighting)
 {
 
     // set up the networking
@@ -140,15 +169,15 @@ void AmmrAsymSHClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 nu
         eps[i].connect(i, n, ios);
 
     // allocate the DPRFs and the encryptors
-    std::vector<AmmrClient<Npr03AsymDprf>> encs(n);
-    std::vector<Npr03AsymDprf> dprfs(n);
+    std::vector<AmmrClient<Npr03AsymDprfT<Group>>> encs(n);
+    std::vector<Npr03AsymDprfT<Group>> dprfs(n);
 
     // Initialize the parties using a random seed from the OS.
     oc::PRNG prng(oc::sysRandomSeed());
 
     // Generate the master key for this DPRF.
     auto type = Dprf::Type::SemiHonest;
-    Npr03AsymDprf::MasterKey mk;
+    typename Npr03AsymDprfT<Group>::MasterKey mk;
     mk.KeyGen(n, m, prng, type);
 
 
@@ -159,16 +188,38 @@ void AmmrAsymSHClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 nu
 
         dprfs[i].init(i, m, e.mRequestChls, e.mListenChls, prng.get<block>(), type, mk.mKeyShares[i], mk.mCommits);
         encs[i].init(i, prng.get<block>(), &dprfs[i]);
+
+        // Optionally move the weighting of the output shares to the servers.
+        dprfs[i].setServerWeighting(serverWeighting);
     }
 
+    // Optionally gather the single evaluations into batches of up to "batch" inputs.
+    if (coalesceWindow)
+        for (auto& d : dprfs)
+            d.enableCoalescing(batch, std::chrono::microseconds(coalesceWindow));
+
+    // Optionally split large requests across worker threads shared by all of the servers.
+    if (serverThreads)
+    {
+        auto pool = std::make_shared<ThreadPool>(serverThreads);
+        for (auto& d : dprfs)
+            d.setThreadPool(pool);
+    }
+
+    // Optionally split the batches of the initiator across worker threads.
+    if (clientThreads)
+        dprfs[0].setClientThreadPool(std::make_shared<ThreadPool>(clientThreads));
+
     // Perform the benchmark.                                          
-    eval(encs, n, m, blockCount, batch, trials, numAsync, lat, "Asym-SH  ");
+    auto tag = std::is_same<Group, RelicGroup>::value ? "Asym-SH  " : "R255-SH  ";
+    eval(encs, n, m, blockCount, batch, trials, numAsync, lat, coalesceWindow != 0, tag);
 }
 
 
 
 
-void AmmrAsymMalClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 numAsync, u64 batch, bool lat, bool pv)
+template<typename Group>
+void AmmrAsymMalClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 numAsync, u64 batch, bool lat, bool pv, u64 coalesceWindow, u64 serverThreads, u64 clientThreads)
 {
 
     // set up the networking
@@ -178,15 +229,15 @@ void AmmrAsymMalClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 n
         eps[i].connect(i, n, ios);
 
     // allocate the DPRFs and the encryptors
-    std::vector<AmmrClient<Npr03AsymDprf>> encs(n);
-    std::vector<Npr03AsymDprf> dprfs(n);
+    std::vector<AmmrClient<Npr03AsymDprfT<Group>>> encs(n);
+    std::vector<Npr03AsymDprfT<Group>> dprfs(n);
 
     // Initialize the parties using a random seed from the OS.
     oc::PRNG prng(oc::sysRandomSeed());
 
     // Generate the master key for this DPRF.
     auto type = pv ? Dprf::Type::PublicVarifiable : Dprf::Type::Malicious;
-    Npr03AsymDprf::MasterKey mk;
+    typename Npr03AsymDprfT<Group>::MasterKey mk;
     mk.KeyGen(n, m, prng, type);
 
     // initialize the DPRF and the encrypters
@@ -197,8 +248,216 @@ void AmmrAsymMalClient_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials, u64 n
         encs[i].init(i, prng.get<block>(), &dprfs[i]);
     }
 
+    // Optionally gather the single evaluations into batches of up to "batch" inputs.
+    if (coalesceWindow)
+        for (auto& d : dprfs)
+            d.enableCoalescing(batch, std::chrono::microseconds(coalesceWindow));
+
+    // Optionally split large requests across worker threads shared by all of the servers.
+    if (serverThreads)
+    {
+        auto pool = std::make_shared<ThreadPool>(serverThreads);
+        for (auto& d : dprfs)
+            d.setThreadPool(pool);
+    }
+
+    // Optionally split the batches of the initiator across worker threads.
+    if (clientThreads)
+        dprfs[0].setClientThreadPool(std::make_shared<ThreadPool>(clientThreads));
+
     // Perform the benchmark.                                          
-    eval(encs, n, m, blockCount, batch, trials, numAsync, lat, "Asym-Mal ");
+    auto tag = std::is_same<Group, RelicGroup>::value ? "Asym-Mal " : "R255-Mal ";
+    eval(encs, n, m, blockCount, batch, trials, numAsync, lat, coalesceWindow != 0, tag);
+}
+
+template<typename Group>
+void Npr03AsymPvDprf_audit_Perf_test(u64 n, u64 m, u64 trials, u64 batch)
+{
+    // set up the networking
+    oc::IOService ios;
+    std::vector<GroupChannel> eps(n);
+    for (u64 i = 0; i < n; ++i)
+        eps[i].connect(i, n, ios);
+
+    std::vector<Npr03AsymDprfT<Group>> dprfs(n);
+
+    // Initialize the parties using a random seed from the OS.
+    oc::PRNG prng(oc::sysRandomSeed());
+
+    // Generate the master key and the published commitments.
+    auto type = Dprf::Type::PublicVarifiable;
+    typename Npr03AsymDprfT<Group>::MasterKey mk;
+    mk.KeyGen(n, m, prng, type);
+
+    for (u64 i = 0; i < n; ++i)
+    {
+        auto& e = eps[i];
+        dprfs[i].init(i, m, e.mRequestChls, e.mListenChls, prng.get<block>(), type, mk.mKeyShares[i], mk.mCommits);
+    }
+
+    // Evaluate the DPRF on the inputs in batches and keep the transcripts.
+    auto loops = (trials + batch - 1) / batch;
+    trials = loops * batch;
+    std::vector<block> x(batch), outputs; outputs.reserve(trials);
+    std::vector<DprfTranscriptT<Group>> transcripts, t; transcripts.reserve(trials);
+
+    oc::Timer timer;
+    auto s = timer.setTimePoint("start");
+    for (u64 l = 0; l < loops; ++l)
+    {
+        prng.get(x.data(), x.size());
+        auto y = dprfs[0].asyncEval(x, t).get();
+        outputs.insert(outputs.end(), y.begin(), y.end());
+        transcripts.insert(transcripts.end(), t.begin(), t.end());
+    }
+    auto e0 = timer.setTimePoint("eval");
+
+    // A third party audits all of the outputs at once, and then one at a time.
+    DprfAuditorT<Group> auditor(m, mk.mCommits);
+    if (auditor.verify(transcripts, outputs, prng) == false)
+        throw std::runtime_error(LOCATION);
+    auto e1 = timer.setTimePoint("bulk audit");
+
+    for (u64 i = 0; i < trials; ++i)
+        if (auditor.verify({ &transcripts[i], 1 }, { &outputs[i], 1 }, prng) == false)
+            throw std::runtime_error(LOCATION);
+    auto e2 = timer.setTimePoint("single audit");
+
+    for (auto& d : dprfs)
+        d.close();
+
+    auto ms = [](oc::Timer::timeUnit b, oc::Timer::timeUnit e) {
+        return (double)std::chrono::duration_cast<std::chrono::microseconds>(e - b).count() / 1000; };
+    auto eval = ms(s, e0), bulk = ms(e0, e1), single = ms(e1, e2);
+
+    // print the statistics.
+    auto tag = std::is_same<Group, RelicGroup>::value ? "Asym-PV  " : "R255-PV  ";
+    std::cout << tag << "      n:" << n << "  m:" << m << "   t:" << trials 
+        << "     eval/s:" << 1000 * trials / eval
+        << "   audit/s bulk:" << 1000 * trials / bulk
+        << "   audit/s single:" << 1000 * trials / single
+        << std::endl;
+}
+
+// The layout that MultiKeyAES used before the round-major key store: an array
+// of key schedules, so that round j of key k and k+1 are sizeof(oc::AES) bytes
+// apart. sums[i] = XOR_k AES_k(plaintexts[i]) for i in {0, ..., N-1}.
+template<u64 N>
+void aosEncSumTile(const std::vector<oc::AES>& aes, const block* plaintexts, block* sums)
+{
+    const u64 K = 8 / N;
+    block acc[N], in[N], c[K][N];
+    for (u64 i = 0; i < N; ++i)
+    {
+        acc[i] = oc::ZeroBlock;
+        in[i] = plaintexts[i];
+    }
+
+    auto key = aes.data();
+    for (u64 l = 0; l < aes.size() / K; ++l, key += K)
+    {
+        for (u64 k = 0; k < K; ++k)
+            for (u64 i = 0; i < N; ++i)
+                c[k][i] = _mm_xor_si128(in[i], key[k].mRoundKey[0]);
+
+        for (u64 j = 1; j < 10; ++j)
+            for (u64 k = 0; k < K; ++k)
+                for (u64 i = 0; i < N; ++i)
+                    c[k][i] = _mm_aesenc_si128(c[k][i], key[k].mRoundKey[j]);
+
+        for (u64 k = 0; k < K; ++k)
+            for (u64 i = 0; i < N; ++i)
+                acc[i] = _mm_xor_si128(acc[i], _mm_aesenclast_si128(c[k][i], key[k].mRoundKey[10]));
+    }
+
+    for (u64 l = 0; l < aes.size() % K; ++l, ++key)
+    {
+        for (u64 i = 0; i < N; ++i)
+        {
+            c[0][i] = _mm_xor_si128(in[i], key[0].mRoundKey[0]);
+            for (u64 j = 1; j < 10; ++j)
+                c[0][i] = _mm_aesenc_si128(c[0][i], key[0].mRoundKey[j]);
+            acc[i] = _mm_xor_si128(acc[i], _mm_aesenclast_si128(c[0][i], key[0].mRoundKey[10]));
+        }
+    }
+
+    for (u64 i = 0; i < N; ++i)
+        sums[i] = acc[i];
+}
+
+void aosEncBlocksSum(const std::vector<oc::AES>& aes, const block* in, u64 n, block* out)
+{
+    for (; n >= 8; n -= 8, in += 8, out += 8)
+        aosEncSumTile<8>(aes, in, out);
+
+    switch (n)
+    {
+    case 1: aosEncSumTile<1>(aes, in, out); break;
+    case 2: aosEncSumTile<2>(aes, in, out); break;
+    case 3: aosEncSumTile<3>(aes, in, out); break;
+    case 4: aosEncSumTile<4>(aes, in, out); break;
+    case 5: aosEncSumTile<5>(aes, in, out); break;
+    case 6: aosEncSumTile<6>(aes, in, out); break;
+    case 7: aosEncSumTile<7>(aes, in, out); break;
+    default: break;
+    }
+}
+
+// Compares the cache behavior of the symmetric DPRF's multi-key AES with the round keys
+// stored as an array of key schedules against the round-major key store, with and 
+// without huge pages. Party 0's C(n-1, n-m) sub-keys are used with the AES-NI kernels.
+void MultiKeyAES_layout_Perf_test(u64 n, u64 m, u64 blockCount, u64 trials)
+{
+    oc::PRNG prng(oc::sysRandomSeed());
+    Npr03SymDprf::MasterKey mk;
+    mk.KeyGen(n, m, prng);
+    auto keys = mk.expandSubkey(0);
+
+    std::vector<oc::AES> aes(keys.size());
+    for (u64 i = 0; i < keys.size(); ++i)
+        aes[i].setKey(keys[i]);
+
+    MultiKeyAES soa(keys), huge(keys, RoundKeyStore::Pages::Huge);
+    soa.setBackend(MultiKeyAES::Backend::SSE);
+    huge.setBackend(MultiKeyAES::Backend::SSE);
+
+    std::vector<block> in(blockCount), out(blockCount);
+    prng.get(in.data(), in.size());
+
+    PerfCounters counters;
+    auto run = [&](std::string tag, std::function<void()> fn)
+    {
+        // warm up the caches.
+        fn();
+
+        counters.start();
+        auto s = std::chrono::high_resolution_clock::now();
+        for (u64 t = 0; t < trials; ++t)
+            fn();
+        auto e = std::chrono::high_resolution_clock::now();
+        counters.stop();
+
+        auto aesCount = double(trials * blockCount * keys.size());
+        std::cout << tag << "  n:" << n << "  m:" << m << "  keys:" << keys.size() << "  blocks:" << blockCount
+            << "   ns/AES:" << std::chrono::duration<double, std::nano>(e - s).count() / aesCount;
+
+        for (int i = 0; i < PerfCounters::NumEvents; ++i)
+        {
+            auto ev = PerfCounters::Event(i);
+            std::cout << "   " << PerfCounters::name(ev) << "/call:";
+            if (counters.available(ev))
+                std::cout << double(counters.get(ev)) / trials;
+            else
+                std::cout << "n/a";
+        }
+        std::cout << std::endl;
+    };
+
+    run("AoS       ", [&]() { aosEncBlocksSum(aes, in.data(), in.size(), out.data()); });
+    run("SoA       ", [&]() { soa.ecbEncBlocksSum(in.data(), in.size(), out.data()); });
+    // SoA-thp indicates that no huge pages were reserved and transparent huge pages were requested instead.
+    run(huge.mKeys.onHugePages() ? "SoA-huge  " : "SoA-thp   ",
+        [&]() { huge.ecbEncBlocksSum(in.data(), in.size(), out.data()); });
 }
 
 
@@ -250,6 +509,21 @@ int main(int argc, char** argv)
     auto size = cmd.get<u64>("size");
     bool l = cmd.isSet("l");
 
+    cmd.setDefault("cw", 0);
+    auto cw = cmd.get<u64>("cw");
+
+    cmd.setDefault("st", 0);
+    auto st = cmd.get<u64>("st");
+
+    cmd.setDefault("ct", 0);
+    auto ct = cmd.get<u64>("ct");
+
+
+    // Run the DDH based DPRFs in the ristretto255 group instead of relic's curve.
+    bool rist = cmd.isSet("rist");
+
+    // Have the servers weight the output shares of the semi-honest DDH based DPRF.
+    bool sw = cmd.isSet("sw");
 
     cmd.setDefault("nStart", 4);
     cmd.setDefault("nStep", 2);
@@ -269,8 +543,8 @@ int main(int argc, char** argv)
     auto mc = cmd.get<i64>("mc");
 
 
-    std::string shSym("ss"), shAsym("sa"), malAsym("ma"), pvAsym("pv");
-    bool noneSet = !cmd.isSet(shSym) && !cmd.isSet(shAsym) && !cmd.isSet(malAsym) && !cmd.isSet(pvAsym);
+    std::string shSym("ss"), shAsym("sa"), malAsym("ma"), pvAsym("pv"), pvAudit("pva"), keyLayout("kl");
+    bool noneSet = !cmd.isSet(shSym) && !cmd.isSet(shAsym) && !cmd.isSet(malAsym) && !cmd.isSet(pvAsym) && !cmd.isSet(pvAudit) && !cmd.isSet(keyLayout);
     if (noneSet)
     {
         std::cout
@@ -285,6 +559,8 @@ int main(int argc, char** argv)
             << " -" << shAsym << "  to run `weakly malicious` protocol with an DDH based DPRF.\n"
             << " -" << malAsym << "  to run `strongly malicious` protocol with an DDH based DPRF.\n"
             << " -" << pvAsym << "  to run `strongly malicious` protocol with an DHH based DPRF and has public varifiability.\n"
+            << " -" << pvAudit << " to measure how fast a third party audits the outputs of the publicly varifiable DPRF, in bulk and one at a time.\n"
+            << " -" << keyLayout << "  to compare the cache misses of the AES based DPRF's key layouts, e.g. -kl -nStart 16 -mc 8 -size 1.\n"
             << "\n"
             << "Parameters:\n"
             << " -nStart    the number of parties to have on the first iteration (default = 4).\n"
@@ -296,7 +572,12 @@ int main(int argc, char** argv)
             << " -b         the number of encryptions that should be send in a single requires (default = 128).\n"
             << " -a         the number of asynchronous encryption batches that should be allowed (default = 10).\n"
             << " -l         a flag to indicates that encryptions should be performed synchonously and one at a time. -b,-a will be ignored.\n"
+            << " -cw        encrypt each message with its own call and let the DPRF coalesce up to -b evaluations within this many microseconds (default = 0, disabled).\n"
+            << " -st        the number of worker threads that the servers split large requests across (default = 0).\n"
+            << " -ct        the number of worker threads that the client of the DDH based DPRFs splits its batches across (default = 0).\n"
             << " -size      the number of 16 byte blocks that should be encrypted (default = 20)\n"
+            << " -sw        a flag to have the servers weight their output shares by the lagrange coefficients in -" << shAsym << ", which saves the client m-1 exponentiations per input.\n"
+            << " -rist      a flag to run the DDH based DPRFs in the ristretto255 group instead of relic's curve, to compare the two groups.\n"
             << "\n"
             << "Unit tests can be use with\n"
             << " -u \n"
@@ -315,10 +596,22 @@ int main(int argc, char** argv)
                 return -1;
             }
 
-            if (cmd.isSet(shSym))  AmmrSymClient_tp_Perf_test(n, m, size, t, a, b, l);
-            if (cmd.isSet(shAsym)) AmmrAsymSHClient_Perf_test(n, m, size, t, a, b, l);
-            if (cmd.isSet(malAsym))AmmrAsymMalClient_Perf_test(n, m, size, t, a, b, l, false);
-            if (cmd.isSet(pvAsym)) AmmrAsymMalClient_Perf_test(n, m, size, t, a, b, l, true);
+            if (cmd.isSet(shSym))  AmmrSymClient_tp_Perf_test(n, m, size, t, a, b, l, cw, st);
+            if (rist)
+            {
+                if (cmd.isSet(shAsym)) AmmrAsymSHClient_Perf_test<Rist255Group>(n, m, size, t, a, b, l, cw, st, ct, sw);
+                if (cmd.isSet(malAsym))AmmrAsymMalClient_Perf_test<Rist255Group>(n, m, size, t, a, b, l, false, cw, st, ct);
+                if (cmd.isSet(pvAsym)) AmmrAsymMalClient_Perf_test<Rist255Group>(n, m, size, t, a, b, l, true, cw, st, ct);
+                if (cmd.isSet(pvAudit)) Npr03AsymPvDprf_audit_Perf_test<Rist255Group>(n, m, t, b);
+            }
+            else
+            {
+                if (cmd.isSet(shAsym)) AmmrAsymSHClient_Perf_test<RelicGroup>(n, m, size, t, a, b, l, cw, st, ct, sw);
+                if (cmd.isSet(malAsym))AmmrAsymMalClient_Perf_test<RelicGroup>(n, m, size, t, a, b, l, false, cw, st, ct);
+                if (cmd.isSet(pvAsym)) AmmrAsymMalClient_Perf_test<RelicGroup>(n, m, size, t, a, b, l, true, cw, st, ct);
+                if (cmd.isSet(pvAudit)) Npr03AsymPvDprf_audit_Perf_test<RelicGroup>(n, m, t, b);
+            }
+            if (cmd.isSet(keyLayout)) MultiKeyAES_layout_Perf_test(n, m, size, t);
         }
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "AmmrClient_tests.h"
 
 #include <dEnc/distEnc/AmmrClient.h>
+#include <dEnc/distEnc/AmmrStream.h>
 #include <dEnc/dprf/Npr03SymDprf.h>
 #include <dEnc/dprf/Npr03AsymDprf.h>
 #include <cryptoTools/Common/Finally.h>
@@ -73,8 +74,72 @@ void test_ammr(const u64 &trials,
 
             if (!eq(d[t], data2))
                 throw std::runtime_error(LOCATION);
+
+            // encrypt fragments into a buffer of the caller and scatter the 
+            // plaintext of a regular ciphertext into fragments.
+            auto split = prng.get<u64>() % data.size();
+            span<const block> frags[] = { span<block>(data).first(split), span<block>(data).subspan(split) };
+            std::vector<block> buff(AmmrClient<DPRF>::ciphertextSize(data.size()));
+            encs[i].encrypt(frags, buff);
+            encs[i].decrypt(buff, data2);
+
+            if (!eq(data, data2))
+                throw std::runtime_error(LOCATION);
+
+            std::vector<block> lo(split), hi(data.size() - split);
+            span<block> outs[] = { lo, hi };
+            encs[i].decrypt(ciphertext, outs);
+            data2 = lo;
+            data2.insert(data2.end(), hi.begin(), hi.end());
+
+            if (!eq(data, data2))
+                throw std::runtime_error(LOCATION);
         }
     }
+
+    // the large message mode, with a message that ends inside a leaf. One 
+    // party decrypts with a pool and one on its own thread.
+    auto pool = std::make_shared<ThreadPool>(3);
+    encs[0].setLargeMessageMode(pool, AmmrTreeLeafSize);
+    encs[1].setLargeMessageMode(pool);
+
+    std::vector<block> big(3 * AmmrTreeLeafSize + 17), bigCtxt, big2;
+    prng.get(big.data(), big.size());
+
+    encs[0].encrypt(big, bigCtxt);
+    if (ciphertextVersion(bigCtxt[0]) != AmmrVersion::Tree)
+        throw std::runtime_error(LOCATION);
+
+    encs[1].decrypt(bigCtxt, big2);
+    if (!eq(big, big2))
+        throw std::runtime_error(LOCATION);
+
+    encs[n - 1].decrypt(bigCtxt, big2);
+    if (!eq(big, big2))
+        throw std::runtime_error(LOCATION);
+
+    // smaller messages keep the serial version.
+    std::vector<block> small(AmmrTreeLeafSize - 1), smallCtxt;
+    encs[0].encrypt(small, smallCtxt);
+    if (ciphertextVersion(smallCtxt[0]) != AmmrVersion::Serial)
+        throw std::runtime_error(LOCATION);
+
+    // a modified ciphertext is rejected, both in the last leaf and if 
+    // it is relabeled with the serial version.
+    for (u64 t = 0; t < 2; ++t)
+    {
+        auto c2 = bigCtxt;
+        if (t)
+            ((u8*)&c2[0])[15] = u8(AmmrVersion::Serial);
+        else
+            c2.back() = c2.back() ^ oc::OneBlock;
+
+        bool failed = false;
+        try { encs[1].decrypt(c2, big2); }
+        catch (std::runtime_error&) { failed = true; }
+        if (!failed)
+            throw std::runtime_error(LOCATION);
+    }
 }
 
 
@@ -196,3 +261,114 @@ void AmmrAsymMalClient_encDec_test()
 }
 
 
+void AmmrSymClient_stream_test()
+{
+    oc::setThreadName("__myThread__");
+    u64 n = 4;
+    u64 m = 2;
+    u64 size = 1000;
+
+    oc::IOService ios;
+    std::vector<GroupChannel> eps(n);
+    std::vector<AmmrClient<Npr03SymDprf>> encs(n);
+    std::vector<Npr03SymDprf> dprfs(n);
+
+    oc::Finally f([&]() {
+        for (u64 i = 0; i < n; ++i)
+            encs[i].close();
+    });
+
+    for (u64 i = 0; i < n; ++i)
+        eps[i].connect(i, n, ios);
+
+    PRNG prng(oc::ZeroBlock);
+    Npr03SymDprf::MasterKey mk;
+    mk.KeyGen(n, m, prng);
+
+    for (u64 i = 0; i < n; ++i)
+    {
+        auto& e = eps[i];
+
+        dprfs[i].init(i, m, e.mRequestChls, e.mListenChls, prng.get<block>(), mk.keyStructure, mk.getSubkey(i));
+        encs[i].init(i, prng.get<block>(), &dprfs[i]);
+    }
+
+    std::vector<block> data(size), ctxt(AmmrHeaderSize + size), data2(size), ctxt2, data3;
+    prng.get(data.data(), data.size());
+
+    // uneven chunks, which also differ between the two passes.
+    auto forChunks = [&](u64 seed, std::function<void(u64, u64)> fn)
+    {
+        PRNG chunkPrng(oc::toBlock(seed));
+        for (u64 i = 0; i < size;)
+        {
+            auto len = std::min<u64>(chunkPrng.get<u64>() % 37, size - i);
+            fn(i, len);
+            i += len;
+        }
+    };
+    auto body = span<block>(ctxt).subspan(AmmrHeaderSize);
+    auto header = span<block>(ctxt).first(AmmrHeaderSize);
+
+    AmmrEncryptStream<Npr03SymDprf> enc;
+    enc.init(encs[0]);
+    forChunks(0, [&](u64 i, u64 len) { enc.update(span<block>(data).subspan(i, len)); });
+    enc.final(header);
+    forChunks(1, [&](u64 i, u64 len) { enc.encrypt(span<block>(data).subspan(i, len), body.subspan(i, len)); });
+
+    // the streamed ciphertext is a regular one.
+    encs[1].decrypt(ctxt, data3);
+    if (!eq(data, data3))
+        throw std::runtime_error(LOCATION);
+
+    // and a regular one can be streamed, checked first.
+    encs[2].encrypt(data, ctxt2);
+    auto body2 = span<block>(ctxt2).subspan(AmmrHeaderSize);
+    AmmrDecryptStream<Npr03SymDprf> dec;
+    dec.init(encs[3], span<block>(ctxt2).first(AmmrHeaderSize));
+    // The decryption pass must be split the same way as the checking one.
+    forChunks(2, [&](u64 i, u64 len) { dec.update(body2.subspan(i, len)); });
+    dec.final();
+    forChunks(2, [&](u64 i, u64 len) { dec.decrypt(body2.subspan(i, len), span<block>(data2).subspan(i, len)); });
+    if (!eq(data, data2))
+        throw std::runtime_error(LOCATION);
+
+    // a ciphertext that is changed after it was checked is rejected 
+    // before the plaintext of the changed chunk is released.
+    dec.init(encs[3], span<block>(ctxt2).first(AmmrHeaderSize));
+    forChunks(2, [&](u64 i, u64 len) { dec.update(body2.subspan(i, len)); });
+    dec.final();
+    body2[size / 2] = body2[size / 2] ^ oc::OneBlock;
+    std::fill(data2.begin(), data2.end(), oc::ZeroBlock);
+
+    bool failed = false;
+    try { forChunks(2, [&](u64 i, u64 len) { dec.decrypt(body2.subspan(i, len), span<block>(data2).subspan(i, len)); }); }
+    catch (std::runtime_error&) { failed = true; }
+    if (!failed || neq(data2[size / 2], oc::ZeroBlock))
+        throw std::runtime_error(LOCATION);
+    body2[size / 2] = body2[size / 2] ^ oc::OneBlock;
+
+    // or in a single pass, in place.
+    dec.init(encs[3], span<block>(ctxt2).first(AmmrHeaderSize));
+    forChunks(4, [&](u64 i, u64 len) { dec.updateUnverified(body2.subspan(i, len), body2.subspan(i, len)); });
+    dec.final();
+    if (!eq(data, body2))
+        throw std::runtime_error(LOCATION);
+
+    // a modified ciphertext is rejected and none of it is released.
+    body[size / 2] = body[size / 2] ^ oc::OneBlock;
+    dec.init(encs[3], header);
+    forChunks(5, [&](u64 i, u64 len) { dec.update(body.subspan(i, len)); });
+
+    failed = false;
+    try { dec.final(); }
+    catch (std::runtime_error&) { failed = true; }
+    if (!failed)
+        throw std::runtime_error(LOCATION);
+
+    failed = false;
+    try { dec.decrypt(body, data2); }
+    catch (std::runtime_error&) { failed = true; }
+    if (!failed)
+        throw std::runtime_error(LOCATION);
+}
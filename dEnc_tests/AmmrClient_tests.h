@@ -5,3 +5,4 @@
 void AmmrSymClient_encDec_test();
 void AmmrAsymShClient_encDec_test();
 void AmmrAsymMalClient_encDec_test();
+void AmmrSymClient_stream_test();
@@ -0,0 +1,283 @@
+#include "Ecc_tests.h"
+#include <dEnc/tools/Msm.h>
+#include <dEnc/tools/FixedBase.h>
+#include <dEnc/tools/NoncePool.h>
+#include <dEnc/tools/Lagrange.h>
+#include <dEnc/tools/Ristretto255.h>
+#include <dEnc/dprf/Npr03AsymDprf.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <cryptoTools/Common/Log.h>
+
+using namespace dEnc;
+
+
+void Ecc_multiScalarMul_test()
+{
+    oc::REllipticCurve curve;
+    PRNG prng(oc::ZeroBlock);
+
+    // covers both Straus' and Pippenger's method.
+    std::vector<u64> sizes{ 0, 1, 2, 9, PippengerThreshold - 1, PippengerThreshold, 150 };
+    for (auto n : sizes)
+    {
+        std::vector<oc::REccPoint> points(n);
+        std::vector<oc::REccNumber> scalars(n);
+
+        oc::REccPoint exp;
+        ep_set_infty(exp.mVal);
+        for (u64 i = 0; i < n; ++i)
+        {
+            points[i].randomize(prng);
+            scalars[i].randomize(prng);
+            exp += points[i] * scalars[i];
+        }
+
+        if (multiScalarMul(points, scalars) != exp)
+            throw std::runtime_error(LOCATION);
+    }
+
+    // several sums with shared scalars.
+    u64 m = 5, rows = 7;
+    std::vector<oc::REccPoint> points(m * rows), out(rows);
+    std::vector<oc::REccNumber> scalars(m);
+    for (auto& p : points) p.randomize(prng);
+    for (auto& s : scalars) s.randomize(prng);
+
+    // the sums are left projective until they are normalized together.
+    multiScalarMul(points, scalars, out);
+    normalize(out);
+    for (u64 i = 0; i < rows; ++i)
+    {
+        oc::REccPoint exp;
+        ep_set_infty(exp.mVal);
+        for (u64 j = 0; j < m; ++j)
+            exp += points[i * m + j] * scalars[j];
+
+        if (out[i] != exp)
+            throw std::runtime_error(LOCATION);
+    }
+
+    // normalizing sums together, also with the identity among them, does not change them.
+    std::vector<oc::REccPoint> sums(rows), exp(rows);
+    for (u64 i = 0; i < rows; ++i)
+        sums[i] = points[i] + points[i + rows];
+    ep_set_infty(sums[3].mVal);
+    exp = sums;
+    normalize(sums);
+    for (u64 i = 0; i < rows; ++i)
+        if (sums[i] != exp[i])
+            throw std::runtime_error(LOCATION);
+}
+
+void Ecc_fixedBase_test()
+{
+    oc::REllipticCurve curve;
+    PRNG prng(oc::ZeroBlock);
+
+    oc::REccPoint base(prng);
+    FixedBaseTable table(base);
+    auto copy = table;
+
+    for (u64 i = 0; i < 10; ++i)
+    {
+        oc::REccNumber k(prng);
+        if (table.mul(k) != base * k ||
+            copy.mul(k) != base * k)
+            throw std::runtime_error(LOCATION);
+    }
+}
+
+void Ecc_noncePool_test()
+{
+    oc::REllipticCurve curve;
+    PRNG prng(oc::ZeroBlock);
+
+    FixedBaseTable gen(curve.getGenerator());
+    NoncePool pool;
+    pool.start(gen, 8, 2, prng.get<block>());
+
+    // Waits for the pool to hold count nonces.
+    auto waitFor = [&](u64 count)
+    {
+        for (u64 i = 0; i < 1000 && pool.size() != count; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        if (pool.size() != count)
+            throw std::runtime_error(LOCATION);
+    };
+
+    oc::REccNumber r;
+    oc::REccPoint gr;
+    for (u64 j = 0; j < 2; ++j)
+    {
+        waitFor(8);
+
+        // taking down to the low watermark refills the pool.
+        for (u64 i = 0; i < 6; ++i)
+        {
+            if (pool.tryTake(r, gr) == false || gr != curve.getGenerator() * r)
+                throw std::runtime_error(LOCATION);
+        }
+    }
+
+    pool.stop();
+    if (pool.running() || pool.tryTake(r, gr))
+        throw std::runtime_error(LOCATION);
+
+    bool threw = false;
+    try { pool.start(gen, 2, 2, prng.get<block>()); }
+    catch (std::exception&) { threw = true; }
+    if (threw == false)
+        throw std::runtime_error(LOCATION);
+}
+
+void Ecc_lagrange_test()
+{
+    oc::REllipticCurve curve;
+    PRNG prng(oc::ZeroBlock);
+    using Num = oc::REccNumber;
+
+    u64 m = 6;
+    std::vector<Num> coeffs(m), x(m), fx(m);
+    for (auto& c : coeffs) c.randomize(prng);
+    for (u64 i = 0; i < m; ++i)
+    {
+        x[i] = i32(3 * i + 2);
+
+        // f(x_i) = SUM_j c_j * x_i^j.
+        Num xj(1);
+        fx[i] = 0;
+        for (u64 j = 0; j < m; ++j)
+        {
+            fx[i] += coeffs[j] * xj;
+            xj *= x[i];
+        }
+
+        if (hornerEval(coeffs, x[i]) != fx[i])
+            throw std::runtime_error(LOCATION);
+    }
+
+    auto inv = x;
+    batchInvert(inv);
+    for (u64 i = 0; i < m; ++i)
+        if (inv[i] * x[i] != Num(1))
+            throw std::runtime_error(LOCATION);
+
+    // the constant term is interpolated at zero.
+    auto lag = lagrangeAtZero(x);
+    Num f0(0);
+    for (u64 i = 0; i < m; ++i)
+        f0 += lag[i] * fx[i];
+    if (f0 != coeffs[0])
+        throw std::runtime_error(LOCATION);
+
+    // the interpolated polynomial matches f everywhere.
+    auto L = Npr03AsymDprf::interpolate(fx, x);
+    for (u64 i = 0; i < 10; ++i)
+        if (L(i) != hornerEval(coeffs, Num(i32(i))))
+            throw std::runtime_error(LOCATION);
+
+    bool threw = false;
+    std::vector<Num> zero{ Num(1), Num(0) };
+    try { batchInvert(zero); }
+    catch (std::exception&) { threw = true; }
+    if (threw == false)
+        throw std::runtime_error(LOCATION);
+}
+
+namespace
+{
+    std::vector<u8> fromHex(const std::string& hex)
+    {
+        std::vector<u8> ret(hex.size() / 2);
+        for (u64 i = 0; i < ret.size(); ++i)
+            ret[i] = u8(std::stoi(hex.substr(2 * i, 2), nullptr, 16));
+        return ret;
+    }
+
+    std::vector<u8> toBytes(const Rist255Point& p)
+    {
+        std::vector<u8> ret(p.sizeBytes());
+        p.toBytes(ret.data());
+        return ret;
+    }
+}
+
+void Ecc_ristretto255_test()
+{
+    using Num = Rist255Number;
+    using Point = Rist255Point;
+    PRNG prng(oc::ZeroBlock);
+
+    // the encodings of 0, 1, 2 and 3 times the generator from RFC 9496.
+    std::vector<std::string> multiples{
+        "0000000000000000000000000000000000000000000000000000000000000000",
+        "e2f2ae0a6abc4e71a884a961c500515f58e30b6aa582dd8db6a65945e08d2d76",
+        "6a493210f7499cd17fecb510ae0cea23a110e8d5b901f8acadd3095c73a3b919",
+        "94741f5d5d52755ece4f23f044ee27d5d1ea1e2bd196b462166b16152a9d0259" };
+    Point g = Point::generator(), p;
+    for (u64 i = 0; i < multiples.size(); ++i)
+    {
+        auto exp = fromHex(multiples[i]);
+        if (toBytes(p) != exp || toBytes(g * Num(i32(i))) != exp)
+            throw std::runtime_error(LOCATION);
+
+        Point q;
+        q.fromBytes(exp.data());
+        if (q != p)
+            throw std::runtime_error(LOCATION);
+        p += g;
+    }
+
+    // the hash to the group of the RFC's first test vector.
+    auto uniform = fromHex(
+        "5d1be09e3d0c82fc538112490e35701979d99e06ca3e2b5b54bffe8b4dc772c1"
+        "4d98b696a1bbfb5ca32c436cc61c16563790306c79eaca7705668b47dffe5bb6");
+    p.fromUniformBytes(uniform.data());
+    if (toBytes(p) != fromHex("3066f82a1a747d45120d1740f14358531a8f04bbffe6a819f86dfe50f44a0a46"))
+        throw std::runtime_error(LOCATION);
+
+    // non-canonical and negative field elements, and a non-square.
+    std::vector<std::string> invalid{
+        "00ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+        "edffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f",
+        "0100000000000000000000000000000000000000000000000000000000000000",
+        "26948d35ca62e643e26a83177332e6b6afeb9d08e4268b650f1f5bbd8d81d371" };
+    for (auto& hex : invalid)
+    {
+        auto bytes = fromHex(hex);
+        bool threw = false;
+        try { p.fromBytes(bytes.data()); }
+        catch (std::exception&) { threw = true; }
+        if (threw == false)
+            throw std::runtime_error(LOCATION);
+    }
+
+    Rist255FixedBase table(g);
+    u64 n = 9;
+    std::vector<Point> points(n);
+    std::vector<Num> scalars(n);
+    Point sum;
+    for (u64 i = 0; i < n; ++i)
+    {
+        points[i].randomize(prng.get<block>());
+        scalars[i].randomize(prng);
+        sum += points[i] * scalars[i];
+
+        // the encoding round trips and the group laws hold.
+        auto& a = points[i];
+        auto& k = scalars[i];
+        Num j(prng);
+        Point b;
+        b.fromBytes(toBytes(a).data());
+        if (b != a ||
+            a * (k + j) != a * k + a * j ||
+            (a * k) * j != a * (k * j) ||
+            (a - a).isIdentity() == false ||
+            k * k.inverse() != Num(1) ||
+            table.mul(k) != g * k)
+            throw std::runtime_error(LOCATION);
+    }
+
+    if (multiScalarMul(points, scalars) != sum)
+        throw std::runtime_error(LOCATION);
+}
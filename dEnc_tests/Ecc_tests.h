@@ -0,0 +1,9 @@
+#pragma once
+
+
+
+void Ecc_multiScalarMul_test();
+void Ecc_fixedBase_test();
+void Ecc_noncePool_test();
+void Ecc_lagrange_test();
+void Ecc_ristretto255_test();
@@ -0,0 +1,78 @@
+#include "MultiKeyAES_tests.h"
+#include <dEnc/tools/MultiKeyAES.h>
+#include <cryptoTools/Crypto/PRNG.h>
+#include <cryptoTools/Common/Log.h>
+
+using namespace dEnc;
+
+
+void MultiKeyAES_ecbEncSum_test()
+{
+    PRNG prng(oc::ZeroBlock);
+
+    std::vector<MultiKeyAES::Backend> backends{
+        MultiKeyAES::Backend::SSE,
+        MultiKeyAES::Backend::VAES256,
+        MultiKeyAES::Backend::VAES512 };
+
+    // exercise the main loops as well as every tail size of each backend.
+    for (u64 numKeys = 0; numKeys < 41; ++numKeys)
+    {
+        std::vector<block> keys(numKeys);
+        prng.get(keys.data(), keys.size());
+
+        // alternate between regular and huge page backed key stores.
+        auto pages = numKeys & 1 ? RoundKeyStore::Pages::Huge : RoundKeyStore::Pages::Default;
+        MultiKeyAES mk(keys, pages);
+        std::vector<oc::AES> aes(numKeys);
+        for (u64 i = 0; i < numKeys; ++i)
+            aes[i].setKey(keys[i]);
+
+        // the per key encryptions of a copy.
+        auto copy = mk;
+        block x = prng.get<block>();
+        std::vector<block> perKey(numKeys);
+        copy.ecbEncBlock(x, perKey.data());
+        for (u64 i = 0; i < numKeys; ++i)
+            if (neq(perKey[i], aes[i].ecbEncBlock(x)))
+                throw std::runtime_error(LOCATION);
+
+        for (u64 numInputs = 0; numInputs < 71; ++numInputs)
+        {
+            std::vector<block> in(numInputs), out(numInputs), exp(numInputs);
+            prng.get(in.data(), in.size());
+
+            for (u64 j = 0; j < numInputs; ++j)
+            {
+                exp[j] = oc::ZeroBlock;
+                for (u64 i = 0; i < numKeys; ++i)
+                    exp[j] = exp[j] ^ aes[i].ecbEncBlock(in[j]);
+            }
+
+            for (auto backend : backends)
+            {
+                if (MultiKeyAES::isSupported(backend) == false)
+                    continue;
+
+                mk.setBackend(backend);
+                mk.ecbEncBlocksSum(in.data(), in.size(), out.data());
+
+                for (u64 j = 0; j < numInputs; ++j)
+                {
+                    if (neq(out[j], exp[j]) ||
+                        neq(mk.ecbEncBlockSum(in[j]), exp[j]))
+                        throw std::runtime_error(LOCATION);
+                }
+
+                // the sums over two key ranges split at a group boundary.
+                auto mid = numKeys / 16 * RoundKeyStore::GroupSize;
+                std::vector<block> lo(numInputs), hi(numInputs);
+                mk.ecbEncBlocksSum(in.data(), in.size(), lo.data(), 0, mid);
+                mk.ecbEncBlocksSum(in.data(), in.size(), hi.data(), mid, numKeys);
+                for (u64 j = 0; j < numInputs; ++j)
+                    if (neq(lo[j] ^ hi[j], exp[j]))
+                        throw std::runtime_error(LOCATION);
+            }
+        }
+    }
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+
+
+void MultiKeyAES_ecbEncSum_test();
@@ -9,6 +9,8 @@
 #include <cryptoTools/Network/Channel.h>
 
 #include <dEnc/tools/GroupChannel.h>
+#include <dEnc/tools/Combinatorics.h>
+#include <dEnc/tools/ThreadPool.h>
 
 using namespace dEnc;
 
@@ -82,6 +84,553 @@ void Npr03SymShDPRF_eval_test()
 
 }
 
+void Npr03SymShDPRF_derivedKey_test()
+{
+	oc::setThreadName("__myThread__");
+
+	u64 n = 6;
+	u64 m = 3;
+
+	u64 trials = 4;
+
+    // the computed key structure must match the stored one.
+    PRNG prng(oc::ZeroBlock);
+    Npr03SymDprf::MasterKey explicitKey;
+    explicitKey.KeyGen(n, m, prng);
+	for (u64 i = 0; i < n; ++i)
+		for (u64 j = 0; j < explicitKey.keyStructure.stride(); ++j)
+			if (Npr03SymDprf::MasterKey::keyIndex(n, m, i, j) != explicitKey.keyStructure(i, j))
+				throw std::runtime_error(LOCATION);
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03SymDprf> dprfs(n);
+
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+    Npr03SymDprf::MasterKey mk;
+    mk.KeyGen(n, m, prng, Npr03SymDprf::MasterKey::KeyMode::Derived);
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		auto keys = mk.expandSubkey(i);
+		for (u64 j = 0; j < keys.size(); ++j)
+			if (neq(keys[j], mk.getKey(Npr03SymDprf::MasterKey::keyIndex(n, m, i, j))))
+				throw std::runtime_error(LOCATION);
+
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), keys);
+	}
+
+	std::vector<oc::AES> keys(dprfs[0].mD);
+	for (auto i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.getKey(i));
+
+	std::vector<block> x(trials), exp(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+		exp[t] = oc::ZeroBlock;
+
+		for (u64 i = 0; i < keys.size(); ++i)
+			exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+	}
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		auto out = dprfs[i].asyncEval(x).get();
+
+		for (u64 t = 0; t < trials; ++t)
+		{
+			auto fi = dprfs[i].eval(x[t]);
+
+			if (neq(fi, exp[t]) || neq(out[t], exp[t]))
+				throw std::runtime_error(LOCATION);
+		}
+	}
+}
+
+void Npr03SymShDPRF_quorum_test()
+{
+	oc::setThreadName("__myThread__");
+
+	u64 n = 5;
+	u64 m = 3;
+
+	u64 trials = 3;
+
+    PRNG prng(oc::ZeroBlock);
+    Npr03SymDprf::MasterKey mk;
+    mk.KeyGen(n, m, prng);
+
+	std::vector<oc::AES> keys(mk.keys.size());
+	for (u64 i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.keys[i]);
+
+	std::vector<block> x(trials), exp(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+		exp[t] = oc::ZeroBlock;
+
+		for (u64 i = 0; i < keys.size(); ++i)
+			exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+	}
+
+    // once with the stored key structure and once with the computed one.
+    for (u64 computed = 0; computed < 2; ++computed)
+    {
+	    oc::IOService ios;
+	    std::vector<GroupChannel> comms(n);
+	    std::vector<Npr03SymDprf> dprfs(n);
+
+	    oc::Finally f([&]() {
+		    for (auto& d : dprfs) d.close();
+		    dprfs.clear();
+		    comms.clear(); });
+
+	    for (u64 i = 0; i < n; ++i)
+		    comms[i].connect(i, n, ios);
+
+	    for (u64 i = 0; i < n; ++i)
+	    {
+            if (computed)
+		        dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.getSubkey(i));
+            else
+		        dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.keyStructure, mk.getSubkey(i));
+	    }
+
+        // every quorum of size m, evaluated by each of its members.
+        std::vector<u64> subset(m);
+        for (u64 i = 0; i < m; ++i)
+            subset[i] = i;
+        do
+        {
+            oc::BitVector quorum(n);
+            for (auto p : subset)
+                quorum[p] = true;
+
+            for (auto p : subset)
+            {
+		        auto out = dprfs[p].asyncEval(x, quorum).get();
+                auto fi = dprfs[p].asyncEval(x[0], quorum).get();
+
+		        for (u64 t = 0; t < trials; ++t)
+			        if (neq(out[t], exp[t]))
+				        throw std::runtime_error(LOCATION);
+
+                if (neq(fi[0], exp[0]))
+                    throw std::runtime_error(LOCATION);
+            }
+        } while (nextSubset(subset, n));
+
+        // a quorum without the requester is rejected.
+        oc::BitVector bad(n);
+        for (u64 i = 1; i <= m; ++i)
+            bad[i] = true;
+
+        bool threw = false;
+        try { dprfs[0].asyncEval(x, bad); }
+        catch (std::exception&) { threw = true; }
+        if (threw == false)
+            throw std::runtime_error(LOCATION);
+    }
+}
+
+void Npr03SymShDPRF_coalesce_test()
+{
+	oc::setThreadName("__myThread__");
+
+	u64 n = 4;
+	u64 m = 2;
+
+	u64 trials = 20;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03SymDprf> dprfs(n);
+
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+    PRNG prng(oc::ZeroBlock);
+    Npr03SymDprf::MasterKey mk;
+    mk.KeyGen(n, m, prng);
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.keyStructure, mk.getSubkey(i));
+		dprfs[i].enableCoalescing(8, std::chrono::microseconds(100));
+	}
+
+	std::vector<oc::AES> keys(dprfs[0].mD);
+	for (u64 i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.keys[i]);
+
+	std::vector<block> x(trials), exp(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+		exp[t] = oc::ZeroBlock;
+
+		for (u64 i = 0; i < keys.size(); ++i)
+			exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+	}
+
+	for (u64 i = 0; i < n; ++i)
+	{
+        // the evaluations are sent in batches of 8 and the last 4 once their window passes.
+        std::vector<AsyncEval> asyncs(trials);
+		for (u64 t = 0; t < trials; ++t)
+            asyncs[t] = dprfs[i].asyncEval(x[t]);
+
+        // complete them out of order.
+		for (u64 t = trials; t-- > 0;)
+		{
+            auto fi = asyncs[t].get();
+			if (fi.size() != 1 || neq(fi[0], exp[t]))
+				throw std::runtime_error(LOCATION);
+		}
+
+        // batched evaluations are not coalesced.
+		auto out = dprfs[i].asyncEval(x).get();
+		for (u64 t = 0; t < trials; ++t)
+			if (neq(out[t], exp[t]))
+				throw std::runtime_error(LOCATION);
+	}
+}
+
+void Npr03SymShDPRF_deadParty_test()
+{
+	oc::setThreadName("__myThread__");
+
+	u64 n = 5;
+	u64 m = 3;
+	u64 trials = 4;
+	u64 dead = n - 1;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03SymDprf> dprfs(n);
+
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	PRNG prng(oc::ZeroBlock);
+	Npr03SymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng);
+
+	for (u64 i = 0; i < dead; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.keyStructure, mk.getSubkey(i));
+
+	// the last party tells the others that it is done requesting and then 
+	// goes away without serving, so that receiving from it fails.
+	u8 close[1]{ 0 };
+	for (auto& c : comms[dead].mRequestChls)
+		c.asyncSendCopy(close, 1);
+	for (u64 j = 0; j < dead; ++j)
+	{
+		comms[dead].mRequestChls[j].close();
+		comms[dead].mListenChls[j].close();
+	}
+
+	std::vector<oc::AES> keys(dprfs[0].mD);
+	for (u64 i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.keys[i]);
+
+	std::vector<block> x(trials), exp(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+		exp[t] = oc::ZeroBlock;
+
+		for (u64 i = 0; i < keys.size(); ++i)
+			exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+	}
+
+	// party 0 contacts each pair of consecutive parties in turn. The pairs
+	// {3, 4} and {4, 1} fail, including the one whose dead party comes first.
+	dprfs[0].setPartySelection(PartySelector::Policy::RoundRobin);
+
+	u64 failures = 0;
+	for (u64 j = 0; j < 8; ++j)
+	{
+		std::vector<block> y;
+		try { y = dprfs[0].asyncEval(x).get(); }
+		catch (std::exception&) { ++failures; continue; }
+
+		for (u64 t = 0; t < trials; ++t)
+			if (neq(y[t], exp[t]))
+				throw std::runtime_error(LOCATION);
+	}
+	if (failures != 4)
+		throw std::runtime_error(LOCATION);
+
+	// an evaluation whose result is never requested.
+	dprfs[0].asyncEval(x);
+
+	// every contacted party is eventually settled, also the ones 
+	// after a failed party and those of the dropped evaluation.
+	auto& selector = dprfs[0].partySelector();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	for (u64 p = 1; p < n; ++p)
+	{
+		while (selector.outstanding(p))
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				throw std::runtime_error(LOCATION);
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void Npr03SymShDPRF_ewmaDeadParty_test()
+{
+	oc::setThreadName("__myThread__");
+
+	u64 n = 5;
+	u64 m = 3;
+	u64 trials = 4;
+	u64 dead = n - 1;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03SymDprf> dprfs(n);
+
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	PRNG prng(oc::ZeroBlock);
+	Npr03SymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng);
+
+	for (u64 i = 0; i < dead; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.keyStructure, mk.getSubkey(i));
+
+	// the last party is dead from the start, see Npr03SymShDPRF_deadParty_test.
+	u8 close[1]{ 0 };
+	for (auto& c : comms[dead].mRequestChls)
+		c.asyncSendCopy(close, 1);
+	for (u64 j = 0; j < dead; ++j)
+	{
+		comms[dead].mRequestChls[j].close();
+		comms[dead].mListenChls[j].close();
+	}
+
+	std::vector<oc::AES> keys(dprfs[0].mD);
+	for (u64 i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.keys[i]);
+
+	std::vector<block> x(trials), exp(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+		exp[t] = oc::ZeroBlock;
+
+		for (u64 i = 0; i < keys.size(); ++i)
+			exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+	}
+
+	// The dead party never gets a measured latency. It may be tried while it 
+	// is unmeasured, but each failure makes it more expensive than the others.
+	dprfs[0].setPartySelection(PartySelector::Policy::EwmaLatency);
+
+	u64 failures = 0;
+	for (u64 j = 0; j < 40; ++j)
+	{
+		std::vector<block> y;
+		try { y = dprfs[0].asyncEval(x).get(); }
+		catch (std::exception&) { ++failures; continue; }
+
+		for (u64 t = 0; t < trials; ++t)
+			if (neq(y[t], exp[t]))
+				throw std::runtime_error(LOCATION);
+	}
+
+	auto& selector = dprfs[0].partySelector();
+	if (failures > 3 || (failures && selector.latency(dead) == std::chrono::nanoseconds(0)))
+		throw std::runtime_error(LOCATION);
+}
+
+void Npr03DPRF_threadPool_test()
+{
+	oc::setThreadName("__myThread__");
+
+	u64 n = 6;
+	u64 m = 3;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n), asymComms(n);
+	std::vector<Npr03SymDprf> dprfs(n);
+	std::vector<Npr03AsymDprf> asymDprfs(n);
+
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		for (auto& d : asymDprfs) d.close();
+		dprfs.clear();
+		asymDprfs.clear();
+		comms.clear();
+		asymComms.clear(); });
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		comms[i].connect(i, n, ios);
+		asymComms[i].connect(i, n, ios);
+	}
+
+	// one pool is shared by every party.
+	auto pool = std::make_shared<ThreadPool>(3);
+
+	PRNG prng(oc::ZeroBlock);
+	Npr03SymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng);
+
+	auto type = Dprf::Type::Malicious;
+	Npr03AsymDprf::MasterKey asymMk;
+	asymMk.KeyGen(n, m, prng, type);
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.keyStructure, mk.getSubkey(i));
+		asymDprfs[i].init(i, m, asymComms[i].mRequestChls, asymComms[i].mListenChls, oc::toBlock(i), type, asymMk.mKeyShares[i], asymMk.mCommits);
+
+		// shard every request, even small ones.
+		dprfs[i].setThreadPool(pool);
+		dprfs[i].mMinShardWork = 1;
+		asymDprfs[i].setThreadPool(pool);
+		asymDprfs[i].mMinShardSize = 1;
+	}
+
+	std::vector<oc::AES> keys(dprfs[0].mD);
+	for (u64 i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.keys[i]);
+
+	// a few inputs are split by keys, many inputs are split by inputs.
+	for (u64 trials : { 1, 3, 100 })
+	{
+		std::vector<block> x(trials), exp(trials);
+		for (u64 t = 0; t < trials; ++t)
+		{
+			x[t] = prng.get<block>();
+			exp[t] = oc::ZeroBlock;
+
+			for (u64 i = 0; i < keys.size(); ++i)
+				exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+		}
+
+		for (u64 i = 0; i < n; ++i)
+		{
+			auto out = dprfs[i].asyncEval(x).get();
+			for (u64 t = 0; t < trials; ++t)
+				if (neq(out[t], exp[t]))
+					throw std::runtime_error(LOCATION);
+		}
+	}
+
+	std::vector<block> x(10);
+	prng.get(x.data(), x.size());
+
+	auto exp = asymDprfs[0].asyncEval(x).get();
+	for (u64 i = 1; i < n; ++i)
+	{
+		auto out = asymDprfs[i].asyncEval(x).get();
+		for (u64 t = 0; t < x.size(); ++t)
+			if (neq(out[t], exp[t]))
+				throw std::runtime_error(LOCATION);
+	}
+}
+
+void Npr03AsymDPRF_clientPool_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 4;
+	u64 m = 3;
+	u64 trials = 37;
+
+	auto pool = std::make_shared<ThreadPool>(3);
+
+	for (auto type : { Dprf::Type::SemiHonest, Dprf::Type::Malicious, Dprf::Type::PublicVarifiable })
+	{
+		oc::IOService ios;
+		std::vector<GroupChannel> comms(n);
+		std::vector<Npr03AsymDprf> dprfs(n);
+		oc::Finally f([&]() {
+			for (auto& d : dprfs) d.close();
+			dprfs.clear();
+			comms.clear(); });
+		for (u64 i = 0; i < n; ++i)
+			comms[i].connect(i, n, ios);
+
+		PRNG prng(oc::ZeroBlock);
+		Npr03AsymDprf::MasterKey mk;
+		mk.KeyGen(n, m, prng, type);
+
+		for (u64 i = 0; i < n; ++i)
+			dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+		std::vector<block> x(trials);
+		prng.get(x.data(), x.size());
+		auto exp = dprfs[0].asyncEval(x).get();
+
+		// party 1 splits its evaluations into uneven slices.
+		dprfs[1].setClientThreadPool(pool);
+		dprfs[1].mMinShardSize = 1;
+		if (type == Dprf::Type::SemiHonest)
+			dprfs[1].setServerWeighting(true);
+
+		std::vector<Npr03AsymDprf::ProofEncoding> encodings{ Npr03AsymDprf::ProofEncoding::Legacy };
+		if (type == Dprf::Type::Malicious)
+		{
+			encodings.push_back(Npr03AsymDprf::ProofEncoding::Compact);
+			encodings.push_back(Npr03AsymDprf::ProofEncoding::Batch);
+		}
+
+		for (auto e : encodings)
+		{
+			if (type == Dprf::Type::Malicious)
+				dprfs[1].setProofEncoding(e);
+
+			auto y = dprfs[1].asyncEval(x).get();
+			for (u64 t = 0; t < trials; ++t)
+				if (neq(y[t], exp[t]))
+					throw std::runtime_error(LOCATION);
+		}
+
+		if (type == Dprf::Type::PublicVarifiable)
+		{
+			std::vector<DprfTranscript> transcripts;
+			auto y = dprfs[1].asyncEval(x, transcripts).get();
+
+			DprfAuditor auditor(m, mk.mCommits);
+			if (auditor.verify(transcripts, y, prng) == false)
+				throw std::runtime_error(LOCATION);
+		}
+	}
+}
+
 void Npr03AsymShDPRF_eval_test()
 {
 
@@ -103,7 +652,139 @@ void Npr03AsymShDPRF_eval_test()
 	for (u64 i = 0; i < n; ++i)
 		comms[i].connect(i, n, ios);
 
-    
+    
+    auto type = Dprf::Type::SemiHonest;
+    PRNG prng(oc::ZeroBlock);
+
+    Npr03AsymDprf::MasterKey mk;
+    mk.KeyGen(n, m, prng, type);
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+	}
+
+
+	std::vector<block> x(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+	}
+
+	auto exp = dprfs[0].asyncEval(x).get();
+	for (u64 i = 0; i < n; ++i)
+	{
+		auto d = dprfs[i].asyncEval(x).get();
+
+		for (u64 t = 0; t < trials; ++t)
+		{
+			auto fi = dprfs[i].eval(x[t]);
+			auto fi2 = dprfs[i].asyncEval(x[t]).get()[0];
+
+			if (neq(fi, exp[t]) ||
+				neq(fi2, exp[t]) ||
+				neq(d[t], exp[t]))
+			{
+				std::cout << "failed " << std::endl;
+				throw std::runtime_error(LOCATION);
+			}
+		}
+	}
+}
+
+void Npr03AsymShDPRF_weighting_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 5;
+	u64 m = 3;
+	u64 trials = 4;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	auto type = Dprf::Type::SemiHonest;
+	PRNG prng(oc::ZeroBlock);
+
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
+
+	for (u64 i = 0; i < n; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+	std::vector<block> x(trials);
+	prng.get(x.data(), x.size());
+
+	auto exp = dprfs[0].asyncEval(x).get();
+
+	// the parties weight their shares, also when a hedged party is used instead.
+	for (u64 i = 0; i < n; ++i)
+	{
+		dprfs[i].setServerWeighting(true);
+		for (auto hedge : { u64(0), n - m })
+		{
+			dprfs[i].setHedge(hedge);
+			for (u64 j = 0; j < 10; ++j)
+			{
+				auto d = dprfs[i].asyncEval(x).get();
+				for (u64 t = 0; t < trials; ++t)
+					if (neq(d[t], exp[t]) || neq(dprfs[i].eval(x[t]), exp[t]))
+						throw std::runtime_error(LOCATION);
+			}
+		}
+	}
+
+	// the weights of a quorum are the lagrange coefficients by party.
+	oc::BitVector quorum(n);
+	quorum[0] = quorum[2] = quorum[3] = true;
+	auto lag = dprfs[1].getLagrange(quorum);
+	std::vector<u64> parties{ 0, 2, 3 };
+	auto exp2 = Npr03AsymDprf::lagrangeCoefficients(parties);
+	if ((*lag)[1] != 0 || (*lag)[4] != 0)
+		throw std::runtime_error(LOCATION);
+	for (u64 i = 0; i < parties.size(); ++i)
+		if ((*lag)[parties[i]] != exp2[i])
+			throw std::runtime_error(LOCATION);
+
+	Npr03AsymDprf mal;
+	mal.mType = Dprf::Type::Malicious;
+	bool threw = false;
+	try { mal.setServerWeighting(true); }
+	catch (std::exception&) { threw = true; }
+	if (threw == false)
+		throw std::runtime_error(LOCATION);
+}
+
+void Npr03AsymMalDPRF_eval_test()
+{
+
+
+	oc::setThreadName("__myThread__");
+
+	u64 n = 4;
+	u64 m = 2;
+
+	u64 trials = 4;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+
     auto type = Dprf::Type::SemiHonest;
     PRNG prng(oc::ZeroBlock);
 
@@ -114,7 +795,7 @@ void Npr03AsymShDPRF_eval_test()
 	{
 		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
 	}
-
+     
 
 	std::vector<block> x(trials);
 	for (u64 t = 0; t < trials; ++t)
@@ -141,16 +822,66 @@ void Npr03AsymShDPRF_eval_test()
 			}
 		}
 	}
-}
 
-void Npr03AsymMalDPRF_eval_test()
-{
 
+}
 
+void Npr03AsymRistDPRF_eval_test()
+{
 	oc::setThreadName("__myThread__");
+	using Dprf = Npr03AsymRist255Dprf;
 
 	u64 n = 4;
 	u64 m = 2;
+	u64 trials = 4;
+
+	for (auto type : { Dprf::Type::SemiHonest, Dprf::Type::Malicious })
+	{
+		oc::IOService ios;
+		std::vector<GroupChannel> comms(n);
+		std::vector<Dprf> dprfs(n);
+		oc::Finally f([&]() {
+			for (auto& d : dprfs) d.close();
+			dprfs.clear();
+			comms.clear(); });
+		for (u64 i = 0; i < n; ++i)
+			comms[i].connect(i, n, ios);
+
+		PRNG prng(oc::ZeroBlock);
+		Dprf::MasterKey mk;
+		mk.KeyGen(n, m, prng, type);
+
+		for (u64 i = 0; i < n; ++i)
+			dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+		std::vector<block> x(trials);
+		prng.get(x.data(), x.size());
+
+		auto exp = dprfs[0].asyncEval(x).get();
+		for (u64 i = 1; i < n; ++i)
+		{
+			// every proof encoding gives the same output.
+			if (type == Dprf::Type::Malicious)
+				dprfs[i].setProofEncoding(Dprf::ProofEncoding(i - 1));
+
+			auto y = dprfs[i].asyncEval(x).get();
+			for (u64 t = 0; t < trials; ++t)
+			{
+				if (neq(y[t], exp[t]) ||
+					neq(dprfs[i].eval(x[t]), exp[t]))
+					throw std::runtime_error(LOCATION);
+			}
+		}
+	}
+}
+
+void Npr03AsymMalDPRF_hedge_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 5;
+	u64 m = 3;
 
 	u64 trials = 4;
 
@@ -164,44 +895,490 @@ void Npr03AsymMalDPRF_eval_test()
 	for (u64 i = 0; i < n; ++i)
 		comms[i].connect(i, n, ios);
 
+	auto type = Dprf::Type::Malicious;
+	PRNG prng(oc::ZeroBlock);
 
-    auto type = Dprf::Type::SemiHonest;
-    PRNG prng(oc::ZeroBlock);
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
 
-    Npr03AsymDprf::MasterKey mk;
-    mk.KeyGen(n, m, prng, type);
+	for (u64 i = 0; i < n; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+	std::vector<block> x(trials);
+	prng.get(x.data(), x.size());
+
+	auto exp = dprfs[0].asyncEval(x).get();
+
+	// every quorum interpolates the same master key.
+	std::vector<u64> quorum{ 1, 3, 4 };
+	auto lag = Npr03AsymDprf::lagrangeCoefficients(quorum);
+	Npr03AsymDprf::Num sk(0);
+	for (u64 i = 0; i < quorum.size(); ++i)
+		sk += lag[i] * mk.mKeyShares[quorum[i]];
+	if (sk != mk.mMasterKey)
+		throw std::runtime_error(LOCATION);
 
+	bool threw = false;
+	try { dprfs[0].setHedge(n - m + 1); }
+	catch (std::exception&) { threw = true; }
+	if (threw == false)
+		throw std::runtime_error(LOCATION);
+
+	// contact every other party and use whichever m-1 respond first.
 	for (u64 i = 0; i < n; ++i)
 	{
+		dprfs[i].setHedge(n - m);
+
+		for (u64 j = 0; j < 10; ++j)
+		{
+			auto d = dprfs[i].asyncEval(x).get();
+			for (u64 t = 0; t < trials; ++t)
+				if (neq(d[t], exp[t]))
+					throw std::runtime_error(LOCATION);
+		}
+	}
+}
+
+void Npr03AsymMalDPRF_deadParty_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 5;
+	u64 m = 3;
+	u64 trials = 4;
+	u64 dead = n - 1;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	auto type = Dprf::Type::Malicious;
+	PRNG prng(oc::ZeroBlock);
+
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
+
+	for (u64 i = 0; i < dead; ++i)
 		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+	// the last party tells the others that it is done requesting and then 
+	// goes away without serving, so that receiving from it fails.
+	u8 close[1]{ 0 };
+	for (auto& c : comms[dead].mRequestChls)
+		c.asyncSendCopy(close, 1);
+	for (u64 j = 0; j < dead; ++j)
+	{
+		comms[dead].mRequestChls[j].close();
+		comms[dead].mListenChls[j].close();
 	}
-     
 
 	std::vector<block> x(trials);
-	for (u64 t = 0; t < trials; ++t)
+	prng.get(x.data(), x.size());
+
+	// party 1 contacts parties 2 and 3 by default.
+	auto exp = dprfs[1].asyncEval(x).get();
+
+	// party 0 also contacts the dead party, whose response is not needed.
+	dprfs[0].setHedge(n - m);
+	for (u64 j = 0; j < 4; ++j)
 	{
-		x[t] = prng.get<block>();
+		auto y = dprfs[0].asyncEval(x).get();
+		for (u64 t = 0; t < trials; ++t)
+			if (neq(y[t], exp[t]))
+				throw std::runtime_error(LOCATION);
 	}
 
-	auto exp = dprfs[0].asyncEval(x).get();
+	// every contacted party is eventually settled, including the dead one.
+	auto& selector = dprfs[0].partySelector();
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	for (u64 p = 1; p < n; ++p)
+	{
+		while (selector.outstanding(p))
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				throw std::runtime_error(LOCATION);
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+void Npr03DPRF_partySelection_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 5;
+	u64 m = 3;
+	u64 trials = 3;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n), asymComms(n);
+	std::vector<Npr03SymDprf> dprfs(n);
+	std::vector<Npr03AsymDprf> asymDprfs(n);
+
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		for (auto& d : asymDprfs) d.close();
+		dprfs.clear();
+		asymDprfs.clear();
+		comms.clear();
+		asymComms.clear(); });
+
 	for (u64 i = 0; i < n; ++i)
 	{
-		auto d = dprfs[i].asyncEval(x).get();
+		comms[i].connect(i, n, ios);
+		asymComms[i].connect(i, n, ios);
+	}
 
-		for (u64 t = 0; t < trials; ++t)
+	PRNG prng(oc::ZeroBlock);
+	Npr03SymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng);
+
+	auto type = Dprf::Type::Malicious;
+	Npr03AsymDprf::MasterKey asymMk;
+	asymMk.KeyGen(n, m, prng, type);
+
+	for (u64 i = 0; i < n; ++i)
+	{
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), mk.keyStructure, mk.getSubkey(i));
+		asymDprfs[i].init(i, m, asymComms[i].mRequestChls, asymComms[i].mListenChls, oc::toBlock(i), type, asymMk.mKeyShares[i], asymMk.mCommits);
+	}
+
+	std::vector<oc::AES> keys(dprfs[0].mD);
+	for (u64 i = 0; i < keys.size(); ++i)
+		keys[i].setKey(mk.keys[i]);
+
+	std::vector<block> x(trials), exp(trials);
+	for (u64 t = 0; t < trials; ++t)
+	{
+		x[t] = prng.get<block>();
+		exp[t] = oc::ZeroBlock;
+
+		for (u64 i = 0; i < keys.size(); ++i)
+			exp[t] = exp[t] ^ keys[i].ecbEncBlock(x[t]);
+	}
+	auto asymExp = asymDprfs[0].asyncEval(x).get();
+
+	std::vector<PartySelector::Policy> policies{
+		PartySelector::Policy::Cyclic,
+		PartySelector::Policy::RoundRobin,
+		PartySelector::Policy::LeastOutstanding,
+		PartySelector::Policy::EwmaLatency,
+		PartySelector::Policy::PowerOfTwoChoices };
+
+	for (auto policy : policies)
+	{
+		for (u64 i = 0; i < n; ++i)
 		{
-			auto fi = dprfs[i].eval(x[t]);
-			auto fi2 = dprfs[i].asyncEval(x[t]).get()[0];
+			dprfs[i].setPartySelection(policy);
+			asymDprfs[i].setPartySelection(policy);
 
-			if (neq(fi, exp[t]) ||
-				neq(fi2, exp[t]) ||
-				neq(d[t], exp[t]))
+			// several evaluations in flight at once.
+			std::vector<AsyncEval> asyncs, asymAsyncs;
+			for (u64 j = 0; j < 8; ++j)
 			{
-				std::cout << "failed " << std::endl;
-				throw std::runtime_error(LOCATION);
+				asyncs.push_back(dprfs[i].asyncEval(x[j % trials]));
+				asymAsyncs.push_back(asymDprfs[i].asyncEval(x));
 			}
+
+			for (u64 j = 0; j < asyncs.size(); ++j)
+			{
+				if (neq(asyncs[j].get()[0], exp[j % trials]))
+					throw std::runtime_error(LOCATION);
+
+				auto y = asymAsyncs[j].get();
+				for (u64 t = 0; t < trials; ++t)
+					if (neq(y[t], asymExp[t]))
+						throw std::runtime_error(LOCATION);
+			}
+		}
+	}
+}
+
+void Npr03AsymMalDPRF_badProof_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 4;
+	u64 m = 2;
+	u64 trials = 5;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	auto type = Dprf::Type::Malicious;
+	PRNG prng(oc::ZeroBlock);
+
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
+
+	// party 1 uses a key share that does not match its commitment.
+	auto badShare = mk.mKeyShares[1] + Npr03AsymDprf::Num(1);
+	for (u64 i = 0; i < n; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, 
+			i == 1 ? badShare : mk.mKeyShares[i], mk.mCommits);
+
+	std::vector<block> x(trials);
+	prng.get(x.data(), x.size());
+
+	// party 2 contacts party 3 by default.
+	auto exp = dprfs[2].asyncEval(x).get();
+
+	// party 0 contacts party 1 by default, whose proofs fail.
+	bool threw = false;
+	try { dprfs[0].asyncEval(x).get(); }
+	catch (std::exception&) { threw = true; }
+	if (threw == false)
+		throw std::runtime_error(LOCATION);
+
+	// with the other parties as backup, the response of party 1 is skipped.
+	dprfs[0].setHedge(n - m);
+	auto y = dprfs[0].asyncEval(x).get();
+	for (u64 t = 0; t < trials; ++t)
+		if (neq(y[t], exp[t]))
+			throw std::runtime_error(LOCATION);
+}
+
+void Npr03AsymMalDPRF_proofEncoding_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 4;
+	u64 m = 2;
+	u64 trials = 5;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	auto type = Dprf::Type::Malicious;
+	PRNG prng(oc::ZeroBlock);
+
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
+
+	// party 1 uses a key share that does not match its commitment.
+	auto badShare = mk.mKeyShares[1] + Npr03AsymDprf::Num(1);
+	for (u64 i = 0; i < n; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type,
+			i == 1 ? badShare : mk.mKeyShares[i], mk.mCommits);
+
+	// the proofs of party 0 use precomputed nonces.
+	dprfs[0].setNoncePool(16, 4);
+
+	std::vector<block> x(trials);
+	prng.get(x.data(), x.size());
+
+	// party 2 contacts party 3 with legacy proofs.
+	auto exp = dprfs[2].asyncEval(x).get();
+
+	// party 3 contacts party 0 with compact and batch proofs.
+	for (auto e : { Npr03AsymDprf::ProofEncoding::Compact, Npr03AsymDprf::ProofEncoding::Batch })
+	{
+		dprfs[3].setProofEncoding(0, e);
+		auto y = dprfs[3].asyncEval(x).get();
+		for (u64 t = 0; t < trials; ++t)
+			if (neq(y[t], exp[t]))
+				throw std::runtime_error(LOCATION);
+
+		// the proofs of party 1 fail.
+		dprfs[0].setProofEncoding(e);
+		bool threw = false;
+		try { dprfs[0].asyncEval(x).get(); }
+		catch (std::exception&) { threw = true; }
+		if (threw == false)
+			throw std::runtime_error(LOCATION);
+	}
+
+	// the proof encodings are mixed in one evaluation.
+	dprfs[0].setProofEncoding(2, Npr03AsymDprf::ProofEncoding::Legacy);
+	dprfs[0].setProofEncoding(3, Npr03AsymDprf::ProofEncoding::Compact);
+	dprfs[0].setHedge(n - m);
+	auto y = dprfs[0].asyncEval(x).get();
+	for (u64 t = 0; t < trials; ++t)
+		if (neq(y[t], exp[t]))
+			throw std::runtime_error(LOCATION);
+
+	bool threw = false;
+	try { dprfs[0].setProofEncoding(0, Npr03AsymDprf::ProofEncoding(7)); }
+	catch (std::exception&) { threw = true; }
+	if (threw == false)
+		throw std::runtime_error(LOCATION);
+}
+
+void Npr03AsymMalDPRF_scratch_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 3;
+	u64 m = 2;
+	u64 trials = 8;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	auto type = Dprf::Type::Malicious;
+	PRNG prng(oc::ZeroBlock);
+
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
+	for (u64 i = 0; i < n; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+	// the scratch growth of every server that party 0 might contact.
+	auto growths = [&]() {
+		u64 a = 0;
+		for (u64 i = 1; i < n; ++i)
+			a += dprfs[i].scratchGrowths();
+		return a; };
+
+	std::vector<block> x(trials);
+	auto encodings = {
+		Npr03AsymDprf::ProofEncoding::Legacy,
+		Npr03AsymDprf::ProofEncoding::Compact,
+		Npr03AsymDprf::ProofEncoding::Batch };
+
+	// The first evaluations size the scratch of the servers. The requests 
+	// are served one at a time and so a single scratch is needed.
+	for (u64 j = 0; j < 2; ++j)
+	{
+		for (auto e : encodings)
+		{
+			dprfs[0].setProofEncoding(e);
+			prng.get(x.data(), x.size());
+			dprfs[0].asyncEval(x).get();
+		}
+	}
+
+	auto warm = growths();
+	if (warm == 0)
+		throw std::runtime_error(LOCATION);
+
+	// later evaluations, also of fewer inputs, reuse it.
+	for (u64 j = 0; j < 4; ++j)
+	{
+		for (auto e : encodings)
+		{
+			dprfs[0].setProofEncoding(e);
+			prng.get(x.data(), x.size());
+			dprfs[0].asyncEval(span<block>(x.data(), trials - j)).get();
 		}
 	}
 
+	if (growths() != warm)
+		throw std::runtime_error(LOCATION);
+}
+
+void Npr03AsymPvDPRF_audit_test()
+{
+	oc::setThreadName("__myThread__");
+	oc::REllipticCurve curve;
+
+	u64 n = 5;
+	u64 m = 3;
+	u64 trials = 6;
+
+	oc::IOService ios;
+	std::vector<GroupChannel> comms(n);
+	std::vector<Npr03AsymDprf> dprfs(n);
+	oc::Finally f([&]() {
+		for (auto& d : dprfs) d.close();
+		dprfs.clear();
+		comms.clear(); });
+	for (u64 i = 0; i < n; ++i)
+		comms[i].connect(i, n, ios);
+
+	auto type = Dprf::Type::PublicVarifiable;
+	PRNG prng(oc::ZeroBlock);
+
+	Npr03AsymDprf::MasterKey mk;
+	mk.KeyGen(n, m, prng, type);
+
+	for (u64 i = 0; i < n; ++i)
+		dprfs[i].init(i, m, comms[i].mRequestChls, comms[i].mListenChls, oc::toBlock(i), type, mk.mKeyShares[i], mk.mCommits);
+
+	std::vector<block> x(trials);
+	prng.get(x.data(), x.size());
+
+	// the transcripts of two parties with different quorums are audited together.
+	std::vector<DprfTranscript> t0, t1;
+	auto y0 = dprfs[0].asyncEval(x, t0).get();
+	auto y1 = dprfs[3].asyncEval(x, t1).get();
+	auto exp = dprfs[1].asyncEval(x).get();
+
+	std::vector<DprfTranscript> transcripts(t0.begin(), t0.end());
+	transcripts.insert(transcripts.end(), t1.begin(), t1.end());
+	std::vector<block> outputs(y0.begin(), y0.end());
+	outputs.insert(outputs.end(), y1.begin(), y1.end());
+	for (u64 i = 0; i < trials; ++i)
+		if (neq(y0[i], exp[i]) || neq(y1[i], exp[i]) || neq(transcripts[i].mInput, x[i]))
+			throw std::runtime_error(LOCATION);
+
+	DprfAuditor auditor(m, mk.mCommits);
+	if (auditor.verify(transcripts, outputs, prng) == false)
+		throw std::runtime_error(LOCATION);
+
+	// a serialized transcript can be audited by anyone.
+	std::vector<u8> buff(transcripts[0].sizeBytes());
+	transcripts[0].toBytes(buff.data());
+	DprfTranscript copy;
+	copy.fromBytes(buff);
+	if (auditor.verify({ &copy, 1 }, { &outputs[0], 1 }, prng) == false)
+		throw std::runtime_error(LOCATION);
+
+	// a wrong output, share or proof is detected.
+	auto badOutputs = outputs;
+	badOutputs[3] = badOutputs[3] ^ oc::OneBlock;
+	if (auditor.verify(transcripts, badOutputs, prng))
+		throw std::runtime_error(LOCATION);
+
+	auto badShare = transcripts;
+	badShare[2].mShares[1] = badShare[2].mShares[1] + curve.getGenerator();
+	if (auditor.verify(badShare, outputs, prng))
+		throw std::runtime_error(LOCATION);
+
+	auto badProof = transcripts;
+	badProof[7].mZ[0] = badProof[7].mZ[0] + oc::REccNumber(1);
+	if (auditor.verify(badProof, outputs, prng))
+		throw std::runtime_error(LOCATION);
 
+	// transcripts require the PublicVarifiable type.
+	bool threw = false;
+	Npr03AsymDprf mal;
+	mal.mType = Dprf::Type::Malicious;
+	try { mal.asyncEval(x, t0); }
+	catch (std::exception&) { threw = true; }
+	if (threw == false)
+		throw std::runtime_error(LOCATION);
 }
@@ -3,5 +3,21 @@
 
 
 void Npr03SymShDPRF_eval_test();
+void Npr03SymShDPRF_derivedKey_test();
+void Npr03SymShDPRF_quorum_test();
+void Npr03SymShDPRF_coalesce_test();
+void Npr03SymShDPRF_deadParty_test();
+void Npr03SymShDPRF_ewmaDeadParty_test();
+void Npr03DPRF_threadPool_test();
+void Npr03AsymDPRF_clientPool_test();
 void Npr03AsymShDPRF_eval_test();
+void Npr03AsymShDPRF_weighting_test();
 void Npr03AsymMalDPRF_eval_test();
+void Npr03AsymRistDPRF_eval_test();
+void Npr03AsymMalDPRF_hedge_test();
+void Npr03AsymMalDPRF_deadParty_test();
+void Npr03AsymMalDPRF_badProof_test();
+void Npr03AsymMalDPRF_proofEncoding_test();
+void Npr03AsymMalDPRF_scratch_test();
+void Npr03AsymPvDPRF_audit_test();
+void Npr03DPRF_partySelection_test();
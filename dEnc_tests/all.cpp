@@ -8,11 +8,34 @@ namespace dEnc_tests
 
     oc::TestCollection tests([](oc::TestCollection& tests)
 	{
+        tests.add("MultiKeyAES_ecbEncSum_test         ", MultiKeyAES_ecbEncSum_test);
+        tests.add("Ecc_multiScalarMul_test            ", Ecc_multiScalarMul_test);
+        tests.add("Ecc_fixedBase_test                 ", Ecc_fixedBase_test);
+        tests.add("Ecc_noncePool_test                 ", Ecc_noncePool_test);
+        tests.add("Ecc_lagrange_test                  ", Ecc_lagrange_test);
+        tests.add("Ecc_ristretto255_test              ", Ecc_ristretto255_test);
         tests.add("Npr03SymShDPRF_eval_test           ", Npr03SymShDPRF_eval_test);
+        tests.add("Npr03SymShDPRF_derivedKey_test     ", Npr03SymShDPRF_derivedKey_test);
+        tests.add("Npr03SymShDPRF_quorum_test         ", Npr03SymShDPRF_quorum_test);
+        tests.add("Npr03SymShDPRF_coalesce_test       ", Npr03SymShDPRF_coalesce_test);
+        tests.add("Npr03SymShDPRF_deadParty_test      ", Npr03SymShDPRF_deadParty_test);
+        tests.add("Npr03SymShDPRF_ewmaDeadParty_test  ", Npr03SymShDPRF_ewmaDeadParty_test);
+        tests.add("Npr03DPRF_threadPool_test          ", Npr03DPRF_threadPool_test);
+        tests.add("Npr03AsymDPRF_clientPool_test      ", Npr03AsymDPRF_clientPool_test);
 		tests.add("Npr03AsymShDPRF_eval_test          ", Npr03AsymShDPRF_eval_test);
+		tests.add("Npr03AsymShDPRF_weighting_test     ", Npr03AsymShDPRF_weighting_test);
 		tests.add("Npr03AsymMalDPRF_eval_test         ", Npr03AsymMalDPRF_eval_test);
+		tests.add("Npr03AsymRistDPRF_eval_test        ", Npr03AsymRistDPRF_eval_test);
+		tests.add("Npr03AsymMalDPRF_hedge_test        ", Npr03AsymMalDPRF_hedge_test);
+		tests.add("Npr03AsymMalDPRF_deadParty_test    ", Npr03AsymMalDPRF_deadParty_test);
+		tests.add("Npr03AsymMalDPRF_badProof_test     ", Npr03AsymMalDPRF_badProof_test);
+		tests.add("Npr03AsymMalDPRF_proofEncoding_test", Npr03AsymMalDPRF_proofEncoding_test);
+		tests.add("Npr03AsymMalDPRF_scratch_test      ", Npr03AsymMalDPRF_scratch_test);
+		tests.add("Npr03AsymPvDPRF_audit_test         ", Npr03AsymPvDPRF_audit_test);
+		tests.add("Npr03DPRF_partySelection_test      ", Npr03DPRF_partySelection_test);
 		tests.add("AmmrSymClient_encDec_test          ", AmmrSymClient_encDec_test);
 		tests.add("AmmrAsymShClient_encDec_test       ", AmmrAsymShClient_encDec_test);
 		tests.add("AmmrAsymMalClient_encDec_test      ", AmmrAsymMalClient_encDec_test);
+		tests.add("AmmrSymClient_stream_test          ", AmmrSymClient_stream_test);
     });
 }
@@ -3,6 +3,8 @@
 
 #include "dEnc_tests/AmmrClient_tests.h"
 #include "dEnc_tests/Npr03DPRF_tests.h"
+#include "dEnc_tests/MultiKeyAES_tests.h"
+#include "dEnc_tests/Ecc_tests.h"
 #include "cryptoTools/Common/TestCollection.h"
 namespace dEnc_tests {
 